@@ -238,8 +238,52 @@ typedef struct lai_object_t
     struct lai_nsnode_t *handle;
 
     int index;
+    int borrowed;            // storage belongs to an immutable Name(), see lai_load_ns()
 } lai_object_t;
 
+// Predefined children that are looked up most often. Devices, Processors and
+// ThermalZones keep direct pointers to these; see lai_ns_get_predefined().
+#define LAI_CHILD_HID           0
+#define LAI_CHILD_CID           1
+#define LAI_CHILD_UID           2
+#define LAI_CHILD_ADR           3
+#define LAI_CHILD_STA           4
+#define LAI_CHILD_CRS           5
+#define LAI_CHILD_PRS           6
+#define LAI_CHILD_SRS           7
+#define LAI_CHILD_PRT           8
+#define LAI_CHILD_INI           9
+#define LAI_CHILD_BBN           10
+#define LAI_CHILD_SEG           11
+#define LAI_CHILD_PRW           12
+#define LAI_CHILD_PS0           13
+#define LAI_CHILD_PS1           14
+#define LAI_CHILD_PS2           15
+#define LAI_CHILD_PS3           16
+#define LAI_CHILD_COUNT         17
+
+// Facts about a control method, collected once by lai_analyze_method().
+#define LAI_METHOD_INFO_ANALYZED        0x01    // the other fields are valid
+#define LAI_METHOD_INFO_BLOCKS          0x02    // Sleep(), Stall(), Acquire() or Wait()
+#define LAI_METHOD_INFO_HARDWARE        0x04    // accesses fields of OpRegions
+#define LAI_METHOD_INFO_CALLS           0x08    // invokes other methods
+#define LAI_METHOD_INFO_STORES_GLOBAL   0x10    // stores to named objects
+#define LAI_METHOD_INFO_CREATES         0x20    // creates named objects
+#define LAI_METHOD_INFO_MANY_REGIONS    0x40    // accesses more OpRegions than listed
+#define LAI_METHOD_INFO_VERIFIED        0x80    // runs without bounds checks
+
+#define LAI_METHOD_INFO_REGIONS         4
+
+typedef struct lai_method_info_t
+{
+    uint8_t flags;
+    int8_t max_local;        // highest LocalX that is used, -1 if none
+    int8_t max_arg;          // highest ArgX that is used, -1 if none
+    uint8_t max_depth;       // deepest nesting of operands
+    size_t ns_size;          // lai_ns_size at the time of the analysis
+    struct lai_nsnode_t *regions[LAI_METHOD_INFO_REGIONS];    // OpRegions that are accessed
+} lai_method_info_t;
+
 typedef struct lai_nsnode_t
 {
     char path[ACPI_MAX_NAME];    // full path of object
@@ -249,10 +293,12 @@ typedef struct lai_nsnode_t
 
     char alias[ACPI_MAX_NAME];    // for Alias() only
     lai_object_t object;        // for Name()
+    uint8_t object_immutable;    // for Name(), never stored to; see lai_analyze_namespace()
 
     uint8_t op_address_space;    // for OpRegions only
     uint64_t op_base;        // for OpRegions only
     uint64_t op_length;        // for OpRegions only
+    void *op_lock;            // for OpRegions only, serializes parallel accesses
 
     uint64_t field_offset;        // for Fields only, in bits
     size_t field_size;        // for Fields only, in bits
@@ -262,6 +308,11 @@ typedef struct lai_nsnode_t
     uint8_t method_flags;        // for Methods only, includes ARG_COUNT in lowest three bits
     // Allows the OS to override methods. Mainly useful for _OSI, _OS and _REV.
     int (*method_override)(lai_object_t *args, lai_object_t *result);
+    // Methods that only return a constant or a name are evaluated without the
+    // interpreter; see LAI_METHOD_* and lai_classify_method().
+    uint8_t method_class;        // for Methods only
+    uint64_t method_constant;    // for LAI_METHOD_CONSTANT only
+    lai_method_info_t method_info;    // for Methods only
 
     uint64_t indexfield_offset;    // for IndexFields, in bits
     char indexfield_index[ACPI_MAX_NAME];    // for IndexFields
@@ -274,20 +325,40 @@ typedef struct lai_nsnode_t
 
     uint8_t cpu_id;            // for Processor
 
-    char buffer[ACPI_MAX_NAME];        // for Buffer field
+    // Notify() handler, for Devices, Processors and ThermalZones
+    void (*notify_handler)(struct lai_nsnode_t *, uint64_t, void *);
+    void *notify_context;
+
+    char buffer[ACPI_MAX_NAME];        // for Buffer field, empty for buffer_object
+    struct lai_object_t *buffer_object;    // for Buffer field of an ArgX or LocalX
     uint64_t buffer_offset;        // for Buffer field, in bits
     uint64_t buffer_size;        // for Buffer field, in bits
+
+    // Namespace tree; see lai_ns_get_child()
+    struct lai_nsnode_t *parent;
+    struct lai_nsnode_t *children;
+    struct lai_nsnode_t *last_child;
+    struct lai_nsnode_t *next_sibling;
+    // Indexed by LAI_CHILD_*, for Devices, Processors and ThermalZones. Allocated when
+    // the first predefined child is linked; NULL until then and for other nodes.
+    struct lai_nsnode_t **predefined;
 } lai_nsnode_t;
 
+// Classes of control methods.
+#define LAI_METHOD_GENERIC      0    // run by the interpreter
+#define LAI_METHOD_CONSTANT     1    // Return(Integer)
+#define LAI_METHOD_LOAD         2    // Return(NameString), unless it calls a method
+
 #define LAI_POPULATE_CONTEXT_STACKITEM 1
 #define LAI_METHOD_CONTEXT_STACKITEM 2
 #define LAI_LOOP_STACKITEM 3
 #define LAI_COND_STACKITEM 4
 #define LAI_PKG_INITIALIZER_STACKITEM 5
 #define LAI_OP_STACKITEM 6
-// This implements lai_eval_operand(). // TODO: Eventually remove
-// lai_eval_operand() by moving all parsing functionality into lai_exec_run().
-#define LAI_EVALOPERAND_STACKITEM 10
+// Continuations: the item waits until its operands are on the opstack.
+#define LAI_PREDICATE_STACKITEM 7   // predicate of If() or While()
+#define LAI_RETURN_STACKITEM 8      // operand of Return()
+#define LAI_INVOKE_STACKITEM 9      // arguments of a method call
 
 typedef struct lai_stackitem_ {
     int kind;
@@ -315,6 +386,15 @@ typedef struct lai_stackitem_ {
             uint8_t op_arg_modes[8];
             uint8_t op_result_mode;
         };
+        struct {
+            int pred_opcode; // IF_OP or WHILE_OP.
+            int pred_end; // End of conditional PC, for If().
+        };
+        struct {
+            lai_nsnode_t *invoke_method;
+            int invoke_argc;
+            uint8_t invoke_result_mode;
+        };
     };
 } lai_stackitem_t;
 
@@ -325,6 +405,8 @@ typedef struct lai_state_t
     lai_object_t retvalue;
     lai_object_t arg[7];
     lai_object_t local[8];
+    int local_count;    // LocalX that might hold objects, see lai_finalize_state()
+    int buffer_fields;  // buffer fields refer to ArgX or LocalX, see lai_exec_buffer_field()
 
     // Stack to track the current execution state.
     int stack_ptr;
@@ -378,15 +460,19 @@ typedef struct acpi_large_irq_t
     uint32_t irq;
 }__attribute__((packed)) acpi_large_irq_t;
 
-acpi_fadt_t *lai_fadt;
-acpi_aml_t *lai_dsdt;
-size_t lai_ns_size;
-volatile uint16_t lai_last_event;
+extern acpi_fadt_t *lai_fadt;
+extern acpi_aml_t *lai_dsdt;
+extern size_t lai_ns_size;
+extern volatile uint16_t lai_last_event;
 
 // The remaining of these functions are OS independent!
 // ACPI namespace functions
-void lai_create_namespace(void);
+int lai_create_namespace(void);
 lai_nsnode_t *lai_resolve(char *);
+lai_nsnode_t *lai_ns_get_root(void);
+lai_nsnode_t *lai_ns_get_child(lai_nsnode_t *, const char *);
+lai_nsnode_t *lai_ns_get_predefined(lai_nsnode_t *, int);
+
 lai_nsnode_t *lai_get_device(size_t);
 lai_nsnode_t *lai_get_deviceid(size_t, lai_object_t *);
 lai_nsnode_t *lai_enum(char *, size_t);
@@ -395,14 +481,62 @@ size_t lai_read_resource(lai_nsnode_t *, acpi_resource_t *);
 
 // ACPI Control Methods
 int lai_eval(lai_object_t *, char *);
+int lai_eval_args(lai_nsnode_t *, int, lai_object_t *, lai_object_t *);
+size_t lai_eval_batch(lai_nsnode_t **, size_t, const char *, uint64_t *);
+
+// Objects returned by lai_eval() and lai_eval_args() are owned by the caller,
+// which releases them with lai_free_object().
+void lai_free_object(lai_object_t *);
+
+// Read-only views of Name() objects; these are not copied
+const lai_object_t *lai_view_node(lai_nsnode_t *);
+const lai_object_t *lai_view_element(const lai_object_t *, size_t);
+int lai_view_integer(const lai_object_t *, uint64_t *);
+const void *lai_view_buffer(const lai_object_t *, size_t, size_t);
+void lai_ns_read_lock(void);
+void lai_ns_read_unlock(void);
 int lai_populate(lai_nsnode_t *, void *, size_t, lai_state_t *);
 int lai_exec_method(lai_nsnode_t *, lai_state_t *);
 int lai_eval_node(lai_nsnode_t *, lai_state_t *);
 
 // Generic Functions
 int lai_enable_acpi(uint32_t);
+void lai_enable_parallel_init(size_t);
 int lai_disable_acpi();
 uint16_t lai_read_event();
 void lai_set_event(uint16_t);
+int lai_prepare_sleep(void);
 int lai_enter_sleep(uint8_t);
 int lai_pci_route(acpi_resource_t *, uint8_t, uint8_t, uint8_t);
+
+// Notify() handling
+typedef void (*lai_notify_handler_t)(lai_nsnode_t *, uint64_t, void *);
+int lai_install_notify_handler(lai_nsnode_t *, lai_notify_handler_t, void *);
+void lai_remove_notify_handler(lai_nsnode_t *);
+void lai_dispatch_notify(void);
+
+// Memory accounting
+#define LAI_MEMORY_NAMESPACE    0    // namespace nodes and table
+#define LAI_MEMORY_CODE         1    // copy of the AML code
+#define LAI_MEMORY_STRING       2
+#define LAI_MEMORY_BUFFER       3
+#define LAI_MEMORY_PACKAGE      4
+#define LAI_MEMORY_STATE        5    // interpreter state: scratch arena, queues, threads
+#define LAI_MEMORY_RESOURCE     6    // resource arrays
+#define LAI_MEMORY_CATEGORIES   7
+
+typedef struct lai_memory_stats_t
+{
+    // Objects and bytes currently allocated per category, and the peak number of bytes.
+    size_t objects[LAI_MEMORY_CATEGORIES];
+    size_t current[LAI_MEMORY_CATEGORIES];
+    size_t peak[LAI_MEMORY_CATEGORIES];
+
+    // Memory obtained from laihost_malloc(), including pool chunks and headers.
+    size_t host_current;
+    size_t host_peak;
+} lai_memory_stats_t;
+
+void lai_get_memory_stats(lai_memory_stats_t *);
+void lai_enable_memory_debug(void);
+size_t lai_report_leaks(void);
@@ -35,6 +35,19 @@ __attribute__((weak)) uint32_t laihost_ind(uint16_t);
 __attribute__((weak)) void laihost_pci_write(uint8_t, uint8_t, uint8_t, uint16_t, uint32_t);
 __attribute__((weak)) uint32_t laihost_pci_read(uint8_t, uint8_t, uint8_t, uint16_t);
 __attribute__((weak)) void laihost_sleep(uint64_t);
+// Blocks until the next interrupt arrives (e.g. sti; hlt on x86).
+__attribute__((weak)) void laihost_wait_for_interrupt(void);
+
+// Threading functions. Only required for parallel device initialization.
+__attribute__((weak)) void *laihost_create_lock(void);
+__attribute__((weak)) void laihost_lock(void *);
+__attribute__((weak)) void laihost_unlock(void *);
+__attribute__((weak)) void *laihost_create_thread(void (*)(void *), void *);
+__attribute__((weak)) void laihost_join_thread(void *);
 
 __attribute__((weak)) void laihost_handle_amldebug(lai_object_t *);
 
+// Called when Notify() queues the first pending notification. The host should
+// arrange for lai_dispatch_notify() to be called outside of AML execution.
+__attribute__((weak)) void laihost_schedule_notify(void);
+
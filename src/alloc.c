@@ -0,0 +1,639 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Memory Management */
+/* All memory that LAI uses is allocated here and accounted to a category, so
+ * that hosts can find out how much memory ACPI uses, and what for.
+ *
+ * Strings, buffers and packages are created and destroyed constantly while AML
+ * executes, and almost all of them are small. Instead of calling into the host
+ * for each of them, small blocks are carved from large host chunks and recycled
+ * through per-size-class free lists. Like the rest of the interpreter, the pool
+ * relies on the caller holding the interpreter lock.
+ *
+ * While a control method runs, allocations are served from a scratch arena
+ * instead. Most objects die before the method returns; the arena is reset in one
+ * step when the outermost method finishes. Objects that outlive the method must
+ * be moved to the pool by lai_pool_promote(). */
+
+#include <lai/core.h>
+#include "libc.h"
+#include "ns_impl.h"
+
+#define LAI_POOL_CHUNK          65536
+#define LAI_POOL_HOST           0xFF        // allocated directly from the host
+#define LAI_POOL_SCRATCH        0xFE
+
+#define LAI_SCRATCH_CHUNK       16384
+#define LAI_SCRATCH_CHUNKS      4
+
+#define LAI_ALLOC_TRACKED       0x0001      // preceded by a lai_alloc_record_t
+#define LAI_ALLOC_REACHABLE     0x0002      // used by lai_report_leaks()
+
+// Every block is preceded by a header that records its size class and category.
+// The header keeps the payload aligned for lai_object_t and uint64_t.
+typedef struct lai_alloc_header_t
+{
+    uint8_t size_class;
+    uint8_t category;
+    uint16_t flags;
+    uint32_t size;
+} lai_alloc_header_t;
+
+// In debug mode, host allocations are linked into a list of live objects.
+typedef struct lai_alloc_record_t
+{
+    struct lai_alloc_record_t *prev;
+    struct lai_alloc_record_t *next;
+    void *caller;
+} lai_alloc_record_t;
+
+typedef struct lai_pool_block_t
+{
+    struct lai_pool_block_t *next;
+} lai_pool_block_t;
+
+// Small strings and buffers, followed by package arrays of 1 to 16 elements.
+// lai_pool_class() picks the smallest class that fits, so the order does not matter.
+static const size_t lai_pool_class_sizes[] =
+{
+    16, 32, 64, 128, 256, 512,
+    1 * sizeof(lai_object_t),
+    2 * sizeof(lai_object_t),
+    4 * sizeof(lai_object_t),
+    8 * sizeof(lai_object_t),
+    16 * sizeof(lai_object_t),
+};
+
+#define LAI_POOL_CLASSES    (int)(sizeof(lai_pool_class_sizes) / sizeof(size_t))
+
+static lai_pool_block_t *lai_pool_free_lists[LAI_POOL_CLASSES];
+static uint8_t *lai_pool_chunk;
+static size_t lai_pool_chunk_used = LAI_POOL_CHUNK;
+
+// Scratch chunks are kept across evaluations. If all of them are full,
+// e.g. in a long-running loop, allocations fall back to the pool.
+static int lai_scratch_depth = 0;
+static uint8_t *lai_scratch_chunks[LAI_SCRATCH_CHUNKS];
+static size_t lai_scratch_current = 0;
+static size_t lai_scratch_used = 0;
+static size_t lai_scratch_objects[LAI_MEMORY_CATEGORIES];
+static size_t lai_scratch_bytes[LAI_MEMORY_CATEGORIES];
+
+static lai_memory_stats_t lai_memory_stats;
+
+// In debug mode, the pool and the scratch arena are bypassed and all allocations
+// are tracked individually.
+static int lai_memory_debug = 0;
+static lai_alloc_record_t *lai_live_objects = NULL;
+
+static const char *lai_memory_category_names[LAI_MEMORY_CATEGORIES] =
+{
+    "namespace",
+    "code",
+    "string",
+    "buffer",
+    "package",
+    "state",
+    "resource"
+};
+
+static void lai_account_alloc(int category, size_t size)
+{
+    lai_memory_stats.objects[category]++;
+    lai_memory_stats.current[category] += size;
+    if(lai_memory_stats.current[category] > lai_memory_stats.peak[category])
+        lai_memory_stats.peak[category] = lai_memory_stats.current[category];
+}
+
+static void lai_account_free(int category, size_t size)
+{
+    lai_memory_stats.objects[category]--;
+    lai_memory_stats.current[category] -= size;
+}
+
+static void lai_account_host(size_t allocated, size_t freed)
+{
+    lai_memory_stats.host_current += allocated;
+    lai_memory_stats.host_current -= freed;
+    if(lai_memory_stats.host_current > lai_memory_stats.host_peak)
+        lai_memory_stats.host_peak = lai_memory_stats.host_current;
+}
+
+// Size of the host allocation that backs a block allocated by lai_host_alloc().
+static size_t lai_host_size(lai_alloc_header_t *header)
+{
+    size_t size = sizeof(lai_alloc_header_t) + header->size;
+    if(header->flags & LAI_ALLOC_TRACKED)
+        size += sizeof(lai_alloc_record_t);
+    return size;
+}
+
+static lai_alloc_record_t *lai_record_of(lai_alloc_header_t *header)
+{
+    return (lai_alloc_record_t *)header - 1;
+}
+
+static void lai_link_record(lai_alloc_record_t *record)
+{
+    record->prev = NULL;
+    record->next = lai_live_objects;
+    if(lai_live_objects)
+        lai_live_objects->prev = record;
+    lai_live_objects = record;
+}
+
+static void lai_unlink_record(lai_alloc_record_t *record)
+{
+    if(record->prev)
+        record->prev->next = record->next;
+    else
+        lai_live_objects = record->next;
+    if(record->next)
+        record->next->prev = record->prev;
+}
+
+// lai_host_alloc(): Allocates a block directly from the host
+// Param:    size_t size - size of the allocation
+// Param:    int category - LAI_MEMORY_* category
+// Param:    void *caller - return address of the caller, for debugging
+// Return:    void * - pointer to the memory, NULL on error
+
+static void *lai_host_alloc(size_t size, int category, void *caller)
+{
+    if(size > UINT32_MAX)
+        return NULL;
+
+    lai_alloc_header_t *header;
+    if(lai_memory_debug)
+    {
+        lai_alloc_record_t *record = laihost_malloc(sizeof(lai_alloc_record_t)
+                + sizeof(lai_alloc_header_t) + size);
+        if(!record)
+            return NULL;
+        record->caller = caller;
+        lai_link_record(record);
+        header = (lai_alloc_header_t *)(record + 1);
+        header->flags = LAI_ALLOC_TRACKED;
+    }else
+    {
+        header = laihost_malloc(sizeof(lai_alloc_header_t) + size);
+        if(!header)
+            return NULL;
+        header->flags = 0;
+    }
+
+    header->size_class = LAI_POOL_HOST;
+    header->category = category;
+    header->size = size;
+    lai_account_alloc(category, size);
+    lai_account_host(lai_host_size(header), 0);
+    return header + 1;
+}
+
+// lai_host_free(): Frees a block allocated by lai_host_alloc()
+// Param:    lai_alloc_header_t *header - header of the block
+// Return:    Nothing
+
+static void lai_host_free(lai_alloc_header_t *header)
+{
+    lai_account_free(header->category, header->size);
+    lai_account_host(0, lai_host_size(header));
+
+    if(header->flags & LAI_ALLOC_TRACKED)
+    {
+        lai_alloc_record_t *record = lai_record_of(header);
+        lai_unlink_record(record);
+        laihost_free(record);
+    }else
+        laihost_free(header);
+}
+
+// lai_alloc(): Allocates memory that is not managed by the pool
+// Param:    size_t size - size of the allocation
+// Param:    int category - LAI_MEMORY_* category
+// Return:    void * - pointer to the memory, NULL on error
+
+void *lai_alloc(size_t size, int category)
+{
+    return lai_host_alloc(size, category, __builtin_return_address(0));
+}
+
+// lai_calloc(): Allocates zeroed memory that is not managed by the pool
+// Param:    size_t count - number of items
+// Param:    size_t item_size - size of each item
+// Param:    int category - LAI_MEMORY_* category
+// Return:    void * - pointer to the memory, NULL on error
+
+void *lai_calloc(size_t count, size_t item_size, int category)
+{
+    size_t size = count * item_size;
+    void *p = lai_host_alloc(size, category, __builtin_return_address(0));
+    if(p)
+        memset(p, 0, size);
+    return p;
+}
+
+// lai_realloc(): Resizes memory returned by lai_alloc()
+// Param:    void *p - pointer to the memory, may be NULL
+// Param:    size_t size - new size of the allocation
+// Param:    int category - LAI_MEMORY_* category
+// Return:    void * - pointer to the memory, NULL on error (p remains valid)
+
+void *lai_realloc(void *p, size_t size, int category)
+{
+    if(!p)
+        return lai_host_alloc(size, category, __builtin_return_address(0));
+    if(size > UINT32_MAX)
+        return NULL;
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    if(header->size_class != LAI_POOL_HOST)
+        lai_panic("lai_realloc() on a pool block %p\n", p);
+
+    size_t old_size = header->size;
+    size_t old_host_size = lai_host_size(header);
+
+    if(header->flags & LAI_ALLOC_TRACKED)
+    {
+        // The record moves, so it has to be relinked.
+        lai_alloc_record_t *record = lai_record_of(header);
+        lai_unlink_record(record);
+        lai_alloc_record_t *new_record = laihost_realloc(record, sizeof(lai_alloc_record_t)
+                + sizeof(lai_alloc_header_t) + size);
+        if(new_record)
+            record = new_record;
+        lai_link_record(record);
+        if(!new_record)
+            return NULL;
+        header = (lai_alloc_header_t *)(record + 1);
+    }else
+    {
+        lai_alloc_header_t *new_header = laihost_realloc(header, sizeof(lai_alloc_header_t) + size);
+        if(!new_header)
+            return NULL;
+        header = new_header;
+    }
+
+    header->size = size;
+    lai_account_free(header->category, old_size);
+    lai_account_alloc(header->category, size);
+    lai_account_host(lai_host_size(header), old_host_size);
+    return header + 1;
+}
+
+// lai_free(): Frees memory returned by lai_alloc(), lai_calloc() or lai_realloc()
+// Param:    void *p - pointer to the memory, may be NULL
+// Return:    Nothing
+
+void lai_free(void *p)
+{
+    if(!p)
+        return;
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    if(header->size_class != LAI_POOL_HOST)
+        lai_panic("lai_free() on a pool block %p\n", p);
+    lai_host_free(header);
+}
+
+// lai_pool_class(): Finds the size class of an allocation
+// Param:    size_t size - size of the allocation
+// Return:    int - index into lai_pool_class_sizes, LAI_POOL_HOST if none fits
+
+static int lai_pool_class(size_t size)
+{
+    int best = LAI_POOL_HOST;
+    for(int i = 0; i < LAI_POOL_CLASSES; i++)
+    {
+        if(lai_pool_class_sizes[i] < size)
+            continue;
+        if(best == LAI_POOL_HOST || lai_pool_class_sizes[i] < lai_pool_class_sizes[best])
+            best = i;
+    }
+
+    return best;
+}
+
+// lai_pool_carve(): Carves a new block from the current chunk
+// Param:    int size_class - size class of the block
+// Return:    lai_alloc_header_t * - header of the new block, NULL on error
+
+static lai_alloc_header_t *lai_pool_carve(int size_class)
+{
+    size_t block_size = sizeof(lai_alloc_header_t) + lai_pool_class_sizes[size_class];
+    block_size = (block_size + 7) & ~(size_t)7;
+
+    if(lai_pool_chunk_used + block_size > LAI_POOL_CHUNK)
+    {
+        // The rest of the old chunk is simply abandoned; chunks are never returned.
+        lai_pool_chunk = laihost_malloc(LAI_POOL_CHUNK);
+        if(!lai_pool_chunk)
+            return NULL;
+        lai_pool_chunk_used = 0;
+        lai_account_host(LAI_POOL_CHUNK, 0);
+    }
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)(lai_pool_chunk + lai_pool_chunk_used);
+    lai_pool_chunk_used += block_size;
+    return header;
+}
+
+// lai_scratch_alloc(): Allocates memory from the scratch arena
+// Param:    size_t size - size of the allocation
+// Return:    lai_alloc_header_t * - header of the new block, NULL if the arena is full
+
+static lai_alloc_header_t *lai_scratch_alloc(size_t size)
+{
+    size_t block_size = (sizeof(lai_alloc_header_t) + size + 7) & ~(size_t)7;
+    if(block_size > LAI_SCRATCH_CHUNK)
+        return NULL;
+
+    if(lai_scratch_used + block_size > LAI_SCRATCH_CHUNK)
+    {
+        if(lai_scratch_current + 1 == LAI_SCRATCH_CHUNKS)
+            return NULL;
+        lai_scratch_current++;
+        lai_scratch_used = 0;
+    }
+
+    if(!lai_scratch_chunks[lai_scratch_current])
+    {
+        lai_scratch_chunks[lai_scratch_current] = laihost_malloc(LAI_SCRATCH_CHUNK);
+        if(!lai_scratch_chunks[lai_scratch_current])
+            return NULL;
+        lai_account_host(LAI_SCRATCH_CHUNK, 0);
+    }
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)(lai_scratch_chunks[lai_scratch_current]
+            + lai_scratch_used);
+    lai_scratch_used += block_size;
+    return header;
+}
+
+// lai_scratch_begin(): Called when a control method starts executing
+// Return:    int - 1 if this is the outermost method
+
+int lai_scratch_begin(void)
+{
+    return !lai_scratch_depth++;
+}
+
+// lai_scratch_is_active(): Checks whether a control method uses the scratch arena
+// Return:    int - 1 if allocations are served from the arena
+
+int lai_scratch_is_active(void)
+{
+    return lai_scratch_depth != 0;
+}
+
+// lai_scratch_end(): Called when a control method finishes; releases all scratch
+//                    memory once the outermost method is done
+// Return:    Nothing
+
+void lai_scratch_end(void)
+{
+    if(!lai_scratch_depth)
+        lai_panic("unbalanced lai_scratch_end()\n");
+
+    lai_scratch_depth--;
+    if(lai_scratch_depth)
+        return;
+
+    lai_scratch_current = 0;
+    lai_scratch_used = 0;
+    for(int i = 0; i < LAI_MEMORY_CATEGORIES; i++)
+    {
+        lai_memory_stats.objects[i] -= lai_scratch_objects[i];
+        lai_memory_stats.current[i] -= lai_scratch_bytes[i];
+        lai_scratch_objects[i] = 0;
+        lai_scratch_bytes[i] = 0;
+    }
+}
+
+// lai_heap_alloc(): Allocates memory from the pool or the host
+// Param:    size_t size - size of the allocation
+// Param:    int category - LAI_MEMORY_* category
+// Param:    void *caller - return address of the caller, for debugging
+// Return:    void * - pointer to the memory, NULL on error
+
+static void *lai_heap_alloc(size_t size, int category, void *caller)
+{
+    int size_class = lai_pool_class(size);
+    if(lai_memory_debug || size_class == LAI_POOL_HOST)
+        return lai_host_alloc(size, category, caller);
+
+    lai_alloc_header_t *header;
+    if(lai_pool_free_lists[size_class])
+    {
+        lai_pool_block_t *block = lai_pool_free_lists[size_class];
+        lai_pool_free_lists[size_class] = block->next;
+        header = (lai_alloc_header_t *)block - 1;
+    }else
+    {
+        header = lai_pool_carve(size_class);
+        if(!header)
+            return NULL;
+    }
+
+    header->size_class = size_class;
+    header->category = category;
+    header->flags = 0;
+    header->size = size;
+    lai_account_alloc(category, size);
+    return header + 1;
+}
+
+// lai_pool_alloc(): Allocates memory for the storage of an object
+// Param:    size_t size - size of the allocation
+// Param:    int category - LAI_MEMORY_* category
+// Return:    void * - pointer to the memory, NULL on error
+
+void *lai_pool_alloc(size_t size, int category)
+{
+    if(lai_scratch_depth && !lai_memory_debug)
+    {
+        lai_alloc_header_t *header = lai_scratch_alloc(size);
+        if(header)
+        {
+            header->size_class = LAI_POOL_SCRATCH;
+            header->category = category;
+            header->flags = 0;
+            header->size = size;
+            lai_account_alloc(category, size);
+            lai_scratch_objects[category]++;
+            lai_scratch_bytes[category] += size;
+            return header + 1;
+        }
+    }
+
+    return lai_heap_alloc(size, category, __builtin_return_address(0));
+}
+
+// lai_pool_calloc(): Allocates zeroed memory for the storage of an object
+// Param:    size_t count - number of items
+// Param:    size_t item_size - size of each item
+// Param:    int category - LAI_MEMORY_* category
+// Return:    void * - pointer to the memory, NULL on error
+
+void *lai_pool_calloc(size_t count, size_t item_size, int category)
+{
+    size_t size = count * item_size;
+    void *p = lai_pool_alloc(size, category);
+    if(p)
+        memset(p, 0, size);
+    return p;
+}
+
+// lai_pool_free(): Frees memory returned by lai_pool_alloc()
+// Param:    void *p - pointer to the memory, may be NULL
+// Return:    Nothing
+
+void lai_pool_free(void *p)
+{
+    if(!p)
+        return;
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    if(header->size_class == LAI_POOL_HOST)
+    {
+        lai_host_free(header);
+        return;
+    }else if(header->size_class == LAI_POOL_SCRATCH)
+        return;        // released by lai_scratch_end()
+
+    if(header->size_class >= LAI_POOL_CLASSES)
+        lai_panic("lai_pool_free() on a corrupted block %p\n", p);
+
+    lai_account_free(header->category, header->size);
+
+    lai_pool_block_t *block = p;
+    block->next = lai_pool_free_lists[header->size_class];
+    lai_pool_free_lists[header->size_class] = block;
+}
+
+// lai_pool_promote(): Moves memory out of the scratch arena
+// Param:    void *p - pointer to the memory, may be NULL
+// Return:    void * - p if it is not scratch memory, otherwise a copy of it
+
+void *lai_pool_promote(void *p)
+{
+    if(!p)
+        return NULL;
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    if(header->size_class != LAI_POOL_SCRATCH)
+        return p;
+
+    void *copy = lai_heap_alloc(header->size, header->category, __builtin_return_address(0));
+    if(!copy)
+        lai_panic("unable to allocate memory for object.\n");
+    memcpy(copy, p, header->size);
+    return copy;
+}
+
+// lai_pool_is_scratch(): Checks whether memory belongs to the scratch arena
+// Param:    void *p - pointer to the memory
+// Return:    int - 1 if p is scratch memory
+
+int lai_pool_is_scratch(void *p)
+{
+    if(!p)
+        return 0;
+
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    return header->size_class == LAI_POOL_SCRATCH;
+}
+
+// lai_get_memory_stats(): Returns the memory usage of LAI
+// Param:    lai_memory_stats_t *stats - destination
+// Return:    Nothing
+
+void lai_get_memory_stats(lai_memory_stats_t *stats)
+{
+    *stats = lai_memory_stats;
+}
+
+// lai_enable_memory_debug(): Tracks all allocations individually, so that
+//                            lai_report_leaks() can list them. Must be called
+//                            before lai_create_namespace().
+// Return:    Nothing
+
+void lai_enable_memory_debug(void)
+{
+    lai_memory_debug = 1;
+}
+
+// lai_mark_reachable(): Marks the storage of an object as reachable
+// Param:    lai_object_t *object - object
+// Return:    Nothing
+
+static void lai_mark_reachable(lai_object_t *object)
+{
+    void *p;
+    if(object->borrowed)
+        return;
+    else if(object->type == LAI_STRING)
+        p = object->string;
+    else if(object->type == LAI_BUFFER)
+        p = object->buffer;
+    else if(object->type == LAI_PACKAGE)
+        p = object->package;
+    else
+        return;
+
+    if(!p)
+        return;
+    lai_alloc_header_t *header = (lai_alloc_header_t *)p - 1;
+    header->flags |= LAI_ALLOC_REACHABLE;
+
+    if(object->type == LAI_PACKAGE)
+    {
+        for(int i = 0; i < object->package_size; i++)
+            lai_mark_reachable(&object->package[i]);
+    }
+}
+
+// lai_report_leaks(): Logs the memory usage and, in debug mode, all objects
+//                     that are neither owned by the namespace nor by the interpreter
+// Return:    size_t - number of leaked objects
+
+size_t lai_report_leaks(void)
+{
+    for(int i = 0; i < LAI_MEMORY_CATEGORIES; i++)
+        lai_debug("memory: %d %s objects, %d bytes, peak %d bytes\n",
+                (int)lai_memory_stats.objects[i], lai_memory_category_names[i],
+                (int)lai_memory_stats.current[i], (int)lai_memory_stats.peak[i]);
+
+    if(!lai_memory_debug)
+        return 0;
+
+    // Objects stored in Name()s are expected to be live.
+    for(size_t i = 0; i < lai_ns_size; i++)
+    {
+        if(lai_namespace[i]->type == LAI_NAMESPACE_NAME)
+            lai_mark_reachable(&lai_namespace[i]->object);
+    }
+
+    size_t leaks = 0;
+    for(lai_alloc_record_t *record = lai_live_objects; record; record = record->next)
+    {
+        lai_alloc_header_t *header = (lai_alloc_header_t *)(record + 1);
+        int reachable = header->flags & LAI_ALLOC_REACHABLE;
+        header->flags &= ~LAI_ALLOC_REACHABLE;
+
+        // The namespace, the code and the interpreter state live forever.
+        if(header->category == LAI_MEMORY_NAMESPACE || header->category == LAI_MEMORY_CODE
+                || header->category == LAI_MEMORY_STATE || reachable)
+            continue;
+
+        lai_warn("leaked %s object %p (%d bytes), allocated from %p\n",
+                lai_memory_category_names[header->category], header + 1,
+                (int)header->size, record->caller);
+        leaks++;
+    }
+
+    return leaks;
+}
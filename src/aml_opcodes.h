@@ -20,6 +20,7 @@
 #define PACKAGE_OP			0x12
 #define VARPACKAGE_OP			0x13
 #define METHOD_OP			0x14
+#define EXTERNAL_OP			0x15
 #define DUAL_PREFIX			0x2E
 #define MULTI_PREFIX			0x2F
 #define EXTOP_PREFIX			0x5B
@@ -41,7 +42,9 @@
 #define ARG5_OP				0x6D
 #define ARG6_OP				0x6E
 #define STORE_OP			0x70
+#define REFOF_OP			0x71
 #define ADD_OP				0x72
+#define CONCAT_OP			0x73
 #define SUBTRACT_OP			0x74
 #define INCREMENT_OP			0x75
 #define DECREMENT_OP			0x76
@@ -50,16 +53,25 @@
 #define SHL_OP				0x79
 #define SHR_OP				0x7A
 #define AND_OP				0x7B
+#define NAND_OP				0x7C
 #define OR_OP				0x7D
+#define NOR_OP				0x7E
 #define XOR_OP				0x7F
 #define NOT_OP				0x80
+#define FINDSETLEFTBIT_OP		0x81
+#define FINDSETRIGHTBIT_OP		0x82
 #define DEREF_OP			0x83
+#define CONCATRES_OP			0x84
+#define MOD_OP				0x85
+#define NOTIFY_OP			0x86
 #define SIZEOF_OP			0x87
 #define INDEX_OP			0x88
+#define MATCH_OP			0x89
 #define DWORDFIELD_OP			0x8A
 #define WORDFIELD_OP			0x8B
 #define BYTEFIELD_OP			0x8C
 #define BITFIELD_OP			0x8D
+#define OBJECTTYPE_OP			0x8E
 #define QWORDFIELD_OP			0x8F
 #define LAND_OP				0x90
 #define LOR_OP				0x91
@@ -67,6 +79,13 @@
 #define LEQUAL_OP			0x93
 #define LGREATER_OP			0x94
 #define LLESS_OP			0x95
+#define TOBUFFER_OP			0x96
+#define TODECIMALSTRING_OP		0x97
+#define TOHEXSTRING_OP			0x98
+#define TOINTEGER_OP			0x99
+#define TOSTRING_OP			0x9C
+#define COPYOBJECT_OP			0x9D
+#define MID_OP				0x9E
 #define CONTINUE_OP			0x9F
 #define IF_OP				0xA0
 #define ELSE_OP				0xA1
@@ -74,20 +93,39 @@
 #define NOP_OP				0xA3
 #define RETURN_OP			0xA4
 #define BREAK_OP			0xA5
+#define BREAKPOINT_OP			0xCC
 #define ONES_OP				0xFF
 
 // Extended opcodes
 #define MUTEX				0x01
+#define EVENT				0x02
 #define CONDREF_OP			0x12
 #define ARBFIELD_OP			0x13
+#define LOADTABLE_OP			0x1F
+#define LOAD_OP				0x20
+#define STALL_OP			0x21
 #define SLEEP_OP			0x22
+#define ACQUIRE_OP			0x23
+#define SIGNAL_OP			0x24
+#define WAIT_OP				0x25
+#define RESET_OP			0x26
+#define RELEASE_OP			0x27
+#define FROMBCD_OP			0x28
+#define TOBCD_OP			0x29
+#define UNLOAD_OP			0x2A
+#define REVISION_OP			0x30
 #define DEBUG_OP			0x31
+#define FATAL_OP			0x32
+#define TIMER_OP			0x33
 #define OPREGION			0x80
 #define FIELD				0x81
 #define DEVICE				0x82
 #define PROCESSOR			0x83
+#define POWERRES			0x84
 #define THERMALZONE			0x85
 #define INDEXFIELD			0x86	// ACPI spec v5.0 section 19.5.60
+#define BANKFIELD			0x87
+#define DATAREGION			0x88
 
 // OpRegion Address Spaces
 #define OPREGION_MEMORY			0x00
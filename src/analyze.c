@@ -0,0 +1,625 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Static Analysis of Control Methods */
+/* Once the namespace is created, the body of each method is walked once, without
+ * executing it. The results (see lai_method_info_t) let the interpreter skip work
+ * that a method cannot need. Method invocations are recognized by resolving names,
+ * like the interpreter does; a method that refers to names that do not exist yet
+ * or that contains opcodes that are not understood here is left unanalyzed.
+ *
+ * The walk also checks that the body parses exactly as the interpreter will parse
+ * it, including the arguments of invocations, which the table verifier (verify.c)
+ * only knows from the declarations in the tables. Such methods run without bounds
+ * checks, as long as the namespace does not change; see lai_reanalyze_method(). */
+
+#include <lai/core.h>
+#include "aml_opcodes.h"
+#include "libc.h"
+#include "ns_impl.h"
+#include "exec_impl.h"
+#include "eval.h"
+#include "analyze.h"
+
+// How the analyzer treats names, similar to the LAI_*_MODE of the interpreter.
+#define LAI_ANALYZE_LOAD        1    // names are loaded or invoked
+#define LAI_ANALYZE_STORE       2    // names are stored to
+#define LAI_ANALYZE_REFERENCE   3    // names are only referred to
+#define LAI_ANALYZE_DEFINE      4    // names are created, or replaced if they exist
+
+// Names that a method creates itself, e.g. the CreateDWordField()s of a _CRS.
+#define LAI_ANALYZE_DEFINED     32
+
+typedef struct lai_analysis_t
+{
+    lai_nsnode_t *method;
+    uint8_t *code;
+    size_t limit;
+    lai_method_info_t info;
+
+    // Positions of the NameStrings of names that are created by the method.
+    size_t defined[LAI_ANALYZE_DEFINED];
+    int defined_count;
+} lai_analysis_t;
+
+static int lai_analyze_term(lai_analysis_t *, size_t *, int, int);
+
+// Set once every Name() was made mutable, until lai_analyze_namespace() runs again.
+// Names created afterwards are mutable from the start.
+static int lai_analyze_all_mutable;
+
+// lai_analyze_region(): Records the OpRegion behind a field
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    lai_nsnode_t *field - Field() or IndexField()
+// Return:   Nothing
+
+static void lai_analyze_region(lai_analysis_t *analysis, lai_nsnode_t *field)
+{
+    analysis->info.flags |= LAI_METHOD_INFO_HARDWARE;
+
+    if(field->type == LAI_NAMESPACE_INDEXFIELD)
+    {
+        // Both the index and the data register are accessed.
+        lai_nsnode_t *index = lai_resolve(field->indexfield_index);
+        lai_nsnode_t *data = lai_resolve(field->indexfield_data);
+        if(index && index->type == LAI_NAMESPACE_FIELD)
+            lai_analyze_region(analysis, index);
+        if(data && data->type == LAI_NAMESPACE_FIELD)
+            lai_analyze_region(analysis, data);
+        return;
+    }
+
+    lai_nsnode_t *region = lai_resolve(field->field_opregion);
+    if(!region)
+        return;
+
+    int i;
+    for(i = 0; i < LAI_METHOD_INFO_REGIONS && analysis->info.regions[i]; i++)
+    {
+        if(analysis->info.regions[i] == region)
+            return;
+    }
+    if(i == LAI_METHOD_INFO_REGIONS)
+        analysis->info.flags |= LAI_METHOD_INFO_MANY_REGIONS;
+    else
+        analysis->info.regions[i] = region;
+}
+
+// lai_analyze_indirect(): Records an access through a reference, e.g. DerefOf(Arg0)
+//                         where the caller passed RefOf() of a field
+// Param:    lai_analysis_t *analysis - analysis
+// Return:   Nothing
+
+static void lai_analyze_indirect(lai_analysis_t *analysis)
+{
+    // The OpRegion is only known when the method runs.
+    analysis->info.flags |= LAI_METHOD_INFO_HARDWARE | LAI_METHOD_INFO_MANY_REGIONS;
+}
+
+// lai_analyze_write(): Records that a node is stored to
+// Param:    lai_nsnode_t *node - node
+// Return:   Nothing
+
+static void lai_analyze_write(lai_nsnode_t *node)
+{
+    // Buffer fields write into the storage of their Buffer(), unless it is an ArgX or LocalX.
+    if(node->type == LAI_NAMESPACE_BUFFER_FIELD)
+        node = node->buffer[0] ? lai_resolve(node->buffer) : NULL;
+    if(node && node->type == LAI_NAMESPACE_NAME)
+        node->object_immutable = 0;
+}
+
+// lai_analyze_is_defined(): Checks whether a name is created earlier in the method
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t name_pc - position of the NameString
+// Return:   int - 1 if an earlier term of the method creates the name
+
+static int lai_analyze_is_defined(lai_analysis_t *analysis, size_t name_pc)
+{
+    char path[ACPI_MAX_NAME];
+    char defined[ACPI_MAX_NAME];
+    lai_resolve_path(analysis->method, path, analysis->code + name_pc);
+    for(int i = 0; i < analysis->defined_count; i++)
+    {
+        lai_resolve_path(analysis->method, defined, analysis->code + analysis->defined[i]);
+        if(!lai_strcmp(defined, path))
+            return 1;
+    }
+    return 0;
+}
+
+// lai_analyze_name(): Analyzes a NameString, including the arguments of invocations
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t *pc - position of the name, advanced past it
+// Param:    int depth - depth of the name
+// Param:    int mode - LAI_ANALYZE_*
+// Return:   int - 0 on success
+
+static int lai_analyze_name(lai_analysis_t *analysis, size_t *pc, int depth, int mode)
+{
+    char path[ACPI_MAX_NAME];
+    size_t name_pc = *pc;
+    *pc += lai_resolve_path(analysis->method, path, analysis->code + *pc);
+    if(mode == LAI_ANALYZE_REFERENCE)
+        return 0;
+
+    lai_nsnode_t *handle;
+    if(mode == LAI_ANALYZE_DEFINE)
+    {
+        // Later terms can refer to the name, although it does not exist yet.
+        if(analysis->defined_count < LAI_ANALYZE_DEFINED)
+            analysis->defined[analysis->defined_count++] = name_pc;
+
+        // Same lookup as lai_exec_name().
+        handle = lai_resolve(path);
+        if(handle)
+            lai_analyze_write(handle);
+        return 0;
+    }
+
+    handle = lai_exec_resolve(path);
+    if(!handle)
+    {
+        // Names created by the method are not methods, so they take no arguments.
+        // As they are not in the namespace yet, none of the flags apply. The search
+        // of lai_exec_resolve() has shortened the path, so it is resolved again.
+        return !lai_analyze_is_defined(analysis, name_pc);
+    }
+
+    if(handle->type == LAI_NAMESPACE_FIELD || handle->type == LAI_NAMESPACE_INDEXFIELD)
+        lai_analyze_region(analysis, handle);
+
+    if(mode == LAI_ANALYZE_STORE)
+    {
+        analysis->info.flags |= LAI_METHOD_INFO_STORES_GLOBAL;
+        lai_analyze_write(handle);
+        return 0;
+    }
+
+    if(handle->type == LAI_NAMESPACE_METHOD)
+    {
+        analysis->info.flags |= LAI_METHOD_INFO_CALLS;
+        int argc = handle->method_flags & METHOD_ARGC_MASK;
+        for(int i = 0; i < argc; i++)
+        {
+            if(lai_analyze_term(analysis, pc, depth + 1, LAI_ANALYZE_LOAD))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+// lai_analyze_operands(): Analyzes the operands of an opcode
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t *pc - position of the first operand, advanced past the last one
+// Param:    int depth - depth of the opcode
+// Param:    const int *modes - LAI_ANALYZE_* of each operand, terminated by zero
+// Return:   int - 0 on success
+
+static int lai_analyze_operands(lai_analysis_t *analysis, size_t *pc, int depth, const int *modes)
+{
+    for(int i = 0; modes[i]; i++)
+    {
+        if(lai_analyze_term(analysis, pc, depth + 1, modes[i]))
+            return 1;
+    }
+    return 0;
+}
+
+// lai_analyze_block(): Analyzes a list of statements
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t *pc - position of the first statement, advanced to end
+// Param:    size_t end - end of the list
+// Return:   int - 0 on success
+
+static int lai_analyze_block(lai_analysis_t *analysis, size_t *pc, size_t end)
+{
+    if(end > analysis->limit)
+        return 1;
+    while(*pc < end)
+    {
+        if(lai_analyze_term(analysis, pc, 0, LAI_ANALYZE_LOAD))
+            return 1;
+    }
+    return *pc != end;
+}
+
+// lai_analyze_end(): Parses a PkgLength
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t *pc - position of the PkgLength, advanced past it
+// Param:    size_t opcode_pc - position of the opcode
+// Param:    size_t opcode_size - size of the opcode, 1 or 2
+// Return:   size_t - end of the object
+
+static size_t lai_analyze_end(lai_analysis_t *analysis, size_t *pc, size_t opcode_pc,
+        size_t opcode_size)
+{
+    size_t encoded_size;
+    *pc += lai_parse_pkgsize(analysis->code + *pc, &encoded_size);
+    return opcode_pc + opcode_size + encoded_size;
+}
+
+// lai_analyze_term(): Analyzes a single term
+// Param:    lai_analysis_t *analysis - analysis
+// Param:    size_t *pc - position of the term, advanced past it
+// Param:    int depth - depth of the term, 0 for statements
+// Param:    int mode - LAI_ANALYZE_*
+// Return:   int - 0 on success
+
+static int lai_analyze_term(lai_analysis_t *analysis, size_t *pc, int depth, int mode)
+{
+    static const int load[] = {LAI_ANALYZE_LOAD, 0};
+    static const int load_store[] = {LAI_ANALYZE_LOAD, LAI_ANALYZE_STORE, 0};
+    static const int load_load[] = {LAI_ANALYZE_LOAD, LAI_ANALYZE_LOAD, 0};
+    static const int load_load_store[] = {LAI_ANALYZE_LOAD, LAI_ANALYZE_LOAD,
+            LAI_ANALYZE_STORE, 0};
+    static const int divide[] = {LAI_ANALYZE_LOAD, LAI_ANALYZE_LOAD,
+            LAI_ANALYZE_STORE, LAI_ANALYZE_STORE, 0};
+    static const int store[] = {LAI_ANALYZE_STORE, 0};
+    static const int reference_load[] = {LAI_ANALYZE_REFERENCE, LAI_ANALYZE_LOAD, 0};
+    static const int reference_store[] = {LAI_ANALYZE_REFERENCE, LAI_ANALYZE_STORE, 0};
+
+    uint8_t *code = analysis->code;
+    size_t opcode_pc = *pc;
+    if(opcode_pc >= analysis->limit)
+        return 1;
+    if(depth > analysis->info.max_depth)
+        analysis->info.max_depth = depth > 255 ? 255 : depth;
+
+    if(lai_is_name(code[opcode_pc]))
+        return lai_analyze_name(analysis, pc, depth, mode);
+
+    uint64_t integer;
+    size_t integer_size = lai_eval_integer(code + opcode_pc, &integer);
+    if(integer_size)
+    {
+        *pc += integer_size;
+        return 0;
+    }
+
+    int opcode = code[opcode_pc];
+    if(opcode == EXTOP_PREFIX)
+    {
+        if(opcode_pc + 1 == analysis->limit)
+            return 1;
+        opcode = (EXTOP_PREFIX << 8) | code[opcode_pc + 1];
+    }
+
+    switch(opcode)
+    {
+    case NOP_OP:
+    case CONTINUE_OP:
+    case BREAK_OP:
+        *pc += 1;
+        return 0;
+    case (EXTOP_PREFIX << 8) | DEBUG_OP:
+        *pc += 2;
+        return 0;
+
+    case LOCAL0_OP: case LOCAL1_OP: case LOCAL2_OP: case LOCAL3_OP:
+    case LOCAL4_OP: case LOCAL5_OP: case LOCAL6_OP: case LOCAL7_OP:
+        if(opcode - LOCAL0_OP > analysis->info.max_local)
+            analysis->info.max_local = opcode - LOCAL0_OP;
+        *pc += 1;
+        return 0;
+    case ARG0_OP: case ARG1_OP: case ARG2_OP: case ARG3_OP:
+    case ARG4_OP: case ARG5_OP: case ARG6_OP:
+        if(opcode - ARG0_OP > analysis->info.max_arg)
+            analysis->info.max_arg = opcode - ARG0_OP;
+        // An ArgX can hold a reference that the store writes through.
+        if(mode == LAI_ANALYZE_STORE)
+            lai_analyze_indirect(analysis);
+        *pc += 1;
+        return 0;
+
+    case STRINGPREFIX:
+    {
+        size_t n = 1;
+        while(opcode_pc + n < analysis->limit && code[opcode_pc + n])
+            n++;
+        if(opcode_pc + n == analysis->limit)
+            return 1;
+        *pc += n + 1;
+        return 0;
+    }
+    case BUFFER_OP:
+    {
+        *pc += 1;
+        size_t end = lai_analyze_end(analysis, pc, opcode_pc, 1);
+        if(lai_analyze_operands(analysis, pc, depth, load) || *pc > end || end > analysis->limit)
+            return 1;
+        *pc = end;
+        return 0;
+    }
+    case PACKAGE_OP:
+    {
+        // Elements are parsed in LAI_DATA_MODE; names are not resolved.
+        *pc += 1;
+        size_t end = lai_analyze_end(analysis, pc, opcode_pc, 1);
+        *pc += 1;
+        while(*pc < end)
+        {
+            if(lai_analyze_term(analysis, pc, depth + 1, LAI_ANALYZE_REFERENCE))
+                return 1;
+        }
+        return *pc != end;
+    }
+
+    case (EXTOP_PREFIX << 8) | SLEEP_OP:
+    case (EXTOP_PREFIX << 8) | STALL_OP:
+        analysis->info.flags |= LAI_METHOD_INFO_BLOCKS;
+        *pc += 2;
+        return lai_analyze_operands(analysis, pc, depth, load);
+    case (EXTOP_PREFIX << 8) | ACQUIRE_OP:
+    {
+        static const int reference[] = {LAI_ANALYZE_REFERENCE, 0};
+        analysis->info.flags |= LAI_METHOD_INFO_BLOCKS;
+        *pc += 2;
+        if(lai_analyze_operands(analysis, pc, depth, reference))
+            return 1;
+        *pc += 2;   // Timeout
+        return 0;
+    }
+    case (EXTOP_PREFIX << 8) | WAIT_OP:
+        analysis->info.flags |= LAI_METHOD_INFO_BLOCKS;
+        *pc += 2;
+        return lai_analyze_operands(analysis, pc, depth, reference_load);
+
+    case RETURN_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, load);
+    case WHILE_OP:
+    case IF_OP:
+    {
+        *pc += 1;
+        size_t end = lai_analyze_end(analysis, pc, opcode_pc, 1);
+        if(lai_analyze_operands(analysis, pc, depth, load))
+            return 1;
+        return lai_analyze_block(analysis, pc, end);
+    }
+    case ELSE_OP:
+    {
+        *pc += 1;
+        size_t end = lai_analyze_end(analysis, pc, opcode_pc, 1);
+        return lai_analyze_block(analysis, pc, end);
+    }
+
+    case STORE_OP:
+    case NOT_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, load_store);
+    case ADD_OP:
+    case SUBTRACT_OP:
+    case MULTIPLY_OP:
+    case AND_OP:
+    case OR_OP:
+    case XOR_OP:
+    case SHR_OP:
+    case SHL_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, load_load_store);
+    case DIVIDE_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, divide);
+    case INCREMENT_OP:
+    case DECREMENT_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, store);
+    case DEREF_OP:
+        // Only DerefOf(Index()) is known not to load through a reference to a field.
+        *pc += 1;
+        if(*pc < analysis->limit && code[*pc] != INDEX_OP)
+            lai_analyze_indirect(analysis);
+        return lai_analyze_operands(analysis, pc, depth, load);
+    case LNOT_OP:
+    case SIZEOF_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, load);
+    case LAND_OP:
+    case LOR_OP:
+    case LEQUAL_OP:
+    case LLESS_OP:
+    case LGREATER_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, load_load);
+    case INDEX_OP:
+    {
+        // The reference that is created can be stored through.
+        static const int index[] = {LAI_ANALYZE_STORE, LAI_ANALYZE_LOAD, LAI_ANALYZE_STORE, 0};
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, index);
+    }
+    case NOTIFY_OP:
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, reference_load);
+    case (EXTOP_PREFIX << 8) | CONDREF_OP:
+        *pc += 2;
+        return lai_analyze_operands(analysis, pc, depth, reference_store);
+
+    // Named objects.
+    case NAME_OP:
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 1;
+        if(lai_analyze_term(analysis, pc, depth + 1, LAI_ANALYZE_DEFINE))
+            return 1;
+        return lai_analyze_operands(analysis, pc, depth, load);
+    case BITFIELD_OP:
+    case BYTEFIELD_OP:
+    case WORDFIELD_OP:
+    case DWORDFIELD_OP:
+    case QWORDFIELD_OP:
+    {
+        // Stores to the field modify the Buffer() operand.
+        static const int field[] = {LAI_ANALYZE_STORE, LAI_ANALYZE_LOAD,
+                LAI_ANALYZE_DEFINE, 0};
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, field);
+    }
+    case (EXTOP_PREFIX << 8) | ARBFIELD_OP:
+    {
+        static const int field[] = {LAI_ANALYZE_STORE, LAI_ANALYZE_LOAD, LAI_ANALYZE_LOAD,
+                LAI_ANALYZE_DEFINE, 0};
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 2;
+        return lai_analyze_operands(analysis, pc, depth, field);
+    }
+    case ALIAS_OP:
+    {
+        static const int names[] = {LAI_ANALYZE_REFERENCE, LAI_ANALYZE_REFERENCE, 0};
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 1;
+        return lai_analyze_operands(analysis, pc, depth, names);
+    }
+    case (EXTOP_PREFIX << 8) | MUTEX:
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 2;
+        if(lai_analyze_term(analysis, pc, depth + 1, LAI_ANALYZE_REFERENCE))
+            return 1;
+        *pc += 1;   // SyncFlags
+        return 0;
+    case (EXTOP_PREFIX << 8) | OPREGION:
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 2;
+        if(lai_analyze_term(analysis, pc, depth + 1, LAI_ANALYZE_REFERENCE))
+            return 1;
+        *pc += 1;   // RegionSpace
+        return lai_analyze_operands(analysis, pc, depth, load_load);
+    case SCOPE_OP:
+    case METHOD_OP:
+    {
+        // The contents are not part of this method.
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 1;
+        *pc = lai_analyze_end(analysis, pc, opcode_pc, 1);
+        return *pc > analysis->limit;
+    }
+    case (EXTOP_PREFIX << 8) | FIELD:
+    case (EXTOP_PREFIX << 8) | INDEXFIELD:
+    case (EXTOP_PREFIX << 8) | DEVICE:
+    case (EXTOP_PREFIX << 8) | PROCESSOR:
+    case (EXTOP_PREFIX << 8) | THERMALZONE:
+        analysis->info.flags |= LAI_METHOD_INFO_CREATES;
+        *pc += 2;
+        *pc = lai_analyze_end(analysis, pc, opcode_pc, 2);
+        return *pc > analysis->limit;
+
+    default:
+        return 1;
+    }
+}
+
+// lai_analyze_method(): Collects the lai_method_info_t of a method
+// Param:    lai_nsnode_t *method - method
+// Return:   Nothing
+
+void lai_analyze_method(lai_nsnode_t *method)
+{
+    memset(&method->method_info, 0, sizeof(lai_method_info_t));
+    method->method_info.ns_size = lai_ns_size;
+    if(method->method_override)
+        return;
+
+    lai_analysis_t analysis = {0};
+    analysis.method = method;
+    analysis.code = method->pointer;
+    analysis.limit = method->size;
+    analysis.info.max_local = -1;
+    analysis.info.max_arg = -1;
+    analysis.info.ns_size = lai_ns_size;
+
+    size_t pc = 0;
+    if(lai_analyze_block(&analysis, &pc, method->size))
+        return;
+
+    method->method_info = analysis.info;
+    method->method_info.flags |= LAI_METHOD_INFO_ANALYZED;
+
+    // Names that are created while the method runs can change how the rest of the
+    // body is parsed. Besides the method itself, other threads can create them
+    // whenever the interpreter lock is dropped, i.e. while the method sleeps or
+    // accesses an OpRegion.
+    if(!(analysis.info.flags & (LAI_METHOD_INFO_CREATES | LAI_METHOD_INFO_BLOCKS
+            | LAI_METHOD_INFO_HARDWARE)))
+        method->method_info.flags |= LAI_METHOD_INFO_VERIFIED;
+}
+
+// lai_analyze_unknown_stores(): Makes all Name()s mutable, as a method with unknown
+//                               stores was found
+// Return:   Nothing
+
+static void lai_analyze_unknown_stores(void)
+{
+    if(lai_analyze_all_mutable)
+        return;
+
+    for(size_t i = 0; i < lai_ns_size; i++)
+        lai_namespace[i]->object_immutable = 0;
+    lai_analyze_all_mutable = 1;
+}
+
+// lai_reanalyze_method(): Repeats the analysis of a method if names were created since
+// Param:    lai_nsnode_t *method - method
+// Return:   Nothing
+
+void lai_reanalyze_method(lai_nsnode_t *method)
+{
+    // lai_analyze_method() records the namespace size even if the analysis fails,
+    // so this runs at most once per namespace change.
+    if(method->method_info.ns_size == lai_ns_size)
+        return;
+
+    // Other names can now be resolved, including new methods with arguments.
+    lai_analyze_method(method);
+    if(method->method_override || (method->method_info.flags & LAI_METHOD_INFO_ANALYZED))
+        return;
+
+    // As in lai_analyze_namespace(), the stores of the method are unknown.
+    lai_analyze_unknown_stores();
+}
+
+// lai_analyze_namespace(): Analyzes all methods of the namespace and finds the
+//                          Name()s that are never stored to
+// Must run again whenever AML is added to the namespace.
+// Return:   Nothing
+
+void lai_analyze_namespace(void)
+{
+    // Names are immutable unless some method stores to them.
+    for(size_t i = 0; i < lai_ns_size; i++)
+    {
+        if(lai_namespace[i]->type == LAI_NAMESPACE_NAME)
+            lai_namespace[i]->object_immutable = 1;
+    }
+    lai_analyze_all_mutable = 0;
+
+    int complete = 1;
+    for(size_t i = 0; i < lai_ns_size; i++)
+    {
+        lai_nsnode_t *node = lai_namespace[i];
+        if(node->type != LAI_NAMESPACE_METHOD)
+            continue;
+        lai_analyze_method(node);
+        if(!node->method_override && !(node->method_info.flags & LAI_METHOD_INFO_ANALYZED))
+            complete = 0;
+    }
+
+    // The stores of a method that was not analyzed are unknown.
+    if(!complete)
+        lai_analyze_unknown_stores();
+}
+
+// lai_method_is_synchronous(): Checks whether a method can run without dropping
+//                              the interpreter lock
+// Param:    lai_nsnode_t *method - method
+// Return:   int - 1 if the method neither blocks, nor accesses hardware, nor calls methods
+
+int lai_method_is_synchronous(lai_nsnode_t *method)
+{
+    uint8_t flags = method->method_info.flags;
+    return (flags & LAI_METHOD_INFO_ANALYZED)
+            && !(flags & (LAI_METHOD_INFO_BLOCKS | LAI_METHOD_INFO_HARDWARE
+                    | LAI_METHOD_INFO_CALLS));
+}
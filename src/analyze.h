@@ -0,0 +1,15 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+// Internal header file. Do not use outside of LAI.
+
+#pragma once
+
+#include <lai/core.h>
+
+void lai_analyze_method(lai_nsnode_t *);
+void lai_reanalyze_method(lai_nsnode_t *);
+void lai_analyze_namespace(void);
+int lai_method_is_synchronous(lai_nsnode_t *);
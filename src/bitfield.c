@@ -0,0 +1,168 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Bit Fields */
+/* Buffer fields, CreateField() and OpRegion fields all transfer a number of bits
+ * at an arbitrary bit offset. Buffers are accessed in little-endian 64-bit words
+ * that need not be aligned; a field of up to 64 bits touches one such word and,
+ * if it does not start on a byte boundary, one more byte. Wider fields are moved
+ * in chunks of 64 bits. Callers check that the bits are inside of the buffer. */
+
+#include <lai/core.h>
+#include "libc.h"
+#include "bitfield.h"
+
+// lai_bitfield_load(): Loads a little-endian word, or the bytes of it that exist
+// Param:    const uint8_t *data - first byte
+// Param:    size_t size - number of bytes that can be accessed at data
+// Return:   uint64_t - word; missing bytes are zero
+
+static inline uint64_t lai_bitfield_load(const uint8_t *data, size_t size)
+{
+    uint64_t word = 0;
+    if(size >= 8)
+    {
+        // __builtin_memcpy() is expanded to a single (unaligned) load.
+        __builtin_memcpy(&word, data, 8);
+        return word;
+    }
+
+    for(size_t i = 0; i < size; i++)
+        word |= (uint64_t)data[i] << (i * 8);
+    return word;
+}
+
+// lai_bitfield_store(): Stores a little-endian word, or the bytes of it that exist
+// Param:    uint8_t *data - first byte
+// Param:    size_t size - number of bytes that can be accessed at data
+// Param:    uint64_t word - word
+// Return:   Nothing
+
+static inline void lai_bitfield_store(uint8_t *data, size_t size, uint64_t word)
+{
+    if(size >= 8)
+    {
+        __builtin_memcpy(data, &word, 8);
+        return;
+    }
+
+    for(size_t i = 0; i < size; i++)
+        data[i] = word >> (i * 8);
+}
+
+// lai_bitfield_extract(): Reads up to 64 bits from a buffer
+// Param:    const uint8_t *data - buffer
+// Param:    size_t size - size of the buffer in bytes
+// Param:    uint64_t offset - bit offset of the field
+// Param:    size_t width - number of bits, 1 to 64
+// Return:   uint64_t - value of the field
+
+uint64_t lai_bitfield_extract(const uint8_t *data, size_t size, uint64_t offset, size_t width)
+{
+    size_t byte = offset / 8;
+    size_t shift = offset % 8;
+
+    uint64_t value = lai_bitfield_load(data + byte, size - byte) >> shift;
+    if(shift + width > 64)
+        value |= (uint64_t)data[byte + 8] << (64 - shift);
+    return value & lai_bitfield_mask(width);
+}
+
+// lai_bitfield_insert(): Writes up to 64 bits to a buffer; other bits are preserved
+// Param:    uint8_t *data - buffer
+// Param:    size_t size - size of the buffer in bytes
+// Param:    uint64_t offset - bit offset of the field
+// Param:    size_t width - number of bits, 1 to 64
+// Param:    uint64_t value - new value; higher bits are ignored
+// Return:   Nothing
+
+void lai_bitfield_insert(uint8_t *data, size_t size, uint64_t offset, size_t width,
+        uint64_t value)
+{
+    size_t byte = offset / 8;
+    size_t shift = offset % 8;
+    size_t available = size - byte;
+    if(available > 8)
+        available = 8;
+
+    // The bits that do not fit into the word go to the following byte.
+    size_t low_width = width;
+    if(shift + width > 64)
+        low_width = 64 - shift;
+
+    uint64_t word = lai_bitfield_load(data + byte, available);
+    lai_bitfield_store(data + byte, available, lai_bitfield_merge(word, shift, low_width, value));
+    if(low_width < width)
+        data[byte + 8] = lai_bitfield_merge(data[byte + 8], 0, width - low_width,
+                value >> low_width);
+}
+
+// lai_bitfield_fetch(): Reads up to 64 bits from a buffer that may be too short
+// Param:    const uint8_t *data - buffer
+// Param:    size_t size - size of the buffer in bytes
+// Param:    uint64_t offset - bit offset of the field
+// Param:    size_t width - number of bits, 1 to 64; bits beyond the end of the buffer are zero
+// Return:   uint64_t - value of the field
+
+uint64_t lai_bitfield_fetch(const uint8_t *data, size_t size, uint64_t offset, size_t width)
+{
+    uint64_t bits = (uint64_t)size * 8;
+    if(offset >= bits)
+        return 0;
+    if(offset + width > bits)
+        width = bits - offset;
+    return lai_bitfield_extract(data, size, offset, width);
+}
+
+// lai_bitfield_copy(): Copies bits between two buffers
+// Param:    uint8_t *destination - destination buffer
+// Param:    size_t destination_size - size of the destination in bytes
+// Param:    uint64_t destination_offset - bit offset in the destination
+// Param:    const uint8_t *source - source buffer
+// Param:    size_t source_size - size of the source in bytes
+// Param:    uint64_t source_offset - bit offset in the source
+// Param:    uint64_t width - number of bits; bits beyond the end of the source are zero
+// Return:   Nothing
+
+void lai_bitfield_copy(uint8_t *destination, size_t destination_size,
+        uint64_t destination_offset, const uint8_t *source, size_t source_size,
+        uint64_t source_offset, uint64_t width)
+{
+    while(width)
+    {
+        size_t chunk = width < 64 ? width : 64;
+        lai_bitfield_insert(destination, destination_size, destination_offset, chunk,
+                lai_bitfield_fetch(source, source_size, source_offset, chunk));
+
+        destination_offset += chunk;
+        source_offset += chunk;
+        width -= chunk;
+    }
+}
+
+// lai_bitfield_source(): Returns the bits of an object that is written to a field
+// Param:    lai_object_t *source - Integer, Buffer or String
+// Param:    uint8_t *integer - storage for the bytes of an Integer, 8 bytes
+// Param:    size_t *size - receives the number of bytes
+// Return:   const uint8_t * - bytes of the object
+
+const uint8_t *lai_bitfield_source(lai_object_t *source, uint8_t *integer, size_t *size)
+{
+    switch(source->type)
+    {
+    case LAI_INTEGER:
+        lai_bitfield_store(integer, 8, source->integer);
+        *size = 8;
+        return integer;
+    case LAI_BUFFER:
+        *size = source->buffer_size;
+        return source->buffer;
+    case LAI_STRING:
+        *size = lai_strlen(source->string);
+        return (const uint8_t *)source->string;
+    default:
+        lai_panic("object type %d cannot be written to a field\n", source->type);
+    }
+}
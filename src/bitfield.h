@@ -0,0 +1,42 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+// Internal header file. Do not use outside of LAI.
+
+#pragma once
+
+#include <lai/core.h>
+
+// lai_bitfield_mask(): Returns a mask of the lowest bits of a word
+// Param:    size_t width - number of bits, up to 64
+// Return:   uint64_t - mask
+
+static inline uint64_t lai_bitfield_mask(size_t width)
+{
+    // Shifting a 64-bit value by 64 is undefined.
+    if(width >= 64)
+        return ~(uint64_t)0;
+    return ((uint64_t)1 << width) - 1;
+}
+
+// lai_bitfield_merge(): Replaces bits of a word
+// Param:    uint64_t word - word
+// Param:    size_t offset - bit offset inside the word
+// Param:    size_t width - number of bits, offset + width must not exceed 64
+// Param:    uint64_t value - new bits; higher bits are ignored
+// Return:   uint64_t - updated word
+
+static inline uint64_t lai_bitfield_merge(uint64_t word, size_t offset, size_t width,
+        uint64_t value)
+{
+    uint64_t mask = lai_bitfield_mask(width) << offset;
+    return (word & ~mask) | ((value << offset) & mask);
+}
+
+uint64_t lai_bitfield_extract(const uint8_t *, size_t, uint64_t, size_t);
+void lai_bitfield_insert(uint8_t *, size_t, uint64_t, size_t, uint64_t);
+uint64_t lai_bitfield_fetch(const uint8_t *, size_t, uint64_t, size_t);
+void lai_bitfield_copy(uint8_t *, size_t, uint64_t, const uint8_t *, size_t, uint64_t, uint64_t);
+const uint8_t *lai_bitfield_source(lai_object_t *, uint8_t *, size_t *);
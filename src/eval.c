@@ -9,6 +9,7 @@
 #include "libc.h"
 #include "exec_impl.h"
 #include "eval.h"
+#include "package.h"
 
 uint32_t bswap32(uint32_t);
 uint16_t bswap16(uint16_t);
@@ -123,7 +124,7 @@ int lai_eval_package(lai_object_t *package, size_t index, lai_object_t *destinat
         return 1;
     }
 
-    lai_copy_object(destination, &package->package[index]);
+    lai_copy_object(destination, lai_package_element(package, index));
     return 0;
 }
 
@@ -134,14 +135,31 @@ int lai_eval_package(lai_object_t *package, size_t index, lai_object_t *destinat
 
 int lai_eval(lai_object_t *destination, char *path)
 {
-    lai_nsnode_t *handle;
-    char *path_copy = laihost_malloc(lai_strlen(path) + 1);
+    // lai_exec_resolve() modifies the path; work on a copy.
+    char path_copy[ACPI_MAX_NAME];
+    if(lai_strlen(path) >= ACPI_MAX_NAME)
+        return 1;
     lai_strcpy(path_copy, path);
-    handle = lai_exec_resolve(path_copy);
-    laihost_free(path_copy);
+
+    lai_nsnode_t *handle = lai_exec_resolve(path_copy);
     if(!handle)
         return 1;
 
+    return lai_eval_args(handle, 0, NULL, destination);
+}
+
+// lai_eval_args(): Evaluates a namespace node; methods are passed arguments
+// Param:    lai_nsnode_t *handle - Name() or method to evaluate
+// Param:    int argc - number of arguments
+// Param:    lai_object_t *argv - arguments, these are copied
+// Param:    lai_object_t *result - where to store the result
+// Return:    int - 0 on success
+
+int lai_eval_args(lai_nsnode_t *handle, int argc, lai_object_t *argv, lai_object_t *result)
+{
+    if(argc < 0 || argc > 7)
+        return 1;
+
     while(handle->type == LAI_NAMESPACE_ALIAS)
     {
         handle = lai_resolve(handle->alias);
@@ -151,23 +169,96 @@ int lai_eval(lai_object_t *destination, char *path)
 
     if(handle->type == LAI_NAMESPACE_NAME)
     {
-        lai_copy_object(destination, &handle->object);
+        if(argc)
+            return 1;
+        lai_copy_object(result, &handle->object);
         return 0;
     } else if(handle->type == LAI_NAMESPACE_METHOD)
     {
         lai_state_t state;
         lai_init_state(&state);
-        int ret;
-        if((ret = lai_exec_method(handle, &state)))
-            return ret;
-        lai_move_object(destination, &state.retvalue);
+        for(int i = 0; i < argc; i++)
+            lai_copy_object(&state.arg[i], &argv[i]);
+
+        int ret = lai_exec_method(handle, &state);
+        if(!ret)
+            lai_move_object(result, &state.retvalue);
         lai_finalize_state(&state);
-        return 0;
+        return ret;
     }
 
     return 1;
 }
 
+// lai_eval_batch(): Evaluates the same child of many nodes, e.g. _STA of all devices
+// Param:    lai_nsnode_t **nodes - nodes whose children are evaluated
+// Param:    size_t count - number of nodes
+// Param:    const char *name - NameSeg of the child, exactly four characters
+// Param:    uint64_t *results - integer results, one per node. Entries of nodes that
+//                               do not have the child or that do not evaluate to an
+//                               integer are left untouched, so that the caller can
+//                               fill in defaults beforehand.
+// Return:    size_t - number of results that were stored
+
+size_t lai_eval_batch(lai_nsnode_t **nodes, size_t count, const char *name, uint64_t *results)
+{
+    size_t stored = 0;
+
+    // One state is shared by all method calls. No arguments are passed, so only the
+    // return value and the locals need to be freed in between, and buffer fields over
+    // the locals must be detached, so that the next method does not see them.
+    lai_state_t state;
+    lai_init_state(&state);
+
+    for(size_t i = 0; i < count; i++)
+    {
+        lai_nsnode_t *handle = lai_ns_get_child(nodes[i], name);
+        while(handle && handle->type == LAI_NAMESPACE_ALIAS)
+            handle = lai_resolve(handle->alias);
+        if(!handle)
+            continue;
+
+        if(handle->type == LAI_NAMESPACE_NAME)
+        {
+            // Integers can be read in place, there is nothing to copy.
+            if(handle->object.type == LAI_INTEGER)
+            {
+                results[i] = handle->object.integer;
+                stored++;
+            }
+            continue;
+        }
+
+        if(handle->type != LAI_NAMESPACE_METHOD)
+            continue;
+
+        int ret = lai_exec_method(handle, &state);
+        if(!ret && state.retvalue.type == LAI_INTEGER)
+        {
+            results[i] = state.retvalue.integer;
+            stored++;
+        }
+
+        if(ret)
+        {
+            // A failed method may leave items on the stacks.
+            lai_finalize_state(&state);
+            lai_init_state(&state);
+            continue;
+        }
+
+        if(state.buffer_fields)
+            lai_exec_release_buffer_fields(&state);
+        lai_free_object(&state.retvalue);
+        for(int j = 0; j < state.local_count; j++)
+            lai_free_object(&state.local[j]);
+        state.local_count = 0;
+    }
+
+    lai_finalize_state(&state);
+    return stored;
+}
+
 // lai_bswap16(): Switches endianness of a WORD
 // Param:    uint16_t word - WORD
 // Return:    uint16_t - switched value
@@ -211,8 +302,12 @@ void lai_eisaid(lai_object_t *object, char *id)
 {
     if(lai_strlen(id) != 7)
     {
+        // Not an EISA ID; the object owns a copy like any other string.
         object->type = LAI_STRING;
-        object->string = id;
+        object->string = lai_pool_alloc(lai_strlen(id) + 1, LAI_MEMORY_STRING);
+        if(!object->string)
+            lai_panic("unable to allocate memory for string object.\n");
+        lai_strcpy(object->string, id);
         return;
     }
 
@@ -10,6 +10,9 @@
 #include "ns_impl.h"
 #include "libc.h"
 #include "eval.h"
+#include "sync.h"
+#include "package.h"
+#include "analyze.h"
 
 static int debug_opcodes = 0;
 
@@ -18,8 +21,6 @@ static int debug_opcodes = 0;
    DefLoad | DefNoop | DefNotify | DefRelease | DefReset | DefReturn |
    DefSignal | DefSleep | DefStall | DefUnload | DefWhile */
 
-void lai_eval_operand(lai_object_t *destination, lai_state_t *state, uint8_t *code);
-
 // Prepare the interpreter state for a control method call.
 // Param: lai_state_t *state - will store method name and arguments
 // Param: lai_nsnode_t *method - identifies the control method
@@ -33,40 +34,20 @@ void lai_init_state(lai_state_t *state) {
 // Finalize the interpreter state. Frees all memory owned by the state.
 
 void lai_finalize_state(lai_state_t *state) {
+    if(state->buffer_fields)
+        lai_exec_release_buffer_fields(state);
+
     lai_free_object(&state->retvalue);
     for(int i = 0; i < 7; i++)
     {
         lai_free_object(&state->arg[i]);
     }
 
-    for(int i = 0; i < 8; i++)
+    for(int i = 0; i < state->local_count; i++)
     {
         lai_free_object(&state->local[i]);
     }
-}
-
-// Pushes a new item to the opstack and returns it.
-static lai_object_t *lai_exec_push_opstack_or_die(lai_state_t *state) {
-    if(state->opstack_ptr == 16)
-        lai_panic("operand stack overflow\n");
-    lai_object_t *object = &state->opstack[state->opstack_ptr];
-    memset(object, 0, sizeof(lai_object_t));
-    state->opstack_ptr++;
-    return object;
-}
-
-// Returns the n-th item from the opstack.
-static lai_object_t *lai_exec_get_opstack(lai_state_t *state, int n) {
-    if(n >= state->opstack_ptr)
-        lai_panic("opstack access out of bounds"); // This is an internal execution error.
-    return &state->opstack[n];
-}
-
-// Removes n items from the opstack.
-static void lai_exec_pop_opstack(lai_state_t *state, int n) {
-    for(int k = 0; k < n; k++)
-        lai_free_object(&state->opstack[state->opstack_ptr - k - 1]);
-    state->opstack_ptr -= n;
+    state->local_count = 0;
 }
 
 // Pushes a new item to the execution stack and returns it.
@@ -129,8 +110,8 @@ static int lai_compare(lai_object_t *lhs, lai_object_t *rhs) {
     return lhs->integer - rhs->integer;
 }
 
-static void lai_exec_reduce(int opcode, lai_state_t *state, lai_object_t *operands,
-        lai_object_t *reduction_res) {
+static void lai_exec_reduce(int opcode, lai_state_t *state, uint8_t *method,
+        lai_object_t *operands, lai_object_t *reduction_res) {
     if(debug_opcodes)
         lai_debug("lai_exec_reduce: opcode 0x%02X\n", opcode);
     lai_object_t result = {0};
@@ -414,6 +395,30 @@ static void lai_exec_reduce(int opcode, lai_state_t *state, lai_object_t *operan
             lai_panic("SizeOf() is only defined for buffers, strings and packages\n");
         break;
     }
+    case NOTIFY_OP:
+    {
+        lai_nsnode_t *handle;
+        if(operands[0].type == LAI_UNRESOLVED_NAME)
+        {
+            handle = lai_exec_resolve(operands[0].name);
+            if(!handle)
+                lai_panic("undefined reference %s in Notify()\n", operands[0].name);
+        }else
+        {
+            lai_object_t object = {0};
+            lai_load_operand(state, &operands[0], &object);
+            if(object.type != LAI_HANDLE)
+                lai_panic("Notify() is only defined for namespace nodes\n");
+            handle = object.handle;
+        }
+
+        lai_object_t value = {0};
+        lai_load_operand(state, &operands[1], &value);
+        if(value.type != LAI_INTEGER)
+            lai_panic("Notify() value must be an integer, not type %d\n", value.type);
+        lai_queue_notify(handle, value.integer);
+        break;
+    }
     case (EXTOP_PREFIX << 8) | CONDREF_OP:
     {
         lai_object_t *operand = &operands[0];
@@ -448,6 +453,102 @@ static void lai_exec_reduce(int opcode, lai_state_t *state, lai_object_t *operan
         }
         break;
     }
+    case NAME_OP:
+        lai_exec_name(state, &operands[0], &operands[1]);
+        break;
+    case BITFIELD_OP:
+    case BYTEFIELD_OP:
+    case WORDFIELD_OP:
+    case DWORDFIELD_OP:
+    case QWORDFIELD_OP:
+    {
+        // CreateBitField() takes a bit index, the others a byte index.
+        lai_object_t index = {0};
+        lai_load_operand(state, &operands[1], &index);
+
+        uint64_t offset = index.integer * 8;
+        uint64_t size;
+        if(opcode == BITFIELD_OP)
+        {
+            offset = index.integer;
+            size = 1;
+        }else if(opcode == BYTEFIELD_OP)
+            size = 8;
+        else if(opcode == WORDFIELD_OP)
+            size = 16;
+        else if(opcode == DWORDFIELD_OP)
+            size = 32;
+        else
+            size = 64;
+        lai_exec_buffer_field(state, &operands[0], &operands[2], offset, size);
+        break;
+    }
+    case (EXTOP_PREFIX << 8) | ARBFIELD_OP:
+    {
+        lai_object_t index = {0};
+        lai_object_t size = {0};
+        lai_load_operand(state, &operands[1], &index);
+        lai_load_operand(state, &operands[2], &size);
+        lai_exec_buffer_field(state, &operands[0], &operands[3], index.integer, size.integer);
+        break;
+    }
+    case BUFFER_OP:
+    {
+        // The size of the buffer in bytes.
+        lai_object_t buffer_size = {0};
+        lai_load_operand(state, &operands[1], &buffer_size);
+
+        result.type = LAI_BUFFER;
+        result.buffer_size = buffer_size.integer;
+        result.buffer = lai_pool_alloc(buffer_size.integer, LAI_MEMORY_BUFFER);
+        if(!result.buffer)
+            lai_panic("failed to allocate memory for AML buffer");
+        memset(result.buffer, 0, buffer_size.integer);
+
+        // Note that not all elements of the buffer need to be initialized.
+        int initial_size = (int)operands[0].integer - state->pc;
+        if(initial_size < 0)
+            lai_panic("buffer initializer has negative size\n");
+        if(initial_size > result.buffer_size)
+            lai_panic("buffer initializer overflows buffer\n");
+        memcpy(result.buffer, method + state->pc, initial_size);
+        state->pc += initial_size;
+        break;
+    }
+    case (EXTOP_PREFIX << 8) | SLEEP_OP:
+    {
+        lai_object_t time = {0};
+        lai_load_operand(state, &operands[0], &time);
+
+        if(!time.integer)
+            time.integer = 1;
+
+        if(!laihost_sleep)
+            lai_panic("host does not provide timer functions required by Sleep()\n");
+
+        // Other devices can be initialized while we are sleeping.
+        if(lai_sync_is_active() && lai_scratch_is_active())
+            lai_panic("Sleep() in a method that uses the scratch arena\n");
+        lai_unlock_interpreter();
+        laihost_sleep(time.integer);
+        lai_lock_interpreter();
+        break;
+    }
+    case (EXTOP_PREFIX << 8) | OPREGION:
+    {
+        lai_object_t disp = {0};
+        lai_object_t length = {0};
+        lai_load_operand(state, &operands[2], &disp);
+        lai_load_operand(state, &operands[3], &length);
+
+        lai_nsnode_t *node = lai_create_nsnode_or_die();
+        lai_strcpy(node->path, operands[0].name);
+        node->op_address_space = operands[1].integer;
+        node->op_base = disp.integer;
+        node->op_length = length.integer;
+        lai_install_nsnode(node);
+        break;
+    }
     default:
         lai_panic("undefined opcode in lai_exec_reduce: %02X\n", opcode);
     }
@@ -455,13 +556,71 @@ static void lai_exec_reduce(int opcode, lai_state_t *state, lai_object_t *operan
     lai_move_object(reduction_res, &result);
 }
 
+// lai_exec_trivial(): Evaluates a method that lai_classify_method() recognized
+// Param:    lai_nsnode_t *method - method
+// Param:    lai_object_t *result - receives the return value, must be empty
+// Return:   int - 0 on success, 1 if the method has to be run by the interpreter
+
+static int lai_exec_trivial(lai_nsnode_t *method, lai_object_t *result)
+{
+    if(method->method_class == LAI_METHOD_CONSTANT)
+    {
+        result->type = LAI_INTEGER;
+        result->integer = method->method_constant;
+        return 0;
+    }else if(method->method_class == LAI_METHOD_LOAD)
+    {
+        // Resolve the name exactly as the interpreter would.
+        char path[ACPI_MAX_NAME];
+        lai_resolve_path(method, path, (uint8_t *)method->pointer + 1);
+        lai_nsnode_t *handle = lai_exec_resolve(path);
+        if(!handle)
+            lai_panic("undefined reference %s in object mode\n", path);
+
+        // Return(FOO) invokes FOO if it is a method.
+        if(handle->type == LAI_NAMESPACE_METHOD)
+            return 1;
+        lai_load_ns(handle, result);
+        return 0;
+    }
+    return 1;
+}
+
+// lai_exec_invoke(): Calls a method from AML and pushes its result
+// Param:    lai_nsnode_t *handle - method
+// Param:    lai_state_t *nested_state - initialized state, holds the arguments
+// Param:    lai_state_t *state - state of the caller
+// Param:    int result_mode - LAI_OBJECT_MODE if the result is used, LAI_EXEC_MODE otherwise
+// Return:   Nothing
+
+static void lai_exec_invoke(lai_nsnode_t *handle, lai_state_t *nested_state,
+        lai_state_t *state, int result_mode)
+{
+    // In data and target mode, names are pushed as references instead of being
+    // resolved, so methods are never invoked there.
+    if(result_mode != LAI_OBJECT_MODE && result_mode != LAI_EXEC_MODE)
+        lai_panic("invocation of %s in data or target mode\n", handle->path);
+
+    lai_exec_method(handle, nested_state);
+    if(result_mode == LAI_OBJECT_MODE)
+    {
+        lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
+        lai_move_object(opstack_res, &nested_state->retvalue);
+    }
+    lai_finalize_state(nested_state);
+}
+
 // lai_exec_run(): Internal function, executes actual AML opcodes
 // Param:  uint8_t *method - pointer to method opcodes
 // Param:  lai_state_t *state - machine state
+// Param:  int checked - 0 if the code was verified by lai_analyze_method()
 // Return: int - 0 on success
 
-static int lai_exec_run(uint8_t *method, lai_state_t *state)
+static int lai_exec_run(uint8_t *method, lai_state_t *state, int checked)
 {
+    // Verified code cannot leave its bounds unless an invoked method creates names.
+    size_t ns_size = lai_ns_size;
+
     lai_stackitem_t *item;
     while((item = lai_exec_peek_stack_back(state)))
     {
@@ -500,12 +659,104 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
                 lai_exec_update_context(state);
 				continue;
 			}
-        }else if(item->kind == LAI_EVALOPERAND_STACKITEM)
+        }else if(item->kind == LAI_PREDICATE_STACKITEM)
         {
             if(state->opstack_ptr == item->opstack_frame + 1)
             {
+                // Predicates are almost always integers that are already on the opstack;
+                // these are read in place instead of being copied out.
+                lai_object_t *operand = lai_exec_get_opstack(state, item->opstack_frame);
+                uint64_t predicate;
+                if(operand->type == LAI_INTEGER)
+                    predicate = operand->integer;
+                else
+                {
+                    lai_object_t object = {0};
+                    lai_load_operand(state, operand, &object);
+                    predicate = object.integer;
+                    lai_free_object(&object);
+                }
+                lai_exec_pop_opstack(state, 1);
+
+                if(item->pred_opcode == IF_OP)
+                {
+                    // The item becomes the If() itself.
+                    int cond_end = item->pred_end;
+                    item->kind = LAI_COND_STACKITEM;
+                    item->cond_taken = (predicate != 0);
+                    item->cond_end = cond_end;
+                    if(!item->cond_taken)
+                        state->pc = cond_end;
+                }else
+                {
+                    // If the predicate of While() is false, we jump to the end of the loop
+                    // and also remove the loop's stack item.
+                    LAI_ENSURE(item->pred_opcode == WHILE_OP);
+                    lai_exec_pop_stack_back(state);
+                    if(!predicate)
+                    {
+                        state->pc = lai_exec_peek_stack_back(state)->loop_end;
+                        lai_exec_pop_stack_back(state);
+                    }
+                }
+                continue;
+            }
+
+            exec_result_mode = LAI_OBJECT_MODE;
+        }else if(item->kind == LAI_RETURN_STACKITEM)
+        {
+            if(state->opstack_ptr == item->opstack_frame + 1)
+            {
+                lai_object_t result = {0};
+                lai_load_operand(state, lai_exec_get_opstack(state, item->opstack_frame), &result);
+                lai_exec_pop_opstack(state, 1);
                 lai_exec_pop_stack_back(state);
-                return 0;
+
+                // Find the last LAI_METHOD_CONTEXT_STACKITEM on the stack.
+                int j = 0;
+                lai_stackitem_t *method_item;
+                while(1) {
+                    method_item = lai_exec_peek_stack(state, j);
+                    if(!method_item)
+                        lai_panic("Return() outside of control method()\n");
+                    if(method_item->kind == LAI_METHOD_CONTEXT_STACKITEM)
+                        break;
+                    // TODO: Verify that we only cross conditions/loops.
+                    j++;
+                }
+
+                // Remove the method stack item and push the return value.
+                if(state->opstack_ptr) // This is an internal error.
+                    lai_panic("opstack is not empty before return\n");
+                lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
+                lai_move_object(opstack_res, &result);
+
+                lai_exec_pop_stack(state, j + 1);
+                lai_exec_update_context(state);
+                continue;
+            }
+
+            exec_result_mode = LAI_OBJECT_MODE;
+        }else if(item->kind == LAI_INVOKE_STACKITEM)
+        {
+            int k = state->opstack_ptr - item->opstack_frame;
+            if(k == item->invoke_argc)
+            {
+                lai_nsnode_t *handle = item->invoke_method;
+                int result_mode = item->invoke_result_mode;
+                lai_object_t *args = lai_exec_get_opstack(state, item->opstack_frame);
+                lai_exec_pop_stack_back(state);
+
+                lai_state_t nested_state;
+                lai_init_state(&nested_state);
+                for(int i = 0; i < k; i++)
+                    lai_load_operand(state, &args[i], &nested_state.arg[i]);
+                lai_exec_pop_opstack(state, k);
+
+                lai_exec_invoke(handle, &nested_state, state, result_mode);
+                if(lai_ns_size != ns_size)
+                    checked = 1;
+                continue;
             }
 
             exec_result_mode = LAI_OBJECT_MODE;
@@ -538,7 +789,7 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
                 continue;
             }
 
-            if(state->pc > item->pkg_end) // This would be an interpreter bug.
+            if(checked && state->pc > item->pkg_end) // This would be an interpreter bug.
                 lai_panic("package initializer escaped out of code range\n");
 
             exec_result_mode = LAI_DATA_MODE;
@@ -549,16 +800,20 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             if(!item->op_arg_modes[k]) {
                 lai_object_t result = {0};
                 lai_object_t *operands = lai_exec_get_opstack(state, item->opstack_frame);
-                lai_exec_reduce(item->op_opcode, state, operands, &result);
+                lai_exec_reduce(item->op_opcode, state, method, operands, &result);
                 lai_exec_pop_opstack(state, k);
 
-                if(item->op_result_mode == LAI_OBJECT_MODE
+                if(item->op_result_mode == LAI_DATA_MODE
+                        || item->op_result_mode == LAI_OBJECT_MODE
                         || item->op_result_mode == LAI_TARGET_MODE)
                 {
                     lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
                     lai_move_object(opstack_res, &result);
                 }else
+                {
                     LAI_ENSURE(item->op_result_mode == LAI_EXEC_MODE);
+                    lai_free_object(&result);
+                }
 
                 lai_exec_pop_stack_back(state);
                 continue;
@@ -569,15 +824,12 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
         {
             if(state->pc == item->loop_pred)
             {
-                // We are at the beginning of a loop. We check the predicate; if it is false,
-                // we jump to the end of the loop and remove the stack item.
-                lai_object_t predicate = {0};
-                lai_eval_operand(&predicate, state, method);
-                if(!predicate.integer)
-                {
-                    state->pc = item->loop_end;
-                    lai_exec_pop_stack_back(state);
-                }
+                // We are at the beginning of a loop. The predicate is evaluated on top
+                // of the loop's stack item; see LAI_PREDICATE_STACKITEM.
+                lai_stackitem_t *pred_item = lai_exec_push_stack_or_die(state);
+                pred_item->kind = LAI_PREDICATE_STACKITEM;
+                pred_item->opstack_frame = state->opstack_ptr;
+                pred_item->pred_opcode = WHILE_OP;
                 continue;
             }else if(state->pc == item->loop_end)
             {
@@ -586,14 +838,14 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
                 continue;
             }
 
-            if (state->pc > item->loop_end) // This would be an interpreter bug.
+            if(checked && state->pc > item->loop_end) // This would be an interpreter bug.
                 lai_panic("execution escaped out of While() body\n");
         }else if(item->kind == LAI_COND_STACKITEM)
         {
             // If the condition wasn't taken, execute the Else() block if it exists
             if(!item->cond_taken)
             {
-                if(method[state->pc] == ELSE_OP)
+                if(state->pc < state->limit && method[state->pc] == ELSE_OP)
                 {
                     size_t else_size;
                     state->pc++;
@@ -621,7 +873,7 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
         }else
             lai_panic("unexpected lai_stackitem_t\n");
 
-        if(state->pc >= state->limit) // This would be an interpreter bug.
+        if(checked && state->pc >= state->limit) // This would be an interpreter bug.
             lai_panic("execution escaped out of code range (PC is 0x%x with limit 0x%x)\n",
                     state->pc, state->limit);
 
@@ -649,33 +901,51 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
                 if(!handle)
                     lai_panic("undefined reference %s in object mode\n", unresolved.name);
 
-                lai_object_t result = {0};
                 if(handle->type == LAI_NAMESPACE_METHOD)
                 {
                     if(debug_opcodes)
                         lai_debug("parsing invocation %s [@ %d]\n", unresolved.name, opcode_pc);
 
-                    lai_state_t nested_state;
-                    lai_init_state(&nested_state);
+                    // Arguments are parsed onto the opstack, see LAI_INVOKE_STACKITEM.
                     int argc = handle->method_flags & METHOD_ARGC_MASK;
-                    for(int i = 0; i < argc; i++)
-                        lai_eval_operand(&nested_state.arg[i], state, method);
-
-                    lai_exec_method(handle, &nested_state);
-                    lai_move_object(&result, &nested_state.retvalue);
-                    lai_finalize_state(&nested_state);
+                    if(argc)
+                    {
+                        lai_stackitem_t *invoke_item = lai_exec_push_stack_or_die(state);
+                        invoke_item->kind = LAI_INVOKE_STACKITEM;
+                        invoke_item->opstack_frame = state->opstack_ptr;
+                        invoke_item->invoke_method = handle;
+                        invoke_item->invoke_argc = argc;
+                        invoke_item->invoke_result_mode = exec_result_mode;
+                    }else
+                    {
+                        lai_object_t result = {0};
+                        if(lai_exec_trivial(handle, &result))
+                        {
+                            lai_state_t nested_state;
+                            lai_init_state(&nested_state);
+                            lai_exec_invoke(handle, &nested_state, state, exec_result_mode);
+                            if(lai_ns_size != ns_size)
+                                checked = 1;
+                        }else if(exec_result_mode == LAI_OBJECT_MODE)
+                        {
+                            lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
+                            lai_move_object(opstack_res, &result);
+                        }else
+                            lai_free_object(&result);
+                    }
                 }else
                 {
                     if(debug_opcodes)
                         lai_debug("parsing name %s [@ %d]\n", unresolved.name, opcode_pc);
 
+                    lai_object_t result = {0};
                     lai_load_ns(handle, &result);
-                }
-
-                if(exec_result_mode == LAI_OBJECT_MODE)
-                {
-                    lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
-                    lai_move_object(opstack_res, &result);
+                    if(exec_result_mode == LAI_OBJECT_MODE)
+                    {
+                        lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
+                        lai_move_object(opstack_res, &result);
+                    }else
+                        lai_free_object(&result);
                 }
             }
             lai_free_object(&unresolved);
@@ -686,7 +956,7 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
         int opcode;
         if(method[state->pc] == EXTOP_PREFIX)
         {
-            if(state->pc + 1 == state->limit)
+            if(checked && state->pc + 1 == state->limit)
                 lai_panic("two-byte opcode on method boundary\n");
             opcode = (EXTOP_PREFIX << 8) | method[state->pc + 1];
         }else
@@ -764,16 +1034,22 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             state->pc++;
 
             size_t n = 0; // Determine the length of null-terminated string.
-            while(state->pc + n < state->limit && method[state->pc + n])
-                n++;
-            if(state->pc + n == state->limit)
-                lai_panic("unterminated string in AML code");
+            if(checked)
+            {
+                while(state->pc + n < state->limit && method[state->pc + n])
+                    n++;
+                if(state->pc + n == state->limit)
+                    lai_panic("unterminated string in AML code");
+            }else
+                n = lai_strlen((char *)method + state->pc);
 
             if(exec_result_mode == LAI_DATA_MODE || exec_result_mode == LAI_OBJECT_MODE)
             {
                 lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
                 opstack_res->type = LAI_STRING;
-                opstack_res->string = laihost_malloc(n + 1);
+                opstack_res->string = lai_pool_alloc(n + 1, LAI_MEMORY_STRING);
+                if(!opstack_res->string)
+                    lai_panic("failed to allocate memory for AML string");
                 memcpy(opstack_res->string, method + state->pc, n);
                 opstack_res->string[n] = 0;
             }else
@@ -790,33 +1066,20 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             size_t encoded_size;
             state->pc += lai_parse_pkgsize(method + state->pc, &encoded_size);
 
-            // The size of the buffer in bytes.
-            lai_object_t buffer_size = {0};
-            lai_eval_operand(&buffer_size, state, method);
-
-            lai_object_t result = {0};
-            result.type = LAI_BUFFER;
-            result.buffer_size = buffer_size.integer;
-            result.buffer = laihost_malloc(buffer_size.integer);
-            if(!result.buffer)
-                lai_panic("failed to allocate memory for AML buffer");
-            memset(result.buffer, 0, buffer_size.integer);
-
-            int initial_size = (opcode_pc + encoded_size + 1) - state->pc;
-            if(initial_size < 0)
-                lai_panic("buffer initializer has negative size\n");
-            if(initial_size > result.buffer_size)
-                lai_panic("buffer initializer overflows buffer\n");
-            memcpy(result.buffer, method + state->pc, initial_size);
-            state->pc += initial_size;
+            // The end of the initializer is passed as the first operand; the size of the
+            // buffer in bytes follows. The initializer is copied in lai_exec_reduce().
+            lai_object_t *end = lai_exec_push_opstack_or_die(state);
+            end->type = LAI_INTEGER;
+            end->integer = opcode_pc + encoded_size + 1;
 
-            if(exec_result_mode == LAI_DATA_MODE || exec_result_mode == LAI_OBJECT_MODE)
-            {
-                lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
-                lai_move_object(opstack_res, &result);
-            }else
-                LAI_ENSURE(exec_result_mode == LAI_EXEC_MODE);
-            lai_free_object(&result);
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr - 1;
+            op_item->op_arg_modes[0] = LAI_DATA_MODE;
+            op_item->op_arg_modes[1] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[2] = 0;
+            op_item->op_result_mode = exec_result_mode;
             break;
         }
         case PACKAGE_OP:
@@ -841,44 +1104,35 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
 
             lai_object_t *opstack_pkg = lai_exec_push_opstack_or_die(state);
             opstack_pkg->type = LAI_PACKAGE;
-            opstack_pkg->package = lai_calloc(num_ents, sizeof(lai_object_t));
+            opstack_pkg->package = lai_pool_calloc(num_ents, sizeof(lai_object_t), LAI_MEMORY_PACKAGE);
+            if(!opstack_pkg->package)
+                lai_panic("failed to allocate memory for AML package");
             opstack_pkg->package_size = num_ents;
             break;
         }
 
         case (EXTOP_PREFIX << 8) | SLEEP_OP:
-            lai_exec_sleep(method, state);
+        {
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr;
+            op_item->op_arg_modes[0] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[1] = 0;
+            op_item->op_result_mode = LAI_EXEC_MODE;
+            state->pc += 2;
             break;
+        }
 
         /* A control method can return literally any object */
         /* So we need to take this into consideration */
         case RETURN_OP:
         {
+            // The return value is parsed onto the opstack, see LAI_RETURN_STACKITEM.
+            lai_stackitem_t *return_item = lai_exec_push_stack_or_die(state);
+            return_item->kind = LAI_RETURN_STACKITEM;
+            return_item->opstack_frame = state->opstack_ptr;
             state->pc++;
-            lai_object_t result = {0};
-            lai_eval_operand(&result, state, method);
-
-            // Find the last LAI_METHOD_CONTEXT_STACKITEM on the stack.
-            int j = 0;
-            lai_stackitem_t *method_item;
-            while(1) {
-                method_item = lai_exec_peek_stack(state, j);
-                if(!method_item)
-                    lai_panic("Return() outside of control method()\n");
-                if(method_item->kind == LAI_METHOD_CONTEXT_STACKITEM)
-                    break;
-                // TODO: Verify that we only cross conditions/loops.
-                j++;
-            }
-
-            // Remove the method stack item and push the return value.
-            if(state->opstack_ptr) // This is an internal error.
-                lai_panic("opstack is not empty before return\n");
-            lai_object_t *opstack_res = lai_exec_push_opstack_or_die(state);
-            lai_move_object(opstack_res, &result);
-
-            lai_exec_pop_stack(state, j + 1);
-            lai_exec_update_context(state);
             break;
         }
         /* While Loops */
@@ -943,18 +1197,12 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             state->pc++;
             state->pc += lai_parse_pkgsize(method + state->pc, &if_size);
 
-            // Evaluate the predicate
-            lai_object_t predicate = {0};
-            lai_eval_operand(&predicate, state, method);
-
-            lai_stackitem_t *cond_item = lai_exec_push_stack_or_die(state);
-            cond_item->kind = LAI_COND_STACKITEM;
-            cond_item->cond_taken = predicate.integer;
-            cond_item->cond_end = opcode_pc + if_size + 1;
-
-            if(!cond_item->cond_taken)
-                state->pc = cond_item->cond_end;
-
+            // The predicate is parsed onto the opstack, see LAI_PREDICATE_STACKITEM.
+            lai_stackitem_t *pred_item = lai_exec_push_stack_or_die(state);
+            pred_item->kind = LAI_PREDICATE_STACKITEM;
+            pred_item->opstack_frame = state->opstack_ptr;
+            pred_item->pred_opcode = IF_OP;
+            pred_item->pred_end = opcode_pc + if_size + 1;
             break;
         }
         case ELSE_OP:
@@ -963,17 +1211,70 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
 
         // "Simple" objects in the ACPI namespace.
         case NAME_OP:
-            lai_exec_name(method, ctx_handle, state);
+        {
+            // The name is passed as the first operand; the object follows.
+            state->pc++;
+            lai_object_t *name = lai_exec_push_opstack_or_die(state);
+            name->type = LAI_UNRESOLVED_NAME;
+            state->pc += lai_resolve_path(ctx_handle, name->name, method + state->pc);
+
+            // Constant packages are not materialized; see package.c.
+            size_t package_size = lai_package_scan(ctx_handle, method + state->pc,
+                    state->limit - state->pc);
+            if(package_size)
+            {
+                lai_object_t package = {0};
+                lai_package_init(&package, ctx_handle, method + state->pc);
+                lai_exec_name(state, name, &package);
+                lai_exec_pop_opstack(state, 1);
+                state->pc += package_size;
+                break;
+            }
+
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr - 1;
+            op_item->op_arg_modes[0] = LAI_DATA_MODE;
+            op_item->op_arg_modes[1] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[2] = 0;
+            op_item->op_result_mode = LAI_EXEC_MODE;
             break;
+        }
+        case BITFIELD_OP:
         case BYTEFIELD_OP:
-            lai_exec_bytefield(method, ctx_handle, state);
-            break;
         case WORDFIELD_OP:
-            lai_exec_wordfield(method, ctx_handle, state);
-            break;
         case DWORDFIELD_OP:
-            lai_exec_dwordfield(method, ctx_handle, state);
+        case QWORDFIELD_OP:
+        {
+            // The Buffer() operand is parsed as a name, like the field itself.
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr;
+            op_item->op_arg_modes[0] = LAI_TARGET_MODE;
+            op_item->op_arg_modes[1] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[2] = LAI_DATA_MODE;
+            op_item->op_arg_modes[3] = 0;
+            op_item->op_result_mode = LAI_EXEC_MODE;
+            state->pc++;
+            break;
+        }
+        case (EXTOP_PREFIX << 8) | ARBFIELD_OP:
+        {
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr;
+            op_item->op_arg_modes[0] = LAI_TARGET_MODE;
+            op_item->op_arg_modes[1] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[2] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[3] = LAI_DATA_MODE;
+            op_item->op_arg_modes[4] = 0;
+            op_item->op_result_mode = LAI_EXEC_MODE;
+            state->pc += 2;
             break;
+        }
 
         // Scope-like objects in the ACPI namespace.
         case SCOPE_OP:
@@ -985,10 +1286,15 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             char name[ACPI_MAX_NAME];
             state->pc += lai_resolve_path(ctx_handle, name, method + state->pc);
 
-            lai_nsnode_t *node = lai_create_nsnode_or_die();
-            node->type = LAI_NAMESPACE_SCOPE;
-            lai_strcpy(node->path, name);
-            lai_install_nsnode(node);
+            // Scope() usually refers to an existing object.
+            lai_nsnode_t *node = lai_resolve(name);
+            if(!node)
+            {
+                node = lai_create_nsnode_or_die();
+                node->type = LAI_NAMESPACE_SCOPE;
+                lai_strcpy(node->path, name);
+                lai_install_nsnode(node);
+            }
 
             lai_stackitem_t *item = lai_exec_push_stack_or_die(state);
             item->kind = LAI_POPULATE_CONTEXT_STACKITEM;
@@ -1059,22 +1365,26 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             char name[ACPI_MAX_NAME];
             state->pc += lai_resolve_path(ctx_handle, name, method + state->pc);
 
-            // First byte identifies the address space (memory, I/O ports, PCI, etc.).
-            int address_space = method[state->pc];
+            // The name and the address space (memory, I/O ports, PCI, etc.) are passed
+            // as the first two operands; the offset and length of the opregion follow.
+            lai_object_t *name_operand = lai_exec_push_opstack_or_die(state);
+            name_operand->type = LAI_UNRESOLVED_NAME;
+            lai_strcpy(name_operand->name, name);
+            lai_object_t *space_operand = lai_exec_push_opstack_or_die(state);
+            space_operand->type = LAI_INTEGER;
+            space_operand->integer = method[state->pc];
             state->pc++;
 
-            // Now, parse the offset and length of the opregion.
-            lai_object_t disp = {0};
-            lai_object_t length = {0};
-            lai_eval_operand(&disp, state, method);
-            lai_eval_operand(&length, state, method);
-
-            lai_nsnode_t *node = lai_create_nsnode_or_die();
-            lai_strcpy(node->path, name);
-            node->op_address_space = address_space;
-            node->op_base = disp.integer;
-            node->op_length = length.integer;
-            lai_install_nsnode(node);
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr - 2;
+            op_item->op_arg_modes[0] = LAI_DATA_MODE;
+            op_item->op_arg_modes[1] = LAI_DATA_MODE;
+            op_item->op_arg_modes[2] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[3] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[4] = 0;
+            op_item->op_result_mode = LAI_EXEC_MODE;
             break;
         }
         case (EXTOP_PREFIX << 8) | FIELD:
@@ -1257,6 +1567,19 @@ static int lai_exec_run(uint8_t *method, lai_state_t *state)
             state->pc++;
             break;
         }
+        case NOTIFY_OP:
+        {
+            lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
+            op_item->kind = LAI_OP_STACKITEM;
+            op_item->op_opcode = opcode;
+            op_item->opstack_frame = state->opstack_ptr;
+            op_item->op_arg_modes[0] = LAI_TARGET_MODE;
+            op_item->op_arg_modes[1] = LAI_OBJECT_MODE;
+            op_item->op_arg_modes[2] = 0;
+            op_item->op_result_mode = exec_result_mode;
+            state->pc++;
+            break;
+        }
         case (EXTOP_PREFIX << 8) | CONDREF_OP:
         {
             lai_stackitem_t *op_item = lai_exec_push_stack_or_die(state);
@@ -1291,18 +1614,15 @@ int lai_populate(lai_nsnode_t *parent, void *data, size_t size, lai_state_t *sta
 
     state->pc = 0;
     state->limit = size;
-    int status = lai_exec_run(data, state);
+    int status = lai_exec_run(data, state, 1);
     if(status)
         lai_panic("lai_exec_run() failed in lai_populate()\n");
     return 0;
 }
 
-// lai_exec_method(): Finds and executes a control method
-// Param:    lai_nsnode_t *method - method to execute
-// Param:    lai_state_t *state - execution engine state
-// Return:    int - 0 on success
+// lai_exec_method_body(): Executes a control method, see lai_exec_method()
 
-int lai_exec_method(lai_nsnode_t *method, lai_state_t *state)
+static int lai_exec_method_body(lai_nsnode_t *method, lai_state_t *state)
 {
     // Check for OS-defined methods.
     if(method->method_override)
@@ -1310,6 +1630,12 @@ int lai_exec_method(lai_nsnode_t *method, lai_state_t *state)
 
     // Okay, by here it's a real method.
     //lai_debug("execute control method %s\n", method->path);
+    int local_count = 8;
+    if(method->method_info.flags & LAI_METHOD_INFO_ANALYZED)
+        local_count = method->method_info.max_local + 1;
+    if(local_count > state->local_count)
+        state->local_count = local_count;
+
     lai_stackitem_t *item = lai_exec_push_stack_or_die(state);
     item->kind = LAI_METHOD_CONTEXT_STACKITEM;
     item->ctx_handle = method;
@@ -1317,7 +1643,8 @@ int lai_exec_method(lai_nsnode_t *method, lai_state_t *state)
 
     state->pc = 0;
     state->limit = method->size;
-    int status = lai_exec_run(method->pointer, state);
+    int checked = !(method->method_info.flags & LAI_METHOD_INFO_VERIFIED);
+    int status = lai_exec_run(method->pointer, state, checked);
     if(status)
         return status;
 
@@ -1340,6 +1667,59 @@ int lai_exec_method(lai_nsnode_t *method, lai_state_t *state)
     return 0;
 }
 
+// lai_exec_method(): Finds and executes a control method
+// Param:    lai_nsnode_t *method - method to execute
+// Param:    lai_state_t *state - execution engine state
+// Return:    int - 0 on success
+
+int lai_exec_method(lai_nsnode_t *method, lai_state_t *state)
+{
+    // Trivial methods need neither the interpreter nor the scratch arena.
+    if(method->method_class != LAI_METHOD_GENERIC)
+    {
+        lai_object_t result = {0};
+        if(!lai_exec_trivial(method, &result))
+        {
+            // The caller owns the return value; it must not share storage with a Name().
+            lai_move_object(&state->retvalue, &result);
+            if(state->retvalue.borrowed)
+                lai_promote_object(&state->retvalue);
+            return 0;
+        }
+    }
+
+    // The analysis is only valid for the namespace that it saw.
+    lai_reanalyze_method(method);
+
+    // Temporaries are allocated from the scratch arena. During parallel initialization,
+    // other threads run AML whenever the interpreter lock is dropped, so it is only
+    // used for methods that never drop the lock.
+    if(lai_sync_is_active() && !lai_method_is_synchronous(method))
+    {
+        int status = lai_exec_method_body(method, state);
+        lai_promote_object(&state->retvalue);
+        return status;
+    }
+
+    int outermost = lai_scratch_begin();
+    int status = lai_exec_method_body(method, state);
+
+    // The arena is released once the outermost method returns. Only the arguments
+    // and the return value are still visible to the caller; locals are dead.
+    if(outermost)
+    {
+        lai_promote_object(&state->retvalue);
+        for(int i = 0; i < 7; i++)
+            lai_promote_object(&state->arg[i]);
+        for(int i = 0; i < state->local_count; i++)
+            lai_free_object(&state->local[i]);
+        state->local_count = 0;
+    }
+
+    lai_scratch_end();
+    return status;
+}
+
 // lai_eval_node(): Evaluates a named AML object.
 // Param:    lai_nsnode_t *handle - node to evaluate
 // Param:    lai_state_t *state - execution engine state
@@ -1366,47 +1746,6 @@ int lai_eval_node(lai_nsnode_t *handle, lai_state_t *state)
     return 1;
 }
 
-// Evaluates an AML expression recursively.
-// TODO: Eventually, we want to remove this function. However, this requires refactoring
-//       lai_exec_run() to avoid all kinds of recursion.
-
-void lai_eval_operand(lai_object_t *destination, lai_state_t *state, uint8_t *code) {
-    int opstack = state->opstack_ptr;
-
-    lai_stackitem_t *item = lai_exec_push_stack_or_die(state);
-    item->kind = LAI_EVALOPERAND_STACKITEM;
-    item->opstack_frame = opstack;
-
-    int status = lai_exec_run(code, state);
-    if(status)
-        lai_panic("lai_exec_run() failed in lai_eval_operand()\n");
-
-    if(state->opstack_ptr != opstack + 1) // This would be an internal error.
-        lai_panic("expected exactly one opstack item after operand evaluation\n");
-    lai_object_t *result = lai_exec_get_opstack(state, opstack);
-    lai_load_operand(state, result, destination);
-    lai_exec_pop_opstack(state, 1);
-}
-
-// lai_exec_sleep(): Executes a Sleep() opcode
-// Param:    void *code - opcode data
-// Param:    lai_state_t *state - AML VM state
-
-void lai_exec_sleep(void *code, lai_state_t *state)
-{
-    state->pc += 2; // Skip EXTOP_PREFIX and SLEEP_OP.
-
-    lai_object_t time = {0};
-    lai_eval_operand(&time, state, code);
-
-    if(!time.integer)
-        time.integer = 1;
-
-    if(!laihost_sleep)
-        lai_panic("host does not provide timer functions required by Sleep()\n");
-    laihost_sleep(time.integer);
-}
-
 
 
 
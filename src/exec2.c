@@ -8,7 +8,10 @@
 #include "libc.h"
 #include "opregion.h"
 #include "exec_impl.h"
+#include "package.h"
+#include "bitfield.h"
 
+void lai_read_buffer(lai_object_t *, lai_nsnode_t *);
 void lai_write_buffer(lai_nsnode_t *, lai_object_t *);
 
 /* ACPI Control Method Execution */
@@ -65,15 +68,22 @@ resolve_alias:
 
 static void laihost_free_package(lai_object_t *object)
 {
+    // Constant packages might not have allocated the array yet.
+    if(!object->package)
+        return;
     for(int i = 0; i < object->package_size; i++)
         lai_free_object(&object->package[i]);
-    laihost_free(object->package);
+    lai_pool_free(object->package);
 }
 
 void lai_free_object(lai_object_t *object)
 {
-    if(object->type == LAI_BUFFER)
-        laihost_free(object->buffer);
+    if(object->borrowed)
+        ;   // The storage belongs to a Name().
+    else if(object->type == LAI_STRING)
+        lai_pool_free(object->string);
+    else if(object->type == LAI_BUFFER)
+        lai_pool_free(object->buffer);
     else if(object->type == LAI_PACKAGE)
         laihost_free_package(object);
 
@@ -109,7 +119,7 @@ static void lai_clone_buffer(lai_object_t *destination, lai_object_t *source)
 {
     destination->type = LAI_BUFFER;
     destination->buffer_size = source->buffer_size;
-    destination->buffer = laihost_malloc(source->buffer_size);
+    destination->buffer = lai_pool_alloc(source->buffer_size, LAI_MEMORY_BUFFER);
     if(!destination->buffer)
         lai_panic("unable to allocate memory for buffer object.\n");
 
@@ -124,7 +134,7 @@ static void lai_clone_buffer(lai_object_t *destination, lai_object_t *source)
 static void lai_clone_string(lai_object_t *destination, lai_object_t *source)
 {
     destination->type = LAI_STRING;
-    destination->string = laihost_malloc(lai_strlen(source->string) + 1);
+    destination->string = lai_pool_alloc(lai_strlen(source->string) + 1, LAI_MEMORY_STRING);
     if(!destination->string)
         lai_panic("unable to allocate memory for string object.\n");
 
@@ -140,10 +150,15 @@ static void lai_clone_package(lai_object_t *destination, lai_object_t *source)
 {
     destination->type = LAI_PACKAGE;
     destination->package_size = source->package_size;
-    destination->package = lai_calloc(source->package_size, sizeof(lai_object_t));
+    destination->package = lai_pool_calloc(source->package_size, sizeof(lai_object_t), LAI_MEMORY_PACKAGE);
     if(!destination->package)
         lai_panic("unable to allocate memory for package object.\n");
 
+    if(lai_package_is_lazy(source))
+    {
+        lai_package_clone(destination, source);
+        return;
+    }
     for(int i = 0; i < source->package_size; i++)
         lai_copy_object(&destination->package[i], &source->package[i]);
 }
@@ -155,9 +170,13 @@ static void lai_clone_package(lai_object_t *destination, lai_object_t *source)
 
 void lai_copy_object(lai_object_t *destination, lai_object_t *source)
 {
-    // First, clone into a temporary object.
+    // First, clone into a temporary object. Borrowed storage is immutable,
+    // so the copy can share it, too.
     lai_object_t temp;
-    if(source->type == LAI_STRING)
+    temp.borrowed = 0;
+    if(source->borrowed)
+        temp = *source;
+    else if(source->type == LAI_STRING)
         lai_clone_string(&temp, source);
     else if(source->type == LAI_BUFFER)
         lai_clone_buffer(&temp, source);
@@ -171,10 +190,44 @@ void lai_copy_object(lai_object_t *destination, lai_object_t *source)
     lai_free_object(&temp);
 }
 
+// lai_promote_object(): Moves the storage of an object out of the scratch arena.
+//                       Must be called for all objects that outlive the current method.
+// Param:    lai_object_t *object - object to promote
+// Return:   Nothing
+
+void lai_promote_object(lai_object_t *object)
+{
+    // Objects that outlive the method do not share storage with Name()s either.
+    if(object->borrowed)
+    {
+        lai_object_t temp = *object;
+        temp.borrowed = 0;
+        memset(object, 0, sizeof(lai_object_t));
+        lai_copy_object(object, &temp);
+    }
+
+    if(object->type == LAI_STRING)
+        object->string = lai_pool_promote(object->string);
+    else if(object->type == LAI_BUFFER)
+        object->buffer = lai_pool_promote(object->buffer);
+    else if(object->type == LAI_PACKAGE)
+    {
+        object->package = lai_pool_promote(object->package);
+        if(!object->package)
+            return;
+        for(int i = 0; i < object->package_size; i++)
+            lai_promote_object(&object->package[i]);
+    }
+}
+
 // lai_alias_copy(): Creates a reference to the storage of an object.
 
 void lai_alias_object(lai_object_t *alias, lai_object_t *object)
 {
+    // References can be written through; borrowed storage needs to be copied first.
+    if(object->borrowed)
+        lai_promote_object(object);
+
     if(object->type == LAI_STRING)
     {
         alias->type = LAI_STRING_REFERENCE;
@@ -186,6 +239,8 @@ void lai_alias_object(lai_object_t *alias, lai_object_t *object)
         alias->buffer = object->buffer;
     }else if(object->type == LAI_PACKAGE)
     {
+        // References can be written through, so all elements need to exist.
+        lai_package_materialize(object);
         alias->type = LAI_PACKAGE_REFERENCE;
         alias->package_size = object->package_size;
         alias->package = object->package;
@@ -193,13 +248,37 @@ void lai_alias_object(lai_object_t *alias, lai_object_t *object)
         lai_panic("object type %d is not valid for lai_alias_object()\n", object->type);
 }
 
+// lai_borrow_object(): Loads an immutable object without copying its storage
+// Param:    lai_object_t *object - destination
+// Param:    lai_object_t *source - object of a Name() that is never stored to
+// Return:   Nothing
+
+static void lai_borrow_object(lai_object_t *object, lai_object_t *source)
+{
+    // Elements of constant packages are decoded into the array of the Name().
+    if(lai_package_is_lazy(source))
+        lai_package_prepare(source);
+
+    lai_object_t temp = *source;
+    temp.borrowed = 1;
+    lai_move_object(object, &temp);
+}
+
 void lai_load_ns(lai_nsnode_t *source, lai_object_t *object)
 {
     if(source->type == LAI_NAMESPACE_NAME)
-        lai_copy_object(object, &source->object);
+    {
+        if(source->object_immutable && (source->object.type == LAI_STRING
+                || source->object.type == LAI_BUFFER || source->object.type == LAI_PACKAGE))
+            lai_borrow_object(object, &source->object);
+        else
+            lai_copy_object(object, &source->object);
+    }
     else if(source->type == LAI_NAMESPACE_FIELD || source->type == LAI_NAMESPACE_INDEXFIELD)
         // It's an Operation Region field; perform IO in that region.
         lai_read_opregion(object, source);
+    else if(source->type == LAI_NAMESPACE_BUFFER_FIELD)
+        lai_read_buffer(object, source);
     else if(source->type == LAI_NAMESPACE_DEVICE)
     {
         object->type = LAI_HANDLE;
@@ -208,11 +287,32 @@ void lai_load_ns(lai_nsnode_t *source, lai_object_t *object)
         lai_panic("unexpected type %d of named object in lai_load_ns()\n", source->type);
 }
 
+// lai_unshare_name(): Gives a Name() that was assumed to be immutable storage of its own
+// Param:    lai_nsnode_t *node - Name()
+// Return:   Nothing
+
+static void lai_unshare_name(lai_nsnode_t *node)
+{
+    // Loads of immutable Name()s share its storage; see lai_analyze_namespace().
+    // Objects that were loaded before may still refer to the old storage, so it
+    // is left to them and never freed.
+    lai_warn("store to %s, which was assumed to be immutable\n", node->path);
+    lai_object_t shared = node->object;
+    memset(&node->object, 0, sizeof(lai_object_t));
+    lai_copy_object(&node->object, &shared);
+    lai_promote_object(&node->object);
+    node->object_immutable = 0;
+}
+
 void lai_store_ns(lai_nsnode_t *target, lai_object_t *object)
 {
     if(target->type == LAI_NAMESPACE_NAME)
+    {
+        if(target->object_immutable)
+            lai_unshare_name(target);
         lai_copy_object(&target->object, object);
-    else if(target->type == LAI_NAMESPACE_FIELD || target->type == LAI_NAMESPACE_INDEXFIELD)
+        lai_promote_object(&target->object);
+    }else if(target->type == LAI_NAMESPACE_FIELD || target->type == LAI_NAMESPACE_INDEXFIELD)
     {
         lai_write_opregion(target, object);
     }else if(target->type == LAI_NAMESPACE_BUFFER_FIELD)
@@ -310,6 +410,9 @@ void lai_store_operand(lai_state_t *state, lai_object_t *target, lai_object_t *o
     }
     case LAI_PACKAGE_INDEX:
         lai_copy_object(&target->package[target->integer], object);
+        // Packages outside of the scratch arena may belong to a Name().
+        if(!lai_pool_is_scratch(target->package))
+            lai_promote_object(&target->package[target->integer]);
         break;
     case LAI_UNRESOLVED_NAME:
     {
@@ -346,52 +449,83 @@ void lai_store_operand(lai_state_t *state, lai_object_t *target, lai_object_t *o
     }
 }
 
-// lai_write_buffer(): Writes to a Buffer Field
+// lai_buffer_field_storage(): Returns the buffer that a buffer field refers to
 // Param:    lai_nsnode_t *handle - handle of buffer field
-// Param:    lai_object_t *source - object to write
-// Return:    Nothing
+// Param:    int write - non-zero if the field is written to
+// Return:   lai_object_t * - buffer that contains the field
 
-void lai_write_buffer(lai_nsnode_t *handle, lai_object_t *source)
+static lai_object_t *lai_buffer_field_storage(lai_nsnode_t *handle, int write)
 {
-    lai_nsnode_t *buffer_handle;
-    buffer_handle = lai_resolve(handle->buffer);
-
-    if(!buffer_handle)
-        lai_debug("undefined reference %s\n", handle->buffer);
-
-    uint64_t value = source->integer;
-
-    uint64_t offset = handle->buffer_offset / 8;
-    uint64_t bitshift = handle->buffer_offset % 8;
+    lai_object_t *buffer;
+    if(handle->buffer_object)
+    {
+        // ArgX or LocalX of a running method; its storage may be shared with a Name().
+        buffer = handle->buffer_object;
+        if(write && buffer->borrowed)
+            lai_promote_object(buffer);
+    }else
+    {
+        if(!handle->buffer[0])
+            lai_panic("buffer field %s was used after its method returned\n", handle->path);
+        lai_nsnode_t *buffer_handle = lai_resolve(handle->buffer);
+        if(!buffer_handle || buffer_handle->type != LAI_NAMESPACE_NAME)
+            lai_panic("undefined reference %s in buffer field %s\n", handle->buffer, handle->path);
+        if(write && buffer_handle->object_immutable)
+            lai_unshare_name(buffer_handle);
+        buffer = &buffer_handle->object;
+    }
 
-    value <<= bitshift;
+    // The Buffer() can be replaced after the field was created.
+    if(buffer->type != LAI_BUFFER)
+        lai_panic("buffer field %s refers to a non-buffer object\n", handle->path);
+    uint64_t bits = (uint64_t)buffer->buffer_size * 8;
+    if(handle->buffer_size > bits || handle->buffer_offset > bits - handle->buffer_size)
+        lai_panic("buffer field %s is out of bounds\n", handle->path);
+    return buffer;
+}
 
-    uint64_t mask = 1;
-    mask <<= bitshift;
-    mask--;
-    mask <<= bitshift;
+// lai_read_buffer(): Reads from a Buffer Field
+// Param:    lai_object_t *destination - where to read data
+// Param:    lai_nsnode_t *handle - handle of buffer field
+// Return:    Nothing
 
-    uint8_t *byte = (uint8_t*)(buffer_handle->object.buffer + offset);
-    uint16_t *word = (uint16_t*)(buffer_handle->object.buffer + offset);
-    uint32_t *dword = (uint32_t*)(buffer_handle->object.buffer + offset);
-    uint64_t *qword = (uint64_t*)(buffer_handle->object.buffer + offset);
+void lai_read_buffer(lai_object_t *destination, lai_nsnode_t *handle)
+{
+    lai_object_t *buffer = lai_buffer_field_storage(handle, 0);
 
-    if(handle->buffer_size <= 8)
-    {
-        byte[0] &= (uint8_t)mask;
-        byte[0] |= (uint8_t)value;
-    } else if(handle->buffer_size <= 16)
-    {
-        word[0] &= (uint16_t)mask;
-        word[0] |= (uint16_t)value;
-    } else if(handle->buffer_size <= 32)
-    {
-        dword[0] &= (uint32_t)mask;
-        dword[0] |= (uint32_t)value;
-    } else if(handle->buffer_size <= 64)
+    // Fields that fit into an Integer are read as an Integer.
+    if(handle->buffer_size <= 64)
     {
-        qword[0] &= mask;
-        qword[0] |= value;
+        destination->type = LAI_INTEGER;
+        destination->integer = lai_bitfield_extract(buffer->buffer, buffer->buffer_size,
+                handle->buffer_offset, handle->buffer_size);
+        return;
     }
+
+    size_t size = (handle->buffer_size + 7) / 8;
+    destination->type = LAI_BUFFER;
+    destination->buffer_size = size;
+    destination->buffer = lai_pool_alloc(size, LAI_MEMORY_BUFFER);
+    if(!destination->buffer)
+        lai_panic("failed to allocate memory for AML buffer");
+    memset(destination->buffer, 0, size);
+    lai_bitfield_copy(destination->buffer, size, 0, buffer->buffer, buffer->buffer_size,
+            handle->buffer_offset, handle->buffer_size);
 }
 
+// lai_write_buffer(): Writes to a Buffer Field
+// Param:    lai_nsnode_t *handle - handle of buffer field
+// Param:    lai_object_t *source - object to write
+// Return:    Nothing
+
+void lai_write_buffer(lai_nsnode_t *handle, lai_object_t *source)
+{
+    lai_object_t *buffer = lai_buffer_field_storage(handle, 1);
+
+    // The source is truncated or zero-extended to the size of the field.
+    uint8_t integer[8];
+    size_t size;
+    const uint8_t *data = lai_bitfield_source(source, integer, &size);
+    lai_bitfield_copy(buffer->buffer, buffer->buffer_size, handle->buffer_offset,
+            data, size, 0, handle->buffer_size);
+}
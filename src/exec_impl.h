@@ -8,6 +8,7 @@
 #pragma once
 
 #include <lai/core.h>
+#include "libc.h"
 
 // Evaluate constant data (and keep result).
 //     Primitive objects are parsed.
@@ -29,16 +30,42 @@ void lai_store_ns(lai_nsnode_t *, lai_object_t *);
 void lai_alias_operand(lai_state_t *, lai_object_t *, lai_object_t *);
 void lai_load_operand(lai_state_t *, lai_object_t *, lai_object_t *);
 void lai_store_operand(lai_state_t *, lai_object_t *, lai_object_t *);
-void lai_eval_operand(lai_object_t *, lai_state_t *, uint8_t *);
 
-void lai_free_object(lai_object_t *);
 void lai_move_object(lai_object_t *, lai_object_t *);
 void lai_copy_object(lai_object_t *, lai_object_t *);
+void lai_promote_object(lai_object_t *);
 
-void lai_exec_bytefield(void *, lai_nsnode_t *, lai_state_t *);
-void lai_exec_wordfield(void *, lai_nsnode_t *, lai_state_t *);
-void lai_exec_dwordfield(void *, lai_nsnode_t *, lai_state_t *);
-void lai_exec_sleep(void *, lai_state_t *);
-void lai_exec_name(void *, lai_nsnode_t *, lai_state_t *);
+// The operand stack is part of lai_state_t. These helpers are shared with the
+// interpreter microbenchmarks in tools/bench, which time them in isolation.
+
+// Pushes a new item to the opstack and returns it.
+static inline lai_object_t *lai_exec_push_opstack_or_die(lai_state_t *state) {
+    if(state->opstack_ptr == 16)
+        lai_panic("operand stack overflow\n");
+    lai_object_t *object = &state->opstack[state->opstack_ptr];
+    memset(object, 0, sizeof(lai_object_t));
+    state->opstack_ptr++;
+    return object;
+}
+
+// Returns the n-th item from the opstack.
+static inline lai_object_t *lai_exec_get_opstack(lai_state_t *state, int n) {
+    if(n >= state->opstack_ptr)
+        lai_panic("opstack access out of bounds"); // This is an internal execution error.
+    return &state->opstack[n];
+}
+
+// Removes n items from the opstack.
+static inline void lai_exec_pop_opstack(lai_state_t *state, int n) {
+    for(int k = 0; k < n; k++)
+        lai_free_object(&state->opstack[state->opstack_ptr - k - 1]);
+    state->opstack_ptr -= n;
+}
+
+void lai_exec_buffer_field(lai_state_t *, lai_object_t *, lai_object_t *, uint64_t, uint64_t);
+void lai_exec_release_buffer_fields(lai_state_t *);
+void lai_exec_name(lai_state_t *, lai_object_t *, lai_object_t *);
 
 lai_nsnode_t *lai_exec_resolve(char *);
+
+void lai_queue_notify(lai_nsnode_t *, uint64_t);
@@ -10,63 +10,117 @@
 #include "ns_impl.h"
 #include "eval.h"
 #include "libc.h"
+#include "exec_impl.h"
+#include "package.h"
 
-// lai_exec_name(): Creates a Name() object in a Method's private namespace
-// Param:    void *data - data
+// lai_exec_name(): Creates a Name() object, or replaces the object of an existing Name()
 // Param:    lai_state_t *state - AML VM state
-// Return:    size_t - size in bytes for skipping
+// Param:    lai_object_t *name - path of the Name(), as an unresolved name
+// Param:    lai_object_t *object - operand that holds the object
+// Return:   Nothing
 
-void lai_exec_name(void *data, lai_nsnode_t *parent, lai_state_t *state)
+void lai_exec_name(lai_state_t *state, lai_object_t *name, lai_object_t *object)
 {
-    state->pc++; // Skip over NAME_OP.
-    uint8_t *code = data;
-
-    char path[ACPI_MAX_NAME];
-    state->pc += lai_resolve_path(parent, path, code + state->pc);
-
     lai_nsnode_t *handle;
-    handle = lai_resolve(path);
+    handle = lai_resolve(name->name);
     if(!handle)
     {
         // Create it if it does not already exist.
         handle = lai_create_nsnode_or_die();
         handle->type = LAI_NAMESPACE_NAME;
-        lai_strcpy(handle->path, path);
+        lai_strcpy(handle->path, name->name);
         lai_install_nsnode(handle);
     }
 
-    lai_eval_operand(&handle->object, state, code);
+    // Constant packages refer to the AML code and must not be copied.
+    if(lai_package_is_lazy(object))
+        lai_move_object(&handle->object, object);
+    else
+        lai_load_operand(state, object, &handle->object);
+    lai_promote_object(&handle->object);
 }
 
-// lai_exec_bytefield(): Creates a ByteField object
-// Param:    void *data - data
+// lai_exec_buffer_field(): Creates a buffer field, or moves an existing one
 // Param:    lai_state_t *state - AML VM state
-
-void lai_exec_bytefield(void *data, lai_nsnode_t *parent, lai_state_t *state)
+// Param:    lai_object_t *source - Buffer() operand: an unresolved name, ArgX or LocalX
+// Param:    lai_object_t *name - path of the field, as an unresolved name
+// Param:    uint64_t offset - bit offset of the field
+// Param:    uint64_t size - number of bits
+// Return:   Nothing
+
+void lai_exec_buffer_field(lai_state_t *state, lai_object_t *source, lai_object_t *name,
+        uint64_t offset, uint64_t size)
 {
-    uint8_t *code = data;
-    state->pc += lai_create_bytefield(parent, code + state->pc);    // dirty af solution but good enough for now
-}
-
-
-// lai_exec_wordfield(): Creates a WordField object
-// Param:    void *data - data
-// Param:    lai_state_t *state - AML VM state
+    // Fields refer to a Name() by path. ArgX and LocalX have no path, e.g. in
+    // CreateDWordField (Arg3, 0, CDW1) of an _OSC; such fields refer to the object
+    // itself, until the method returns.
+    lai_nsnode_t *buffer_handle = NULL;
+    lai_object_t *buffer_object = NULL;
+    if(source->type == LAI_UNRESOLVED_NAME)
+    {
+        buffer_handle = lai_exec_resolve(source->name);
+        if(!buffer_handle || buffer_handle->type != LAI_NAMESPACE_NAME)
+            lai_panic("undefined reference %s in buffer field %s\n", source->name, name->name);
+    }else if(source->type == LAI_ARG_NAME)
+        buffer_object = &state->arg[source->index];
+    else if(source->type == LAI_LOCAL_NAME)
+        buffer_object = &state->local[source->index];
+    else
+        lai_panic("buffer fields of object type %d are not supported\n", source->type);
+    if(buffer_object && buffer_object->type != LAI_BUFFER)
+        lai_panic("buffer field %s refers to a non-buffer object\n", name->name);
+    if(!size)
+        lai_panic("buffer field %s has zero size\n", name->name);
+
+    // Methods that create fields run repeatedly, so the node is reused.
+    lai_nsnode_t *handle;
+    handle = lai_resolve(name->name);
+    if(!handle)
+    {
+        handle = lai_create_nsnode_or_die();
+        handle->type = LAI_NAMESPACE_BUFFER_FIELD;
+        lai_strcpy(handle->path, name->name);
+        lai_install_nsnode(handle);
+    }else if(handle->type != LAI_NAMESPACE_BUFFER_FIELD)
+        lai_panic("buffer field %s redefines an object of type %d\n", name->name, handle->type);
 
-void lai_exec_wordfield(void *data, lai_nsnode_t *parent, lai_state_t *state)
-{
-    uint8_t *code = data;
-    state->pc += lai_create_wordfield(parent, code + state->pc);    // dirty af solution but good enough for now
+    if(buffer_object)
+    {
+        handle->buffer[0] = 0;
+        handle->buffer_object = buffer_object;
+        state->buffer_fields = 1;
+    }else
+    {
+        lai_strcpy(handle->buffer, buffer_handle->path);
+        handle->buffer_object = NULL;
+    }
+    handle->buffer_offset = offset;
+    handle->buffer_size = size;
 }
 
+// lai_exec_release_buffer_fields(): Detaches buffer fields from the ArgX and LocalX of a state
+// Param:    lai_state_t *state - AML VM state that is about to be finalized
+// Return:   Nothing
 
-// lai_exec_dwordfield(): Creates a DwordField object
-// Param:    void *data - data
-// Param:    lai_state_t *state - AML VM state
-
-void lai_exec_dwordfield(void *data, lai_nsnode_t *parent, lai_state_t *state)
+void lai_exec_release_buffer_fields(lai_state_t *state)
 {
-    uint8_t *code = data;
-    state->pc += lai_create_dwordfield(parent, code + state->pc);    // dirty af solution but good enough for now
+    // The objects are freed with the state; the fields cannot be used afterwards.
+    for(size_t i = 0; i < lai_ns_size; i++)
+    {
+        lai_nsnode_t *node = lai_namespace[i];
+        if(node->type != LAI_NAMESPACE_BUFFER_FIELD || !node->buffer_object)
+            continue;
+
+        for(int j = 0; j < 7; j++)
+        {
+            if(node->buffer_object == &state->arg[j])
+                node->buffer_object = NULL;
+        }
+        for(int j = 0; j < 8; j++)
+        {
+            if(node->buffer_object == &state->local[j])
+                node->buffer_object = NULL;
+        }
+    }
+    state->buffer_fields = 0;
 }
-
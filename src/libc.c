@@ -40,32 +40,115 @@ void lai_panic(const char *fmt, ...)
     }
 }
 
-void *lai_calloc(size_t count, size_t item_size) {
-    size_t size = count * item_size;
-    void *p = laihost_malloc(size);
-    if(p)
-        memset(p, 0, size);
-    return p;
+// The string functions below process one machine word at a time. Words are only read
+// from aligned addresses, so they never cross a page boundary, even if they extend
+// past the terminating null byte. This is intentional; hence, ASan is disabled for them.
+typedef uintptr_t __attribute__((may_alias)) lai_word_t;
+
+#define LAI_WORD_SIZE   sizeof(lai_word_t)
+#define LAI_WORD_ONES   ((uintptr_t)-1 / 0xFF)    // 0x0101...01
+#define LAI_WORD_HIGHS  (LAI_WORD_ONES * 0x80)     // 0x8080...80
+
+// Non-zero if any byte of the word is zero.
+static inline uintptr_t lai_word_has_zero(uintptr_t word) {
+    return (word - LAI_WORD_ONES) & ~word & LAI_WORD_HIGHS;
+}
+
+static inline int lai_is_word_aligned(const void *p) {
+    return !((uintptr_t)p & (LAI_WORD_SIZE - 1));
 }
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+__attribute__((no_sanitize_address))
+size_t lai_strlen(const char *s) {
+    const char *it = s;
+    while((uintptr_t)it & 15) {
+        if(!*it)
+            return it - s;
+        it++;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    while(1) {
+        __m128i chunk = _mm_load_si128((const __m128i *)it);
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+        if(mask)
+            return (it - s) + __builtin_ctz(mask);
+        it += 16;
+    }
+}
+#else
+__attribute__((no_sanitize_address))
 size_t lai_strlen(const char *s) {
-    size_t len = 0;
-    for(size_t i = 0; s[i]; i++)
-        len++;
-    return len;
+    const char *it = s;
+    while(!lai_is_word_aligned(it)) {
+        if(!*it)
+            return it - s;
+        it++;
+    }
+
+    while(!lai_word_has_zero(*(const lai_word_t *)it))
+        it += LAI_WORD_SIZE;
+    while(*it)
+        it++;
+    return it - s;
 }
+#endif
 
+__attribute__((no_sanitize_address))
 char *lai_strcpy(char *dest, const char *src) {
     char *dest_it = (char *)dest;
     const char *src_it = (const char *)src;
+    while(!lai_is_word_aligned(src_it)) {
+        if(!(*(dest_it++) = *(src_it++)))
+            return dest;
+    }
+
+    // Copy whole words until the word that contains the terminator.
+    while(1) {
+        lai_word_t word = *(const lai_word_t *)src_it;
+        if(lai_word_has_zero(word))
+            break;
+        __builtin_memcpy(dest_it, &word, LAI_WORD_SIZE);
+        dest_it += LAI_WORD_SIZE;
+        src_it += LAI_WORD_SIZE;
+    }
+
     while(*src_it)
         *(dest_it++) = *(src_it++);
     *dest_it = 0;
     return dest;
 }
 
+__attribute__((no_sanitize_address))
 int lai_strcmp(const char *a, const char *b) {
     size_t i = 0;
+
+    // Word-wise comparison is only possible if both strings share the same alignment.
+    if(((uintptr_t)a & (LAI_WORD_SIZE - 1)) == ((uintptr_t)b & (LAI_WORD_SIZE - 1))) {
+        while(!lai_is_word_aligned(a + i)) {
+            unsigned char ac = a[i];
+            unsigned char bc = b[i];
+            if(ac != bc)
+                return (ac < bc) ? -1 : 1;
+            if(!ac)
+                return 0;
+            i++;
+        }
+
+        // Skip equal words that do not contain the terminator; the remainder
+        // (including the first difference) is handled byte-wise.
+        while(1) {
+            lai_word_t aw = *(const lai_word_t *)(a + i);
+            lai_word_t bw = *(const lai_word_t *)(b + i);
+            if(aw != bw || lai_word_has_zero(aw))
+                break;
+            i += LAI_WORD_SIZE;
+        }
+    }
+
     while(1) {
         unsigned char ac = a[i];
         unsigned char bc = b[i];
@@ -2,11 +2,37 @@
 
 // LAI internal header
 
-void *lai_calloc(size_t, size_t);
+// All allocations are accounted to one of the LAI_MEMORY_* categories.
+void *lai_alloc(size_t, int);
+void *lai_calloc(size_t, size_t, int);
+void *lai_realloc(void *, size_t, int);
+void lai_free(void *);
+
+// Storage of string, buffer and package objects is allocated from a pool.
+void *lai_pool_alloc(size_t, int);
+void *lai_pool_calloc(size_t, size_t, int);
+void lai_pool_free(void *);
+
+// While a control method runs, object storage comes from a scratch arena.
+int lai_scratch_begin(void);
+int lai_scratch_is_active(void);
+void lai_scratch_end(void);
+void *lai_pool_promote(void *);
+int lai_pool_is_scratch(void *);
+
 size_t lai_strlen(const char *);
 char *lai_strcpy(char *, const char *);
 int lai_strcmp(const char *, const char *);
 
+// Compares two NameSegs (exactly four bytes, not null-terminated).
+// __builtin_memcpy() is expanded inline even in freestanding builds.
+static inline int lai_nameseg_equal(const void *a, const void *b) {
+    uint32_t as, bs;
+    __builtin_memcpy(&as, a, 4);
+    __builtin_memcpy(&bs, b, 4);
+    return as == bs;
+}
+
 void lai_debug(const char *, ...);
 void lai_warn(const char *, ...);
 __attribute__((noreturn)) void lai_panic(const char *, ...);
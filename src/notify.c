@@ -0,0 +1,135 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Notify() Support */
+/* Firmware uses Notify() to inform the OS about events such as device checks,
+ * bus checks or battery and thermal changes. Notifications are queued while AML
+ * runs and delivered to the handlers later, by lai_dispatch_notify(). */
+
+#include <lai/core.h>
+#include "libc.h"
+#include "exec_impl.h"
+
+typedef struct lai_notification_t
+{
+    lai_nsnode_t *node;
+    uint64_t value;
+} lai_notification_t;
+
+// Pending notifications are the entries from lai_notify_head to lai_notify_count.
+static lai_notification_t *lai_notify_queue = NULL;
+static size_t lai_notify_head = 0;
+static size_t lai_notify_count = 0;
+static size_t lai_notify_capacity = 0;
+
+// lai_install_notify_handler(): Installs a Notify() handler on a namespace node
+// Param:    lai_nsnode_t *node - Device, Processor or ThermalZone
+// Param:    lai_notify_handler_t handler - handler function
+// Param:    void *context - passed to the handler
+// Return:   int - 0 on success
+
+int lai_install_notify_handler(lai_nsnode_t *node, lai_notify_handler_t handler, void *context)
+{
+    if(node->type != LAI_NAMESPACE_DEVICE && node->type != LAI_NAMESPACE_PROCESSOR
+            && node->type != LAI_NAMESPACE_THERMALZONE)
+    {
+        lai_warn("cannot install Notify() handler on %s, type %d\n", node->path, node->type);
+        return 1;
+    }
+
+    if(node->notify_handler)
+    {
+        lai_warn("%s already has a Notify() handler\n", node->path);
+        return 1;
+    }
+
+    node->notify_handler = handler;
+    node->notify_context = context;
+    return 0;
+}
+
+// lai_remove_notify_handler(): Removes the Notify() handler of a namespace node
+// Param:    lai_nsnode_t *node - node
+// Return:   Nothing
+
+void lai_remove_notify_handler(lai_nsnode_t *node)
+{
+    node->notify_handler = NULL;
+    node->notify_context = NULL;
+
+    // Drop notifications that are still pending for this node.
+    size_t j = lai_notify_head;
+    for(size_t i = lai_notify_head; i < lai_notify_count; i++)
+    {
+        if(lai_notify_queue[i].node != node)
+            lai_notify_queue[j++] = lai_notify_queue[i];
+    }
+    lai_notify_count = j;
+}
+
+// lai_queue_notify(): Queues a notification. Called by the Notify() opcode.
+// Param:    lai_nsnode_t *node - notified node
+// Param:    uint64_t value - notification value
+// Return:   Nothing
+
+void lai_queue_notify(lai_nsnode_t *node, uint64_t value)
+{
+    if(!node->notify_handler)
+    {
+        lai_debug("Notify(%s, 0x%lX) has no handler, ignoring...\n", node->path, value);
+        return;
+    }
+
+    // Coalesce notifications: if the same (node, value) pair is still pending,
+    // the handler will observe it anyway.
+    for(size_t i = lai_notify_head; i < lai_notify_count; i++)
+    {
+        if(lai_notify_queue[i].node == node && lai_notify_queue[i].value == value)
+            return;
+    }
+
+    if(lai_notify_count == lai_notify_capacity)
+    {
+        size_t new_capacity = lai_notify_capacity * 2;
+        if(!new_capacity)
+            new_capacity = 16;
+        lai_notification_t *new_queue;
+        new_queue = lai_realloc(lai_notify_queue, sizeof(lai_notification_t) * new_capacity,
+                LAI_MEMORY_STATE);
+        if(!new_queue)
+            lai_panic("could not reallocate Notify() queue\n");
+        lai_notify_queue = new_queue;
+        lai_notify_capacity = new_capacity;
+    }
+
+    lai_notify_queue[lai_notify_count].node = node;
+    lai_notify_queue[lai_notify_count].value = value;
+    lai_notify_count++;
+
+    if(lai_notify_count - lai_notify_head == 1 && laihost_schedule_notify)
+        laihost_schedule_notify();
+}
+
+// lai_dispatch_notify(): Calls the handlers of all pending notifications.
+//                        Must not be called while AML is executing.
+// Return:   Nothing
+
+void lai_dispatch_notify(void)
+{
+    // Handlers may evaluate AML that raises further notifications. Those are
+    // appended to the queue and delivered by this loop, too.
+    while(lai_notify_head < lai_notify_count)
+    {
+        // The entry is no longer pending, so it is not coalesced with new notifications.
+        lai_notification_t notification = lai_notify_queue[lai_notify_head++];
+
+        if(notification.node->notify_handler)
+            notification.node->notify_handler(notification.node, notification.value,
+                    notification.node->notify_context);
+    }
+
+    lai_notify_head = 0;
+    lai_notify_count = 0;
+}
@@ -12,6 +12,8 @@
 #include "exec_impl.h"
 #include "libc.h"
 #include "eval.h"
+#include "analyze.h"
+#include "verify.h"
 
 #define CODE_WINDOW            131072
 #define NAMESPACE_WINDOW       8192
@@ -26,15 +28,22 @@ size_t lai_acpins_size = 0;
 size_t lai_acpins_count = 0;
 extern char aml_test[];
 
+acpi_fadt_t *lai_fadt;
+acpi_aml_t *lai_dsdt;
 lai_nsnode_t **lai_namespace;
 size_t lai_ns_size = 0;
 size_t lai_ns_capacity = 0;
 
-void lai_load_table(void *);
+// The root is not part of lai_namespace[]; it only anchors the top-level nodes.
+static lai_nsnode_t lai_ns_root = {.path = "\\", .type = LAI_NAMESPACE_SCOPE};
+static lai_nsnode_t *lai_ns_last_linked;
+
+int lai_load_table(void *);
+static void lai_link_nsnode(lai_nsnode_t *);
 
 // Helper function to allocate a lai_nsnode_t.
 lai_nsnode_t *lai_create_nsnode(void) {
-    lai_nsnode_t *node = laihost_malloc(sizeof(lai_nsnode_t));
+    lai_nsnode_t *node = lai_alloc(sizeof(lai_nsnode_t), LAI_MEMORY_NAMESPACE);
     if(!node)
         return NULL;
     memset(node, 0, sizeof(lai_nsnode_t));
@@ -59,7 +68,8 @@ void lai_install_nsnode(lai_nsnode_t *node)
         if(!new_capacity)
             new_capacity = NAMESPACE_WINDOW;
         lai_nsnode_t **new_array;
-        new_array = laihost_realloc(lai_namespace, sizeof(lai_nsnode_t *) * new_capacity);
+        new_array = lai_realloc(lai_namespace, sizeof(lai_nsnode_t *) * new_capacity,
+                LAI_MEMORY_NAMESPACE);
         if(!new_array)
             lai_panic("could not reallocate namespace table\n");
         lai_namespace = new_array;
@@ -68,6 +78,171 @@ void lai_install_nsnode(lai_nsnode_t *node)
 
     /*lai_debug("created %s\n", node->path);*/
     lai_namespace[lai_ns_size++] = node;
+    lai_link_nsnode(node);
+}
+
+// NameSegs of the LAI_CHILD_* slots, in order.
+static const char lai_predefined_names[LAI_CHILD_COUNT][4] = {
+    "_HID", "_CID", "_UID", "_ADR", "_STA", "_CRS", "_PRS", "_SRS", "_PRT",
+    "_INI", "_BBN", "_SEG", "_PRW", "_PS0", "_PS1", "_PS2", "_PS3"
+};
+
+// lai_predefined_slot(): Finds the LAI_CHILD_* slot of a NameSeg
+// Param:    const char *name - NameSeg, exactly four characters
+// Return:    int - slot, -1 if the name is not one of the predefined children
+
+static int lai_predefined_slot(const char *name)
+{
+    if(name[0] != '_')
+        return -1;
+
+    for(int i = 0; i < LAI_CHILD_COUNT; i++)
+    {
+        if(lai_nameseg_equal(lai_predefined_names[i], name))
+            return i;
+    }
+
+    return -1;
+}
+
+// lai_has_predefined_slots(): Checks whether a node keeps pointers to its predefined children
+// Param:    lai_nsnode_t *node - node
+// Return:    int - non-zero for Devices, Processors and ThermalZones
+
+static int lai_has_predefined_slots(lai_nsnode_t *node)
+{
+    return node->type == LAI_NAMESPACE_DEVICE || node->type == LAI_NAMESPACE_PROCESSOR
+            || node->type == LAI_NAMESPACE_THERMALZONE;
+}
+
+// lai_link_nsnode(): Adds a node to the list of children of its parent
+// Param:    lai_nsnode_t *node - node that was just installed
+// Return:    Nothing
+
+static void lai_link_nsnode(lai_nsnode_t *node)
+{
+    size_t length = lai_strlen(node->path);
+    if(length < 6)
+        return;
+
+    // The parent's path is the node's path without the last ".XXXX".
+    lai_nsnode_t *parent = &lai_ns_root;
+    if(length > 6)
+    {
+        // AML is populated depth-first, so the parent is almost always the previously
+        // linked node or one of its ancestors. This avoids scanning the whole namespace.
+        parent = NULL;
+        for(lai_nsnode_t *ancestor = lai_ns_last_linked; ancestor; ancestor = ancestor->parent)
+        {
+            if(lai_strlen(ancestor->path) == length - 5
+                    && !memcmp(ancestor->path, node->path, length - 5))
+            {
+                parent = ancestor;
+                break;
+            }
+        }
+
+        if(!parent)
+        {
+            char parent_path[ACPI_MAX_NAME];
+            memcpy(parent_path, node->path, length - 5);
+            parent_path[length - 5] = 0;
+            parent = lai_resolve(parent_path);
+        }
+
+        if(!parent)
+        {
+            lai_debug("%s has no parent scope, it can only be found by path\n", node->path);
+            return;
+        }
+    }
+
+    // Children are kept in order of creation, so that lai_ns_get_child()
+    // finds the same node as lai_resolve() if a name is defined twice.
+    node->parent = parent;
+    if(parent->last_child)
+        parent->last_child->next_sibling = node;
+    else
+        parent->children = node;
+    parent->last_child = node;
+    lai_ns_last_linked = node;
+
+    // Like the list of children, the slots refer to the first definition of a name.
+    int slot = lai_predefined_slot(node->path + length - 4);
+    if(slot < 0 || !lai_has_predefined_slots(parent))
+        return;
+
+    if(!parent->predefined)
+    {
+        parent->predefined = lai_calloc(LAI_CHILD_COUNT, sizeof(lai_nsnode_t *),
+                LAI_MEMORY_NAMESPACE);
+        if(!parent->predefined)
+            lai_panic("could not allocate predefined slots of %s\n", parent->path);
+    }
+
+    if(!parent->predefined[slot])
+        parent->predefined[slot] = node;
+}
+
+// lai_ns_get_root(): Returns the root of the namespace
+// Return:    lai_nsnode_t * - root node
+
+lai_nsnode_t *lai_ns_get_root(void)
+{
+    return &lai_ns_root;
+}
+
+// lai_ns_get_child(): Finds a direct child of a namespace node
+// Param:    lai_nsnode_t *parent - parent node, see lai_ns_get_root()
+// Param:    const char *name - NameSeg of the child, exactly four characters
+// Return:    lai_nsnode_t * - child node, NULL if there is none
+
+lai_nsnode_t *lai_ns_get_child(lai_nsnode_t *parent, const char *name)
+{
+    if(parent->predefined)
+    {
+        int slot = lai_predefined_slot(name);
+        if(slot >= 0)
+            return parent->predefined[slot];
+    }
+
+    for(lai_nsnode_t *child = parent->children; child; child = child->next_sibling)
+    {
+        if(lai_nameseg_equal(child->path + lai_strlen(child->path) - 4, name))
+            return child;
+    }
+
+    return NULL;
+}
+
+// lai_ns_get_predefined(): Finds a predefined child of a namespace node
+// Param:    lai_nsnode_t *parent - parent node
+// Param:    int child - one of LAI_CHILD_*
+// Return:    lai_nsnode_t * - child node, NULL if there is none
+
+lai_nsnode_t *lai_ns_get_predefined(lai_nsnode_t *parent, int child)
+{
+    if(parent->predefined)
+        return parent->predefined[child];
+    return lai_ns_get_child(parent, lai_predefined_names[child]);
+}
+
+// lai_append_nameseg(): Appends a NameSeg to a path that is being built
+// Param:    char *fullpath - destination
+// Param:    size_t length - current length of fullpath
+// Param:    uint8_t *nameseg - four characters of AML
+// Return:    size_t - new length of fullpath
+
+static size_t lai_append_nameseg(char *fullpath, size_t length, uint8_t *nameseg)
+{
+    if(length + 4 >= ACPI_MAX_NAME)
+        lai_panic("path exceeds maximum length of %d\n", ACPI_MAX_NAME);
+
+    // NameSegs are always exactly four bytes; copy them as a single integer.
+    uint32_t segment;
+    __builtin_memcpy(&segment, nameseg, 4);
+    __builtin_memcpy(fullpath + length, &segment, 4);
+    return length + 4;
 }
 
 // acpins_resolve_path(): Resolves a path
@@ -77,52 +252,63 @@ void lai_install_nsnode(lai_nsnode_t *node)
 
 size_t lai_resolve_path(lai_nsnode_t *context, char *fullpath, uint8_t *path)
 {
+    // The length of fullpath is tracked explicitly; it is only null-terminated at the end.
+    size_t length;
     size_t name_size = 0;
     size_t multi_count = 0;
     size_t current_count = 0;
 
-    memset(fullpath, 0, ACPI_MAX_NAME);
-
     if(path[0] == ROOT_CHAR)
     {
         name_size = 1;
         fullpath[0] = ROOT_CHAR;
-        fullpath[1] = 0;
+        length = 1;
         path++;
-        if(lai_is_name(path[0]) || path[0] == DUAL_PREFIX || path[0] == MULTI_PREFIX)
+        if(path[0] == 0)
         {
-            fullpath[1] = '.';
-            fullpath[2] = 0;
+            // NullName: the path refers to the root itself.
+            fullpath[length] = 0;
+            return name_size + 1;
+        } else if(lai_is_name(path[0]))
+        {
+            fullpath[length++] = '.';
             goto start;
         } else
+        {
+            fullpath[length] = 0;
             return name_size;
+        }
     }
 
     if(context)
-        lai_strcpy(fullpath, context->path);
-    else
-        lai_strcpy(fullpath, "\\");
-    fullpath[lai_strlen(fullpath)] = '.';
+    {
+        length = lai_strlen(context->path);
+        memcpy(fullpath, context->path, length);
+    } else
+    {
+        fullpath[0] = ROOT_CHAR;
+        length = 1;
+    }
+    fullpath[length++] = '.';
 
 start:
     while(path[0] == PARENT_CHAR)
     {
         path++;
-        if(lai_strlen(fullpath) <= 2)
-            break;
-
         name_size++;
-        fullpath[lai_strlen(fullpath) - 5] = 0;
-        memset(fullpath + lai_strlen(fullpath), 0, 32);
+
+        // Each level consists of a dot and a NameSeg; the root can not be left.
+        if(length > 2)
+            length -= 5;
     }
 
     if(path[0] == DUAL_PREFIX)
     {
         name_size += 9;
         path++;
-        memcpy(fullpath + lai_strlen(fullpath), path, 4);
-        fullpath[lai_strlen(fullpath)] = '.';
-        memcpy(fullpath + lai_strlen(fullpath), path + 4, 4);
+        length = lai_append_nameseg(fullpath, length, path);
+        fullpath[length++] = '.';
+        length = lai_append_nameseg(fullpath, length, path + 4);
     } else if(path[0] == MULTI_PREFIX)
     {
         // skip MULTI_PREFIX and name count
@@ -137,35 +323,42 @@ start:
         while(current_count < multi_count)
         {
             name_size += 4;
-            memcpy(fullpath + lai_strlen(fullpath), path, 4);
+            length = lai_append_nameseg(fullpath, length, path);
             path += 4;
             current_count++;
             if(current_count >= multi_count)
                 break;
 
-            fullpath[lai_strlen(fullpath)] = '.';
+            fullpath[length++] = '.';
         }
+    } else if(path[0] == 0)
+    {
+        // NullName: drop the trailing dot again.
+        name_size++;
+        length--;
     } else
     {
         name_size += 4;
-        memcpy(fullpath + lai_strlen(fullpath), path, 4);
+        length = lai_append_nameseg(fullpath, length, path);
     }
 
+    fullpath[length] = 0;
     return name_size;
 }
 
 // Creates the ACPI namespace. Requires the ability to scan for ACPI tables - ensure this is
 // implemented in the host operating system.
-void lai_create_namespace(void)
+// Return:    int - 0 on success, 1 if the DSDT is malformed; no namespace is created then
+int lai_create_namespace(void)
 {
     if (!laihost_scan)
         lai_panic("lai_create_namespace() needs table management functions\n");
 
-    lai_namespace = lai_calloc(sizeof(lai_nsnode_t *), NAMESPACE_WINDOW);
+    lai_namespace = lai_calloc(sizeof(lai_nsnode_t *), NAMESPACE_WINDOW, LAI_MEMORY_NAMESPACE);
     if (!lai_namespace)
         lai_panic("unable to allocate memory.\n");
 
-    lai_acpins_code = laihost_malloc(CODE_WINDOW);
+    lai_acpins_code = lai_alloc(CODE_WINDOW, LAI_MEMORY_CODE);
     lai_acpins_allocation = CODE_WINDOW;
 
     //acpins_load_table(aml_test);    // custom AML table just for testing
@@ -177,8 +370,20 @@ void lai_create_namespace(void)
         lai_panic("unable to find ACPI FADT.\n");
     }
 
-    void *dsdt = laihost_scan("DSDT", 0);
-    lai_load_table(dsdt);
+    lai_dsdt = laihost_scan("DSDT", 0);
+    if(!lai_dsdt)
+        lai_panic("unable to find ACPI DSDT.\n");
+    if(lai_load_table(lai_dsdt))
+    {
+        // lai_load_table() has already explained why the table was rejected.
+        lai_verify_finish();
+        lai_free(lai_acpins_code);
+        lai_free(lai_namespace);
+        lai_acpins_code = NULL;
+        lai_acpins_allocation = 0;
+        lai_namespace = NULL;
+        return 1;
+    }
 
     // load all SSDTs
     size_t index = 0;
@@ -200,6 +405,17 @@ void lai_create_namespace(void)
         index++;
         psdt = laihost_scan("PSDT", index);
     }
+    lai_verify_finish();
+
+    // create the predefined root scopes
+    static const char *predefined_scopes[] = {"\\._GPE", "\\._PR_", "\\._SB_", "\\._SI_", "\\._TZ_"};
+    for(size_t i = 0; i < sizeof(predefined_scopes) / sizeof(char *); i++)
+    {
+        lai_nsnode_t *scope_node = lai_create_nsnode_or_die();
+        scope_node->type = LAI_NAMESPACE_SCOPE;
+        lai_strcpy(scope_node->path, predefined_scopes[i]);
+        lai_install_nsnode(scope_node);
+    }
 
     // create the OS-defined objects first
     lai_nsnode_t *osi_node = lai_create_nsnode_or_die();
@@ -229,20 +445,33 @@ void lai_create_namespace(void)
     lai_populate(NULL, lai_acpins_code, lai_acpins_size, &state);
     lai_finalize_state(&state);
 
+    // Method invocations can only be recognized once all names exist.
+    lai_analyze_namespace();
+
     lai_debug("ACPI namespace created, total of %d predefined objects.\n", lai_ns_size);
+    return 0;
 }
 
 // acpins_load_table(): Loads an AML table
 // Param:    void *ptr - pointer to table
-// Return:    Nothing
+// Return:    int - 0 on success, 1 if the table is malformed and was not loaded
 
-void lai_load_table(void *ptr)
+int lai_load_table(void *ptr)
 {
     acpi_aml_t *table = (acpi_aml_t*)ptr;
+
+    // Malformed tables are rejected here, before any of their code runs.
+    if(table->header.length < sizeof(acpi_header_t)
+            || lai_verify_aml(table->data, table->header.length - sizeof(acpi_header_t)))
+    {
+        lai_warn("rejecting malformed AML table '%c%c%c%c'\n", table->header.signature[0], table->header.signature[1], table->header.signature[2], table->header.signature[3]);
+        return 1;
+    }
+
     while(lai_acpins_size + table->header.length >= lai_acpins_allocation)
     {
         lai_acpins_allocation += CODE_WINDOW;
-        lai_acpins_code = laihost_realloc(lai_acpins_code, lai_acpins_allocation);
+        lai_acpins_code = lai_realloc(lai_acpins_code, lai_acpins_allocation, LAI_MEMORY_CODE);
     }
 
     // copy the actual AML code
@@ -252,6 +481,7 @@ void lai_load_table(void *ptr)
     lai_debug("loaded AML table '%c%c%c%c', total %d bytes of AML code.\n", table->header.signature[0], table->header.signature[1], table->header.signature[2], table->header.signature[3], lai_acpins_size);
 
     lai_acpins_count++;
+    return 0;
 }
 
 // acpins_create_field(): Creates a Field object in the namespace
@@ -413,6 +643,31 @@ size_t lai_create_field(lai_nsnode_t *parent, void *data)
     return size + 2;
 }
 
+// lai_classify_method(): Recognizes methods that do not need the interpreter
+// Param:    lai_nsnode_t *node - method, with pointer and size set
+// Return:   Nothing
+
+static void lai_classify_method(lai_nsnode_t *node)
+{
+    uint8_t *body = node->pointer;
+    node->method_class = LAI_METHOD_GENERIC;
+    if(node->size < 2 || body[0] != RETURN_OP)
+        return;
+
+    // The Return() must be the only statement of the body.
+    uint64_t integer;
+    if(lai_eval_integer(body + 1, &integer) == node->size - 1)
+    {
+        node->method_class = LAI_METHOD_CONSTANT;
+        node->method_constant = integer;
+    }else if(lai_is_name(body[1]))
+    {
+        char path[ACPI_MAX_NAME];
+        if(lai_resolve_path(node, path, body + 1) == node->size - 1)
+            node->method_class = LAI_METHOD_LOAD;
+    }
+}
+
 // acpins_create_method(): Registers a control method in the namespace
 // Param:    void *data - pointer to AML code
 // Return:    size_t - total size in bytes for skipping
@@ -439,6 +694,7 @@ size_t lai_create_method(lai_nsnode_t *parent, void *data)
     node->method_flags = method[0];
     node->pointer = (void*)(method + 1);
     node->size = size - pkgsize - name_length - 1;
+    lai_classify_method(node);
 
     /*lai_debug("control method %s, flags 0x%X (argc %d ", node->path, method[0], method[0] & METHOD_ARGC_MASK);
     if(method[0] & METHOD_SERIALIZED)
@@ -650,156 +906,6 @@ size_t lai_create_processor(lai_nsnode_t *parent, void *data)
     return size + 2;
 }
 
-// acpins_create_bytefield(): Creates a ByteField object for a buffer in the namespace
-// Param:    void *data - pointer to data
-// Return:    size_t - total size in bytes, for skipping
-
-size_t lai_create_bytefield(lai_nsnode_t *parent, void *data)
-{
-    uint8_t *bytefield = (uint8_t*)data;
-    bytefield++;        // skip BYTEFIELD_OP
-    size_t return_size = 1;
-
-    lai_nsnode_t *node = lai_create_nsnode_or_die();
-    node->type = LAI_NAMESPACE_BUFFER_FIELD;
-
-    // buffer name
-    size_t name_size;
-    name_size = lai_resolve_path(parent, node->buffer, bytefield);
-
-    return_size += name_size;
-    bytefield += name_size;
-
-    size_t integer_size;
-    uint64_t integer;
-    integer_size = lai_eval_integer(bytefield, &integer);
-
-    node->buffer_offset = integer * 8;
-    node->buffer_size = 8;
-
-    return_size += integer_size;
-    bytefield += integer_size;
-
-    name_size = lai_resolve_path(parent, node->path, bytefield);
-
-    lai_install_nsnode(node);
-    return_size += name_size;
-    return return_size;
-}
-
-// acpins_create_wordfield(): Creates a WordField object for a buffer in the namespace
-// Param:    void *data - pointer to data
-// Return:    size_t - total size in bytes, for skipping
-
-size_t lai_create_wordfield(lai_nsnode_t *parent, void *data)
-{
-    uint8_t *wordfield = (uint8_t*)data;
-    wordfield++;        // skip WORDFIELD_OP
-    size_t return_size = 1;
-
-    lai_nsnode_t *node = lai_create_nsnode_or_die();
-    node->type = LAI_NAMESPACE_BUFFER_FIELD;
-
-    // buffer name
-    size_t name_size;
-    name_size = lai_resolve_path(parent, node->buffer, wordfield);
-
-    return_size += name_size;
-    wordfield += name_size;
-
-    size_t integer_size;
-    uint64_t integer;
-    integer_size = lai_eval_integer(wordfield, &integer);
-
-    node->buffer_offset = integer * 8;
-    node->buffer_size = 16;    // bits
-
-    return_size += integer_size;
-    wordfield += integer_size;
-
-    name_size = lai_resolve_path(parent, node->path, wordfield);
-
-    //lai_debug("field %s for buffer %s, offset %d size %d bits\n", node->path, node->buffer, node->buffer_offset, node->buffer_size);
-
-    lai_install_nsnode(node);
-    return_size += name_size;
-    return return_size;
-}
-
-// acpins_create_dwordfield(): Creates a DwordField object for a buffer in the namespace
-// Param:    void *data - pointer to data
-// Return:    size_t - total size in bytes, for skipping
-
-size_t lai_create_dwordfield(lai_nsnode_t *parent, void *data)
-{
-    uint8_t *dwordfield = (uint8_t*)data;
-    dwordfield++;        // skip DWORDFIELD_OP
-    size_t return_size = 1;
-
-    lai_nsnode_t *node = lai_create_nsnode_or_die();
-    node->type = LAI_NAMESPACE_BUFFER_FIELD;
-
-    // buffer name
-    size_t name_size;
-    name_size = lai_resolve_path(parent, node->buffer, dwordfield);
-
-    return_size += name_size;
-    dwordfield += name_size;
-
-    size_t integer_size;
-    uint64_t integer;
-    integer_size = lai_eval_integer(dwordfield, &integer);
-
-    node->buffer_offset = integer * 8;
-    node->buffer_size = 32;
-
-    return_size += integer_size;
-    dwordfield += integer_size;
-
-    name_size = lai_resolve_path(parent, node->path, dwordfield);
-
-    lai_install_nsnode(node);
-    return_size += name_size;
-    return return_size;
-}
-
-// acpins_create_qwordfield(): Creates a QwordField object for a buffer in the namespace
-// Param:    void *data - pointer to data
-// Return:    size_t - total size in bytes, for skipping
-
-size_t lai_create_qwordfield(lai_nsnode_t *parent, void *data)
-{
-    uint8_t *qwordfield = (uint8_t*)data;
-    qwordfield++;        // skip QWORDFIELD_OP
-    size_t return_size = 1;
-
-    lai_nsnode_t *node = lai_create_nsnode_or_die();
-    node->type = LAI_NAMESPACE_BUFFER_FIELD;
-
-    // buffer name
-    size_t name_size;
-    name_size = lai_resolve_path(parent, node->buffer, qwordfield);
-
-    return_size += name_size;
-    qwordfield += name_size;
-
-    size_t integer_size;
-    uint64_t integer;
-    integer_size = lai_eval_integer(qwordfield, &integer);
-
-    node->buffer_offset = integer * 8;
-    node->buffer_size = 64;
-
-    return_size += integer_size;
-    qwordfield += integer_size;
-
-    name_size = lai_resolve_path(parent, node->path, qwordfield);
-
-    lai_install_nsnode(node);
-    return_size += name_size;
-    return return_size;
-}
-
 // acpins_resolve(): Returns a namespace object from its path
 // Param:    char *path - 4-char object name or full path
 // Return:    lai_nsnode_t * - pointer to namespace object, NULL on error
@@ -825,7 +931,7 @@ lai_nsnode_t *lai_resolve(char *path)
     {
         while(i < lai_ns_size)
         {
-            if(memcmp(lai_namespace[i]->path + lai_strlen(lai_namespace[i]->path) - 4, path, 4) == 0)
+            if(lai_nameseg_equal(lai_namespace[i]->path + lai_strlen(lai_namespace[i]->path) - 4, path))
                 return lai_namespace[i];
 
             else
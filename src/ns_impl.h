@@ -10,6 +10,8 @@
 #include <lai/core.h>
 
 // Namespace management.
+extern lai_nsnode_t **lai_namespace;
+
 lai_nsnode_t *lai_create_nsnode(void);
 lai_nsnode_t *lai_create_nsnode_or_die(void);
 void lai_install_nsnode(lai_nsnode_t *node);
@@ -22,10 +24,4 @@ size_t lai_create_mutex(lai_nsnode_t *, void *);
 size_t lai_create_indexfield(lai_nsnode_t *, void *);
 size_t lai_create_processor(lai_nsnode_t *, void *);
 
-
-size_t lai_create_bytefield(lai_nsnode_t *, void *);
-size_t lai_create_wordfield(lai_nsnode_t *, void *);
-size_t lai_create_dwordfield(lai_nsnode_t *, void *);
-size_t lai_create_qwordfield(lai_nsnode_t *, void *);
-
 size_t lai_resolve_path(lai_nsnode_t *, char *, uint8_t *);
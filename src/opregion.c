@@ -1,4 +1,3 @@
-
 /*
  * Lux ACPI Implementation
  * Copyright (C) 2018-2019 by Omar Muhamed
@@ -14,6 +13,27 @@
 #include "aml_opcodes.h"
 #include "libc.h"
 #include "opregion.h"
+#include "sync.h"
+#include "bitfield.h"
+
+// Describes the accesses to the access units that contain a field.
+// Everything that requires AML evaluation (i.e. the PCI address) is determined
+// before the access is performed, so that the hardware access itself can run
+// without the interpreter lock.
+typedef struct lai_field_access_t
+{
+    lai_nsnode_t *field;
+    lai_nsnode_t *opregion;
+
+    uint64_t offset;        // byte offset of the first access unit inside the OpRegion
+    size_t bit_offset;      // bit offset of the field inside the first access unit
+    size_t width;           // size of an access unit in bits
+
+    // these are for PCI
+    uint8_t pci_bus;
+    uint8_t pci_slot;
+    uint8_t pci_function;
+} lai_field_access_t;
 
 void lai_read_field(lai_object_t *, lai_nsnode_t *);
 void lai_write_field(lai_nsnode_t *, lai_object_t *);
@@ -52,12 +72,12 @@ void lai_write_opregion(lai_nsnode_t *field, lai_object_t *source)
     lai_panic("undefined field write: %s\n", field->path);
 }
 
-// lai_read_field(): Reads from a normal field
-// Param:    lai_object_t *destination - where to read data
+// lai_prepare_field(): Determines the access unit of a normal field
+// Param:    lai_field_access_t *access - destination
 // Param:    lai_nsnode_t *field - field
 // Return:    Nothing
 
-void lai_read_field(lai_object_t *destination, lai_nsnode_t *field)
+static void lai_prepare_field(lai_field_access_t *access, lai_nsnode_t *field)
 {
     lai_nsnode_t *opregion;
     opregion = lai_resolve(field->field_opregion);
@@ -66,121 +86,47 @@ void lai_read_field(lai_object_t *destination, lai_nsnode_t *field)
         lai_panic("Field: %s, OpRegion %s doesn't exist.\n", field->path, field->field_opregion);
     }
 
-    uint64_t offset, value, mask;
-    size_t bit_offset;
-
-    mask = ((uint64_t)1 << field->field_size);
-    mask--;
-    offset = field->field_offset / 8;
-    void *mmio;
-
-    // these are for PCI
-    char name[ACPI_MAX_NAME];
-    lai_object_t bus_number = {0};
-    lai_object_t address_number = {0};
-    int eval_status;
-    size_t pci_byte_offset;
+    memset(access, 0, sizeof(lai_field_access_t));
+    access->field = field;
+    access->opregion = opregion;
 
     if(opregion->op_address_space != OPREGION_PCI)
     {
         switch(field->field_flags & 0x0F)
         {
         case FIELD_BYTE_ACCESS:
-            bit_offset = field->field_offset % 8;
+            access->width = 8;
             break;
 
         case FIELD_WORD_ACCESS:
-            bit_offset = field->field_offset % 16;
-            offset &= (~1);        // clear lowest bit
+            access->width = 16;
             break;
 
         case FIELD_DWORD_ACCESS:
         case FIELD_ANY_ACCESS:
-            bit_offset = field->field_offset % 32;
-            offset &= (~3);        // clear lowest two bits
+            access->width = 32;
             break;
 
         case FIELD_QWORD_ACCESS:
-            bit_offset = field->field_offset % 64;
-            offset &= (~7);        // clear lowest three bits
+            access->width = 64;
             break;
 
         default:
             lai_panic("undefined field flags 0x%02X: %s\n", field->field_flags, field->path);
         }
     } else
-    {
-        bit_offset = field->field_offset % 32;
-        pci_byte_offset = field->field_offset % 4;
-    }
+        access->width = 32;    // PCI configuration space is accessed in dwords
 
-    // now read from either I/O ports, MMIO, or PCI config
-    if(opregion->op_address_space == OPREGION_IO)
-    {
-        // I/O port
-        switch(field->field_flags & 0x0F)
-        {
-        case FIELD_BYTE_ACCESS:
-            if(!laihost_inb)
-                lai_panic("host does not provide port I/O functions\n");
-            value = (uint64_t)laihost_inb(opregion->op_base + offset) >> bit_offset;
-            //lai_debug("read 0x%X from I/O port 0x%X, field %s\n", (uint8_t)value, opregion->op_base + offset, field->path);
-            break;
-        case FIELD_WORD_ACCESS:
-            if(!laihost_inw)
-                lai_panic("host does not provide port I/O functions\n");
-            value = (uint64_t)laihost_inw(opregion->op_base + offset) >> bit_offset;
-            //lai_debug("read 0x%X from I/O port 0x%X, field %s\n", (uint16_t)value, opregion->op_base + offset, field->path);
-            break;
-        case FIELD_DWORD_ACCESS:
-        case FIELD_ANY_ACCESS:
-            if(!laihost_ind)
-                lai_panic("host does not provide port I/O functions\n");
-            value = (uint64_t)laihost_ind(opregion->op_base + offset) >> bit_offset;
-            //lai_debug("read 0x%X from I/O port 0x%X, field %s\n", (uint32_t)value, opregion->op_base + offset, field->path);
-            break;
-        default:
-            lai_panic("undefined field flags 0x%02X: %s\n", field->field_flags, field->path);
-        }
-    } else if(opregion->op_address_space == OPREGION_MEMORY)
-    {
-        // Memory-mapped I/O
-        if(!laihost_map)
-            lai_panic("host does not provide memory mapping functions\n");
-        mmio = laihost_map(opregion->op_base + offset, 8);
-        uint8_t *mmio_byte;
-        uint16_t *mmio_word;
-        uint32_t *mmio_dword;
-        uint64_t *mmio_qword;
+    access->offset = (field->field_offset / access->width) * (access->width / 8);
+    access->bit_offset = field->field_offset % access->width;
 
-        switch(field->field_flags & 0x0F)
-        {
-        case FIELD_BYTE_ACCESS:
-            mmio_byte = (uint8_t*)mmio;
-            value = (uint64_t)mmio_byte[0] >> bit_offset;
-            //lai_debug("read 0x%X from MMIO 0x%lX, field %s\n", (uint8_t)value, opregion->op_base + offset, field->path);
-            break;
-        case FIELD_WORD_ACCESS:
-            mmio_word = (uint16_t*)mmio;
-            value = (uint64_t)mmio_word[0] >> bit_offset;
-            //lai_debug("read 0x%X from MMIO 0x%lX, field %s\n", (uint16_t)value, opregion->op_base + offset, field->path);
-            break;
-        case FIELD_DWORD_ACCESS:
-        case FIELD_ANY_ACCESS:
-            mmio_dword = (uint32_t*)mmio;
-            value = (uint64_t)mmio_dword[0] >> bit_offset;
-            //lai_debug("read dword 0x%X from MMIO 0x%lX, field %s\n", (uint32_t)value, opregion->op_base + offset, field->path);
-            break;
-        case FIELD_QWORD_ACCESS:
-            mmio_qword = (uint64_t*)mmio;
-            value = mmio_qword[0] >> bit_offset;
-            //lai_debug("read 0x%lX from MMIO 0x%lX, field %s\n", value, opregion->op_base + offset, field->path);
-            break;
-        default:
-            lai_panic("undefined field flags 0x%02X: %s\n", field->field_flags, field->path);
-        }
-    } else if(opregion->op_address_space == OPREGION_PCI)
+    if(opregion->op_address_space == OPREGION_PCI)
     {
+        lai_object_t bus_number = {0};
+        lai_object_t address_number = {0};
+        char name[ACPI_MAX_NAME];
+        int eval_status;
+
         // PCI bus number is in the _BBN object
         lai_strcpy(name, opregion->path);
         lai_strcpy(name + lai_strlen(name) - 4, "_BBN");
@@ -202,91 +148,28 @@ void lai_read_field(lai_object_t *destination, lai_nsnode_t *field)
         if(eval_status != 0)
         {
             address_number.type = LAI_INTEGER;
-            address_number.type = 0;
+            address_number.integer = 0;
         }
 
-        if(!laihost_pci_read)
-            lai_panic("host does not provide PCI access functions\n");
-        value = laihost_pci_read((uint8_t)bus_number.integer,
-                                 (uint8_t)(address_number.integer >> 16) & 0xFF,
-                                 (uint8_t)(address_number.integer & 0xFF),
-                                 (offset & 0xFFFC) + opregion->op_base);
-
-        //lai_debug("read 0x%X from PCI config 0x%X, %X:%X:%X\n", value, (uint16_t)(offset & 0xFFFC) + opregion->op_base, (uint8_t)bus_number.integer, (uint8_t)(address_number.integer >> 16) & 0xFF, (uint8_t)address_number.integer & 0xFF);
-        value >>= bit_offset;
-    } else
-    {
-        lai_panic("undefined opregion address space: %d\n", opregion->op_address_space);
+        access->pci_bus = (uint8_t)bus_number.integer;
+        access->pci_slot = (uint8_t)(address_number.integer >> 16) & 0xFF;
+        access->pci_function = (uint8_t)(address_number.integer & 0xFF);
     }
-
-    destination->type = LAI_INTEGER;
-    destination->integer = value & mask;
 }
 
-// lai_write_field(): Writes to a normal field
-// Param:    lai_nsnode_t *field - field
-// Param:    lai_object_t *source - data to write
-// Return:    Nothing
+// lai_read_access(): Reads an access unit of a field from hardware
+// Param:    lai_field_access_t *access - prepared access
+// Param:    uint64_t offset - byte offset of the access unit inside the OpRegion
+// Return:    uint64_t - contents of the access unit
 
-void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
+static uint64_t lai_read_access(lai_field_access_t *access, uint64_t offset)
 {
-    // determine the flags we need in order to write
-    lai_nsnode_t *opregion;
-    opregion = lai_resolve(field->field_opregion);
-    if(!opregion)
-    {
-        lai_panic("Field %s, OpRegion %s doesn't exist.\n", field->path, field->field_opregion);
-    }
-
-    uint64_t offset, value, mask;
-    size_t bit_offset;
-
-    mask = ((uint64_t)1 << field->field_size);
-    mask--;
-    offset = field->field_offset / 8;
+    lai_nsnode_t *field = access->field;
+    lai_nsnode_t *opregion = access->opregion;
+    uint64_t value;
     void *mmio;
 
-    // these are for PCI
-    char name[ACPI_MAX_NAME];
-    lai_object_t bus_number = {0};
-    lai_object_t address_number = {0};
-    int eval_status;
-    size_t pci_byte_offset;
-
-    if(opregion->op_address_space != OPREGION_PCI)
-    {
-        switch(field->field_flags & 0x0F)
-        {
-        case FIELD_BYTE_ACCESS:
-            bit_offset = field->field_offset % 8;
-            break;
-
-        case FIELD_WORD_ACCESS:
-            bit_offset = field->field_offset % 16;
-            offset &= (~1);        // clear lowest bit
-            break;
-
-        case FIELD_DWORD_ACCESS:
-        case FIELD_ANY_ACCESS:
-            bit_offset = field->field_offset % 32;
-            offset &= (~3);        // clear lowest two bits
-            break;
-
-        case FIELD_QWORD_ACCESS:
-            bit_offset = field->field_offset % 64;
-            offset &= (~7);        // clear lowest three bits
-            break;
-
-        default:
-            lai_panic("undefined field flags 0x%02X: %s\n", field->field_flags, field->path);
-        }
-    } else
-    {
-        bit_offset = field->field_offset % 32;
-        pci_byte_offset = field->field_offset % 4;
-    }
-
-    // read from the field
+    // read from either I/O ports, MMIO, or PCI config
     if(opregion->op_address_space == OPREGION_IO)
     {
         // I/O port
@@ -346,58 +229,30 @@ void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
         }
     } else if(opregion->op_address_space == OPREGION_PCI)
     {
-        // PCI bus number is in the _BBN object
-        lai_strcpy(name, opregion->path);
-        lai_strcpy(name + lai_strlen(name) - 4, "_BBN");
-        eval_status = lai_eval(&bus_number, name);
-
-        // when the _BBN object is not present, we assume PCI bus 0
-        if(eval_status != 0)
-        {
-            bus_number.type = LAI_INTEGER;
-            bus_number.integer = 0;
-        }
-
-        // device slot/function is in the _ADR object
-        lai_strcpy(name, opregion->path);
-        lai_strcpy(name + lai_strlen(name) - 4, "_ADR");
-        eval_status = lai_eval(&address_number, name);
-
-        // when this is not present, again default to zero
-        if(eval_status != 0)
-        {
-            address_number.type = LAI_INTEGER;
-            address_number.type = 0;
-        }
-
         if(!laihost_pci_read)
             lai_panic("host does not provide PCI access functions\n");
-        value = laihost_pci_read((uint8_t)bus_number.integer,
-                                 (uint8_t)(address_number.integer >> 16) & 0xFF,
-                                 (uint8_t)(address_number.integer & 0xFF),
+        value = laihost_pci_read(access->pci_bus, access->pci_slot, access->pci_function,
                                  (offset & 0xFFFC) + opregion->op_base);
     } else
     {
         lai_panic("undefined opregion address space: %d\n", opregion->op_address_space);
     }
 
-    // now determine how we need to write to the field
-    if(((field->field_flags >> 5) & 0x0F) == FIELD_PRESERVE)
-    {
-        value &= ~(mask << bit_offset);
-        value |= (source->integer << bit_offset);
-    } else if(((field->field_flags >> 5) & 0x0F) == FIELD_WRITE_ONES)
-    {
-        value = 0xFFFFFFFFFFFFFFFF;
-        value &= ~(mask << bit_offset);
-        value |= (source->integer << bit_offset);
-    } else
-    {
-        value = 0;
-        value |= (source->integer << bit_offset);
-    }
+    return value;
+}
+
+// lai_write_access(): Writes an access unit of a field to hardware
+// Param:    lai_field_access_t *access - prepared access
+// Param:    uint64_t offset - byte offset of the access unit inside the OpRegion
+// Param:    uint64_t value - new contents of the access unit
+// Return:    Nothing
+
+static void lai_write_access(lai_field_access_t *access, uint64_t offset, uint64_t value)
+{
+    lai_nsnode_t *field = access->field;
+    lai_nsnode_t *opregion = access->opregion;
+    void *mmio;
 
-    // finally, write to the field
     if(opregion->op_address_space == OPREGION_IO)
     {
         // I/O port
@@ -405,16 +260,13 @@ void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
         {
         case FIELD_BYTE_ACCESS:
             laihost_outb(opregion->op_base + offset, (uint8_t)value);
-            //lai_debug("wrote 0x%X to I/O port 0x%X\n", (uint8_t)value, opregion->op_base + offset);
             break;
         case FIELD_WORD_ACCESS:
             laihost_outw(opregion->op_base + offset, (uint16_t)value);
-            //lai_debug("wrote 0x%X to I/O port 0x%X\n", (uint16_t)value, opregion->op_base + offset);
             break;
         case FIELD_DWORD_ACCESS:
         case FIELD_ANY_ACCESS:
             laihost_outd(opregion->op_base + offset, (uint32_t)value);
-            //lai_debug("wrote 0x%X to I/O port 0x%X\n", (uint32_t)value, opregion->op_base + offset);
             break;
         default:
             lai_panic("undefined field flags 0x%02X: %s\n", field->field_flags, field->path);
@@ -439,23 +291,19 @@ void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
         case FIELD_BYTE_ACCESS:
             mmio_byte = (uint8_t*)mmio;
             mmio_byte[0] = (uint8_t)value;
-            //lai_debug("wrote 0x%X to MMIO address 0x%lX\n", (uint8_t)value, opregion->op_base + offset);
             break;
         case FIELD_WORD_ACCESS:
             mmio_word = (uint16_t*)mmio;
             mmio_word[0] = (uint16_t)value;
-            //lai_debug("wrote 0x%X to MMIO address 0x%lX\n", (uint16_t)value, opregion->op_base + offset);
             break;
         case FIELD_DWORD_ACCESS:
         case FIELD_ANY_ACCESS:
             mmio_dword = (uint32_t*)mmio;
             mmio_dword[0] = (uint32_t)value;
-            //lai_debug("wrote 0x%X to MMIO address 0x%lX\n", (uint32_t)value, opregion->op_base + offset);
             break;
         case FIELD_QWORD_ACCESS:
             mmio_qword = (uint64_t*)mmio;
             mmio_qword[0] = value;
-            //lai_debug("wrote 0x%lX to MMIO address 0x%lX\n", value, opregion->op_base + offset);
             break;
         default:
             lai_panic("undefined field flags 0x%02X\n", field->field_flags);
@@ -464,9 +312,7 @@ void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
     {
         if(!laihost_pci_write)
             lai_panic("host does not provide PCI access functions\n");
-        laihost_pci_write((uint8_t)bus_number.integer,
-                          (uint8_t)(address_number.integer >> 16) & 0xFF,
-                          (uint8_t)(address_number.integer & 0xFF),
+        laihost_pci_write(access->pci_bus, access->pci_slot, access->pci_function,
                           (offset & 0xFFFC) + opregion->op_base, (uint32_t)value);
     } else
     {
@@ -474,41 +320,139 @@ void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
     }
 }
 
-// lai_read_indexfield(): Reads from an IndexField
-// Param:    lai_object_t *destination - destination to read into
-// Param:    lai_nsnode_t *indexfield - index field
+// lai_extract_access(): Reads a field from its access units
+// Param:    lai_object_t *destination - where to read data
+// Param:    lai_field_access_t *access - prepared access
 // Return:    Nothing
 
-void lai_read_indexfield(lai_object_t *destination, lai_nsnode_t *indexfield)
+static void lai_extract_access(lai_object_t *destination, lai_field_access_t *access)
 {
-    lai_nsnode_t *field;
-    field = lai_resolve(indexfield->indexfield_index);
-    if(!field)
+    uint64_t size = access->field->field_size;
+    size_t data_size = (size + 7) / 8;
+    uint8_t integer[8] = {0};
+    uint8_t *data = integer;
+
+    // Fields that do not fit into an Integer are read as a Buffer.
+    if(size > 64)
     {
-        lai_panic("undefined reference %s\n", indexfield->indexfield_index);
+        data = lai_pool_alloc(data_size, LAI_MEMORY_BUFFER);
+        if(!data)
+            lai_panic("failed to allocate memory for AML buffer");
+        memset(data, 0, data_size);
     }
 
-    lai_object_t index = {0};
-    index.type = LAI_INTEGER;
-    index.integer = indexfield->indexfield_offset / 8;    // always byte-aligned
+    // Each access unit that the field spans contributes some of its bits.
+    uint64_t offset = access->offset;
+    size_t bit_offset = access->bit_offset;
+    for(uint64_t position = 0; position < size; )
+    {
+        size_t width = access->width - bit_offset;
+        if(width > size - position)
+            width = size - position;
 
-    lai_write_field(field, &index);    // the index register
+        uint64_t unit = lai_read_access(access, offset);
+        lai_bitfield_insert(data, data_size, position, width, unit >> bit_offset);
 
-    field = lai_resolve(indexfield->indexfield_data);
-    if(!field)
+        position += width;
+        offset += access->width / 8;
+        bit_offset = 0;
+    }
+
+    if(size > 64)
     {
-        lai_panic("undefined reference %s\n", indexfield->indexfield_data);
+        destination->type = LAI_BUFFER;
+        destination->buffer_size = data_size;
+        destination->buffer = data;
+    }else
+    {
+        destination->type = LAI_INTEGER;
+        destination->integer = lai_bitfield_fetch(data, data_size, 0, size);
     }
+}
+
+// lai_update_access(): Merges a value into the field's access units
+// Param:    lai_field_access_t *access - prepared access
+// Param:    lai_object_t *source - data to write
+// Return:    Nothing
 
-    lai_read_field(destination, field);    // the data register
+static void lai_update_access(lai_field_access_t *access, lai_object_t *source)
+{
+    lai_nsnode_t *field = access->field;
+    uint64_t size = field->field_size;
+    int rule = (field->field_flags >> 5) & 0x0F;
+
+    // The source is truncated or zero-extended to the size of the field.
+    uint8_t integer[8];
+    size_t data_size;
+    const uint8_t *data = lai_bitfield_source(source, integer, &data_size);
+
+    uint64_t offset = access->offset;
+    size_t bit_offset = access->bit_offset;
+    for(uint64_t position = 0; position < size; )
+    {
+        size_t width = access->width - bit_offset;
+        if(width > size - position)
+            width = size - position;
+
+        // The update rule only applies to the bits of the unit that are not part
+        // of the field; units that the field covers entirely are not read.
+        uint64_t unit = 0;
+        if(width < access->width)
+        {
+            if(rule == FIELD_PRESERVE)
+                unit = lai_read_access(access, offset);
+            else if(rule == FIELD_WRITE_ONES)
+                unit = ~(uint64_t)0;
+        }
+        unit = lai_bitfield_merge(unit, bit_offset, width,
+                lai_bitfield_fetch(data, data_size, position, width));
+        lai_write_access(access, offset, unit);
+
+        position += width;
+        offset += access->width / 8;
+        bit_offset = 0;
+    }
 }
 
-// lai_write_indexfield(): Writes to an IndexField
-// Param:    lai_nsnode_t *indexfield - index field
+// lai_read_field(): Reads from a normal field
+// Param:    lai_object_t *destination - where to read data
+// Param:    lai_nsnode_t *field - field
+// Return:    Nothing
+
+void lai_read_field(lai_object_t *destination, lai_nsnode_t *field)
+{
+    lai_field_access_t access;
+    lai_prepare_field(&access, field);
+
+    lai_enter_region(access.opregion);
+    lai_extract_access(destination, &access);
+    lai_leave_region(access.opregion);
+}
+
+// lai_write_field(): Writes to a normal field
+// Param:    lai_nsnode_t *field - field
 // Param:    lai_object_t *source - data to write
 // Return:    Nothing
 
-void lai_write_indexfield(lai_nsnode_t *indexfield, lai_object_t *source)
+void lai_write_field(lai_nsnode_t *field, lai_object_t *source)
+{
+    lai_field_access_t access;
+    lai_prepare_field(&access, field);
+
+    // The read-modify-write cycle must not be interrupted by other accesses.
+    lai_enter_region(access.opregion);
+    lai_update_access(&access, source);
+    lai_leave_region(access.opregion);
+}
+
+// lai_prepare_indexfield(): Determines the index and data accesses of an IndexField
+// Param:    lai_field_access_t *index_access - destination for the index register
+// Param:    lai_field_access_t *data_access - destination for the data register
+// Param:    lai_nsnode_t *indexfield - index field
+// Return:    Nothing
+
+static void lai_prepare_indexfield(lai_field_access_t *index_access,
+        lai_field_access_t *data_access, lai_nsnode_t *indexfield)
 {
     lai_nsnode_t *field;
     field = lai_resolve(indexfield->indexfield_index);
@@ -517,11 +461,7 @@ void lai_write_indexfield(lai_nsnode_t *indexfield, lai_object_t *source)
         lai_panic("undefined reference %s\n", indexfield->indexfield_index);
     }
 
-    lai_object_t index = {0};
-    index.type = LAI_INTEGER;
-    index.integer = indexfield->indexfield_offset / 8;    // always byte-aligned
-
-    lai_write_field(field, &index);    // the index register
+    lai_prepare_field(index_access, field);
 
     field = lai_resolve(indexfield->indexfield_data);
     if(!field)
@@ -529,10 +469,47 @@ void lai_write_indexfield(lai_nsnode_t *indexfield, lai_object_t *source)
         lai_panic("undefined reference %s\n", indexfield->indexfield_data);
     }
 
-    lai_write_field(field, source);    // the data register
+    lai_prepare_field(data_access, field);
 }
 
+// lai_read_indexfield(): Reads from an IndexField
+// Param:    lai_object_t *destination - destination to read into
+// Param:    lai_nsnode_t *indexfield - index field
+// Return:    Nothing
+
+void lai_read_indexfield(lai_object_t *destination, lai_nsnode_t *indexfield)
+{
+    lai_field_access_t index_access, data_access;
+    lai_prepare_indexfield(&index_access, &data_access, indexfield);
+
+    lai_object_t index = {0};
+    index.type = LAI_INTEGER;
+    index.integer = indexfield->indexfield_offset / 8;    // always byte-aligned
+
+    // The index and data registers are used as a pair; the region of the
+    // index register serializes all accesses through it.
+    lai_enter_region(index_access.opregion);
+    lai_update_access(&index_access, &index);    // the index register
+    lai_extract_access(destination, &data_access);    // the data register
+    lai_leave_region(index_access.opregion);
+}
 
+// lai_write_indexfield(): Writes to an IndexField
+// Param:    lai_nsnode_t *indexfield - index field
+// Param:    lai_object_t *source - data to write
+// Return:    Nothing
 
+void lai_write_indexfield(lai_nsnode_t *indexfield, lai_object_t *source)
+{
+    lai_field_access_t index_access, data_access;
+    lai_prepare_indexfield(&index_access, &data_access, indexfield);
 
+    lai_object_t index = {0};
+    index.type = LAI_INTEGER;
+    index.integer = indexfield->indexfield_offset / 8;    // always byte-aligned
 
+    lai_enter_region(index_access.opregion);
+    lai_update_access(&index_access, &index);    // the index register
+    lai_update_access(&data_access, source);    // the data register
+    lai_leave_region(index_access.opregion);
+}
@@ -0,0 +1,306 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Constant Packages */
+/* Name(X, Package() {...}) objects whose elements are all constant data are not
+ * materialized when the Name() is created. Instead, the object refers to the
+ * Package() in the AML code: buffer points to the PackageOp, buffer_size is the
+ * encoded size and handle is the scope that relative names are resolved in.
+ * The package array is only allocated when an element is accessed; at that time,
+ * each entry is a placeholder of type zero whose buffer points to the encoding of
+ * the element (i.e. the array is the offset index of the package). Placeholders
+ * are decoded one at a time by lai_package_element(). */
+
+#include <lai/core.h>
+#include "aml_opcodes.h"
+#include "libc.h"
+#include "ns_impl.h"
+#include "exec_impl.h"
+#include "eval.h"
+#include "package.h"
+
+// lai_package_header(): Parses the header of a Package()
+// Param:    uint8_t *code - PackageOp
+// Param:    size_t *size - receives the encoded size, including the PackageOp
+// Param:    int *elements - receives NumElements
+// Return:   size_t - offset of the first element
+
+static size_t lai_package_header(uint8_t *code, size_t *size, int *elements)
+{
+    size_t encoded_size;
+    size_t offset = 1 + lai_parse_pkgsize(code + 1, &encoded_size);
+    *size = encoded_size + 1;
+    *elements = code[offset];
+    return offset + 1;
+}
+
+// lai_package_decode(): Decodes (or only measures) a constant data object
+// Param:    lai_nsnode_t *scope - scope of relative names
+// Param:    uint8_t *code - encoding of the object
+// Param:    size_t limit - number of bytes available at code
+// Param:    lai_object_t *object - receives the object, NULL to only measure it
+// Return:   size_t - encoded size, 0 if the object is not constant data
+
+static size_t lai_package_decode(lai_nsnode_t *scope, uint8_t *code, size_t limit,
+        lai_object_t *object)
+{
+    uint64_t integer;
+    size_t size = lai_eval_integer(code, &integer);
+    if(size)
+    {
+        if(size > limit)
+            return 0;
+        if(object)
+        {
+            object->type = LAI_INTEGER;
+            object->integer = integer;
+        }
+        return size;
+    }
+
+    if(code[0] == STRINGPREFIX)
+    {
+        size_t n = 0;
+        while(1 + n < limit && code[1 + n])
+            n++;
+        if(1 + n == limit)
+            return 0;
+
+        if(object)
+        {
+            object->type = LAI_STRING;
+            object->string = lai_pool_alloc(n + 1, LAI_MEMORY_STRING);
+            if(!object->string)
+                lai_panic("failed to allocate memory for AML string");
+            memcpy(object->string, code + 1, n + 1);
+        }
+        return n + 2;
+    }
+
+    if(code[0] == BUFFER_OP)
+    {
+        size_t encoded_size;
+        size_t offset = 1 + lai_parse_pkgsize(code + 1, &encoded_size);
+        size = encoded_size + 1;
+        if(limit < 2 || size > limit || offset >= size)
+            return 0;
+
+        // Only buffers with a constant size are accepted.
+        uint64_t buffer_size;
+        size_t integer_size = lai_eval_integer(code + offset, &buffer_size);
+        if(!integer_size || offset + integer_size > size
+                || size - offset - integer_size > buffer_size)
+            return 0;
+        offset += integer_size;
+
+        if(object)
+        {
+            object->type = LAI_BUFFER;
+            object->buffer_size = buffer_size;
+            object->buffer = lai_pool_alloc(buffer_size, LAI_MEMORY_BUFFER);
+            if(!object->buffer)
+                lai_panic("failed to allocate memory for AML buffer");
+            memset(object->buffer, 0, buffer_size);
+            memcpy(object->buffer, code + offset, size - offset);
+        }
+        return size;
+    }
+
+    if(code[0] == PACKAGE_OP)
+    {
+        // Nested packages stay in the AML code, too.
+        if(limit < 3)
+            return 0;
+        int elements;
+        size_t offset = lai_package_header(code, &size, &elements);
+        if(size > limit || offset > size)
+            return 0;
+
+        if(object)
+        {
+            object->type = LAI_PACKAGE;
+            object->package_size = elements;
+            object->buffer_size = size;
+            object->buffer = code;
+            object->handle = scope;
+            return size;
+        }
+
+        int count = 0;
+        while(offset < size)
+        {
+            size_t element_size = lai_package_decode(scope, code + offset, size - offset, NULL);
+            if(!element_size || ++count > elements)
+                return 0;
+            offset += element_size;
+        }
+        return size;
+    }
+
+    if(lai_is_name(code[0]))
+    {
+        // Names are left unresolved, as in LAI_DATA_MODE.
+        char path[ACPI_MAX_NAME];
+        size = lai_resolve_path(scope, object ? object->name : path, code);
+        if(size > limit)
+            return 0;
+        if(object)
+            object->type = LAI_UNRESOLVED_NAME;
+        return size;
+    }
+
+    return 0;
+}
+
+// lai_package_skip(): Returns the encoded size of an element that was already checked
+// Param:    lai_nsnode_t *scope - scope of relative names
+// Param:    uint8_t *code - encoding of the element
+// Return:   size_t - encoded size
+
+static size_t lai_package_skip(lai_nsnode_t *scope, uint8_t *code)
+{
+    uint64_t integer;
+    size_t size = lai_eval_integer(code, &integer);
+    if(size)
+        return size;
+
+    if(code[0] == STRINGPREFIX)
+        return lai_strlen((char *)code + 1) + 2;
+    if(code[0] == BUFFER_OP || code[0] == PACKAGE_OP)
+    {
+        lai_parse_pkgsize(code + 1, &size);
+        return size + 1;
+    }
+
+    char path[ACPI_MAX_NAME];
+    return lai_resolve_path(scope, path, code);
+}
+
+// lai_package_scan(): Checks whether a Package() consists of constant data only
+// Param:    lai_nsnode_t *scope - scope of relative names
+// Param:    uint8_t *code - PackageOp
+// Param:    size_t limit - number of bytes available at code
+// Return:   size_t - encoded size of the package, 0 if it is not constant
+
+size_t lai_package_scan(lai_nsnode_t *scope, uint8_t *code, size_t limit)
+{
+    if(code[0] != PACKAGE_OP)
+        return 0;
+    return lai_package_decode(scope, code, limit, NULL);
+}
+
+// lai_package_init(): Creates a package object that refers to the AML code
+// Param:    lai_object_t *object - destination, must be empty
+// Param:    lai_nsnode_t *scope - scope of relative names
+// Param:    uint8_t *code - PackageOp, as checked by lai_package_scan()
+// Return:   Nothing
+
+void lai_package_init(lai_object_t *object, lai_nsnode_t *scope, uint8_t *code)
+{
+    lai_package_decode(scope, code, ~(size_t)0, object);
+}
+
+// lai_package_index(): Allocates the package array and records the offset of each element
+// Param:    lai_object_t *package - constant package
+// Return:   Nothing
+
+static void lai_package_index(lai_object_t *package)
+{
+    lai_object_t *index = lai_pool_calloc(package->package_size, sizeof(lai_object_t),
+            LAI_MEMORY_PACKAGE);
+    if(!index)
+        lai_panic("failed to allocate memory for AML package");
+    package->package = lai_pool_promote(index);
+
+    uint8_t *code = package->buffer;
+    size_t size;
+    int elements;
+    size_t offset = lai_package_header(code, &size, &elements);
+    for(int i = 0; offset < size; i++)
+    {
+        package->package[i].buffer = code + offset;
+        offset += lai_package_skip(package->handle, code + offset);
+    }
+}
+
+// lai_package_prepare(): Builds the offset index of a package, if it does not exist yet
+// Param:    lai_object_t *package - constant package
+// Return:   Nothing
+
+void lai_package_prepare(lai_object_t *package)
+{
+    if(!package->package)
+        lai_package_index(package);
+}
+
+// lai_package_decode_element(): Slow path of lai_package_element()
+// Param:    lai_object_t *package - package
+// Param:    size_t index - index of the element, must be in range
+// Return:   lai_object_t * - element
+
+lai_object_t *lai_package_decode_element(lai_object_t *package, size_t index)
+{
+    if(!package->package)
+        lai_package_index(package);
+
+    lai_object_t *element = &package->package[index];
+    if(!element->type && element->buffer)
+    {
+        uint8_t *code = element->buffer;
+        element->buffer = NULL;
+        lai_package_decode(package->handle, code, ~(size_t)0, element);
+        lai_promote_object(element);
+    }
+    return element;
+}
+
+// lai_package_materialize(): Decodes all elements of a package in place
+// Param:    lai_object_t *package - package
+// Return:   Nothing
+
+void lai_package_materialize(lai_object_t *package)
+{
+    if(!lai_package_is_lazy(package))
+        return;
+    for(int i = 0; i < package->package_size; i++)
+        lai_package_element(package, i);
+}
+
+// lai_package_clone(): Makes a fully decoded copy of a package that refers to the AML code
+// Param:    lai_object_t *destination - destination, with an allocated package array
+// Param:    lai_object_t *source - constant package
+// Return:   Nothing
+
+void lai_package_clone(lai_object_t *destination, lai_object_t *source)
+{
+    // Walk the encoding instead of building the index; the source is left as it is.
+    uint8_t *code = source->buffer;
+    size_t size;
+    int elements;
+    size_t offset = lai_package_header(code, &size, &elements);
+    for(int i = 0; i < source->package_size; i++)
+    {
+        // Elements that were decoded (and possibly stored to through a reference)
+        // are copied. This includes elements without an initializer.
+        if(source->package && source->package[i].type)
+        {
+            lai_copy_object(&destination->package[i], &source->package[i]);
+            if(offset < size)
+                offset += lai_package_skip(source->handle, code + offset);
+            continue;
+        }
+        if(offset >= size)
+            continue;
+
+        lai_object_t element = {0};
+        offset += lai_package_decode(source->handle, code + offset, size - offset, &element);
+        if(element.type == LAI_PACKAGE)
+        {
+            lai_copy_object(&destination->package[i], &element);
+            lai_free_object(&element);
+        }else
+            lai_move_object(&destination->package[i], &element);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+// Internal header file. Do not use outside of LAI.
+
+#pragma once
+
+#include <lai/core.h>
+
+// A package that still refers to the AML code; see package.c.
+static inline int lai_package_is_lazy(const lai_object_t *object)
+{
+    return object->type == LAI_PACKAGE && object->buffer;
+}
+
+size_t lai_package_scan(lai_nsnode_t *, uint8_t *, size_t);
+void lai_package_init(lai_object_t *, lai_nsnode_t *, uint8_t *);
+lai_object_t *lai_package_decode_element(lai_object_t *, size_t);
+void lai_package_prepare(lai_object_t *);
+void lai_package_materialize(lai_object_t *);
+void lai_package_clone(lai_object_t *, lai_object_t *);
+
+// lai_package_element(): Returns an element of a package, decoding it if necessary
+// Param:    lai_object_t *package - package
+// Param:    size_t index - index of the element, must be in range
+// Return:   lai_object_t * - element
+
+static inline lai_object_t *lai_package_element(lai_object_t *package, size_t index)
+{
+    // Placeholders of constant packages have type zero but point to their encoding.
+    if(package->package)
+    {
+        lai_object_t *element = &package->package[index];
+        if(element->type || !element->buffer)
+            return element;
+    }
+    return lai_package_decode_element(package, index);
+}
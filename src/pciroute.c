@@ -15,6 +15,7 @@
 #include <lai/core.h>
 #include "libc.h"
 #include "eval.h"
+#include "exec_impl.h"
 
 #define PCI_PNP_ID        "PNP0A03"
 
@@ -44,15 +45,13 @@ int lai_pci_route(acpi_resource_t *dest, uint8_t bus, uint8_t slot, uint8_t func
 
     size_t index = 0;
     lai_nsnode_t *handle = lai_get_deviceid(index, &pnp_id);
-    char path[ACPI_MAX_NAME];
+    lai_nsnode_t *bbn;
     int status;
 
     while(handle != NULL)
     {
-        lai_strcpy(path, handle->path);
-        lai_strcpy(path + lai_strlen(path), "._BBN");    // _BBN: Base bus number
-
-        status = lai_eval(&bus_number, path);
+        bbn = lai_ns_get_predefined(handle, LAI_CHILD_BBN);    // _BBN: Base bus number
+        status = bbn ? lai_eval_args(bbn, 0, NULL, &bus_number) : 1;
         if(status != 0)
         {
             // when _BBN is not present, we assume bus 0
@@ -71,12 +70,9 @@ int lai_pci_route(acpi_resource_t *dest, uint8_t bus, uint8_t slot, uint8_t func
         return 1;
 
     // read the PCI routing table
-    lai_strcpy(path, handle->path);
-    lai_strcpy(path + lai_strlen(path), "._PRT");    // _PRT: PCI Routing Table
-
-    lai_object_t prt = {0};
-    lai_object_t prt_package = {0};
-    lai_object_t prt_entry = {0};
+    lai_nsnode_t *prt_handle = lai_ns_get_predefined(handle, LAI_CHILD_PRT);    // _PRT: PCI Routing Table
+    if(!prt_handle)
+        return 1;
 
     /* _PRT is a package of packages. Each package within the PRT is in the following format:
        0: Integer:    Address of device. Low WORD = function, high WORD = slot
@@ -87,90 +83,86 @@ int lai_pci_route(acpi_resource_t *dest, uint8_t bus, uint8_t slot, uint8_t func
         of the specified device which contains the PCI interrupt. If offset 2 is an
         integer, this field is the ACPI GSI of this PCI IRQ. */
 
-    status = lai_eval(&prt, path);
-
-    if(status != 0)
-        return 1;
+    // A _PRT that is a Name() is read in place; only methods have to be evaluated.
+    lai_object_t prt_result = {0};
+    const lai_object_t *prt = lai_view_node(prt_handle);
+    if(!prt)
+    {
+        if(lai_eval_args(prt_handle, 0, NULL, &prt_result) != 0)
+            return 1;
+        prt = &prt_result;
+    }
 
-    size_t i = 0;
+    // From here on, prt_result and res must be freed before returning.
+    int ret = 1;
+    acpi_resource_t *res = NULL;
+    size_t res_count;
+    const lai_object_t *prt_package = NULL;
+    const lai_object_t *prt_entry;
+    uint64_t address, entry_pin, gsi;
 
-    while(1)
+    for(size_t i = 0; ; i++)
     {
         // read the _PRT package
-        status = lai_eval_package(&prt, i, &prt_package);
-        if(status != 0)
-            return 1;
-
-        if(prt_package.type != LAI_PACKAGE)
-            return 1;
+        const lai_object_t *candidate = lai_view_element(prt, i);
+        if(!candidate || candidate->type != LAI_PACKAGE)
+            goto done;
 
         // read the device address
-        status = lai_eval_package(&prt_package, 0, &prt_entry);
-        if(status != 0)
-            return 1;
-
-        if(prt_entry.type != LAI_INTEGER)
-            return 1;
+        if(lai_view_integer(lai_view_element(candidate, 0), &address))
+            goto done;
 
         // is this the device we want?
-        if((prt_entry.integer >> 16) == slot)
-        {
-            if((prt_entry.integer & 0xFFFF) == 0xFFFF || (prt_entry.integer & 0xFFFF) == function)
-            {
-                // is this the interrupt pin we want?
-                status = lai_eval_package(&prt_package, 1, &prt_entry);
-                if(status != 0)
-                    return 1;
+        if((address >> 16) != slot)
+            continue;
+        if((address & 0xFFFF) != 0xFFFF && (address & 0xFFFF) != function)
+            continue;
 
-                if(prt_entry.type != LAI_INTEGER)
-                    return 1;
+        // is this the interrupt pin we want?
+        if(lai_view_integer(lai_view_element(candidate, 1), &entry_pin))
+            goto done;
 
-                if(prt_entry.integer == pin)
-                    goto resolve_pin;
-            }
+        if(entry_pin == pin)
+        {
+            prt_package = candidate;
+            break;
         }
-
-        // nope, go on
-        i++;
     }
 
-resolve_pin:
     // here we've found what we need
     // is it a link device or a GSI?
-    status = lai_eval_package(&prt_package, 2, &prt_entry);
-    if(status != 0)
-        return 1;
-
-    acpi_resource_t *res;
-    size_t res_count;
+    prt_entry = lai_view_element(prt_package, 2);
+    if(!prt_entry)
+        goto done;
 
-    if(prt_entry.type == LAI_INTEGER)
+    if(prt_entry->type == LAI_INTEGER)
     {
         // GSI
-        status = lai_eval_package(&prt_package, 3, &prt_entry);
-        if(status != 0)
-            return 1;
+        if(lai_view_integer(lai_view_element(prt_package, 3), &gsi))
+            goto done;
 
         dest->type = ACPI_RESOURCE_IRQ;
-        dest->base = prt_entry.integer;
+        dest->base = gsi;
         dest->irq_flags = ACPI_IRQ_LEVEL | ACPI_IRQ_ACTIVE_HIGH | ACPI_IRQ_SHARED;
 
         lai_debug("PCI device %02X:%02X:%02X is using IRQ %d\n", bus, slot, function, (int)dest->base);
-        return 0;
-    } else if(prt_entry.type == LAI_HANDLE)
+        ret = 0;
+    } else if(prt_entry->type == LAI_HANDLE)
     {
         // PCI Interrupt Link Device
-        lai_debug("PCI interrupt link is %s\n", prt_entry.handle->path);
+        lai_debug("PCI interrupt link is %s\n", prt_entry->handle->path);
 
         // read the resource template of the device
-        res = lai_calloc(sizeof(acpi_resource_t), ACPI_MAX_RESOURCES);
-        res_count = lai_read_resource(prt_entry.handle, res);
+        res = lai_calloc(sizeof(acpi_resource_t), ACPI_MAX_RESOURCES, LAI_MEMORY_RESOURCE);
+        if(!res)
+            goto done;
+        res_count = lai_read_resource(prt_entry->handle, res);
 
         if(!res_count)
-            return 1;
+            goto done;
 
-        i = 0;
-        while(i < res_count)
+        ret = 0;
+        for(size_t i = 0; i < res_count; i++)
         {
             if(res[i].type == ACPI_RESOURCE_IRQ)
             {
@@ -178,28 +170,14 @@ resolve_pin:
                 dest->base = res[i].base;
                 dest->irq_flags = res[i].irq_flags;
 
-                laihost_free(res);
-
                 lai_debug("PCI device %02X:%02X:%02X is using IRQ %d\n", bus, slot, function, (int)dest->base);
-                return 0;
+                break;
             }
-
-            i++;
         }
+    }
 
-        return 0;
-    } else
-        return 1;
+done:
+    lai_free(res);
+    lai_free_object(&prt_result);
+    return ret;
 }
-
-
-
-
-
-
-
-
-
-
-
-
@@ -10,6 +10,7 @@
 
 #include <lai/core.h>
 #include "libc.h"
+#include "exec_impl.h"
 
 #define ACPI_SMALL_IRQ            0x04
 #define ACPI_SMALL_DMA            0x05
@@ -25,25 +26,14 @@
 #define ACPI_LARGE_FIXED_MEM32        0x86
 #define ACPI_LARGE_IRQ            0x89
 
-// lai_read_resource(): Reads a device's resource settings
-// Param:    lai_nsnode_t *device - device handle
+// lai_parse_resource(): Parses a resource template
+// Param:    uint8_t *data - resource template
 // Param:    acpi_resource_t *dest - destination array
 // Return:    size_t - count of entries successfully read
 
-size_t lai_read_resource(lai_nsnode_t *device, acpi_resource_t *dest)
+static size_t lai_parse_resource(uint8_t *data, acpi_resource_t *dest)
 {
-    char crs[ACPI_MAX_NAME];
-    lai_strcpy(crs, device->path);
-    lai_strcpy(crs + lai_strlen(crs), "._CRS");    // _CRS: current resource settings
-
-    lai_object_t buffer = {0};
-    int status = lai_eval(&buffer, crs);
-    if(status != 0)
-        return 0;
-
-    // read the resource buffer
     size_t count = 0;
-    uint8_t *data = (uint8_t*)buffer.buffer;
     size_t data_size;
 
     acpi_small_irq_t *small_irq;
@@ -128,9 +118,24 @@ size_t lai_read_resource(lai_nsnode_t *device, acpi_resource_t *dest)
     return count;
 }
 
+// lai_read_resource(): Reads a device's resource settings
+// Param:    lai_nsnode_t *device - device handle
+// Param:    acpi_resource_t *dest - destination array
+// Return:    size_t - count of entries successfully read
 
+size_t lai_read_resource(lai_nsnode_t *device, acpi_resource_t *dest)
+{
+    lai_nsnode_t *crs = lai_ns_get_predefined(device, LAI_CHILD_CRS);    // _CRS: current resource settings
+    if(!crs)
+        return 0;
 
+    lai_object_t buffer = {0};
+    if(lai_eval_args(crs, 0, NULL, &buffer))
+        return 0;
 
-
-
-
+    size_t count = 0;
+    if(buffer.type == LAI_BUFFER)
+        count = lai_parse_resource(buffer.buffer, dest);
+    lai_free_object(&buffer);
+    return count;
+}
@@ -9,11 +9,18 @@
 #include <lai/core.h>
 #include "libc.h"
 #include "exec_impl.h"
+#include "ns_impl.h"
+#include "sync.h"
 
-static void lai_init_children(char *);
+static void lai_init_children(lai_nsnode_t *);
+static void lai_init_children_parallel(lai_nsnode_t *);
 
 volatile uint16_t lai_last_event = 0;
 
+// Maximum number of worker threads used during device initialization.
+// Zero means that initialization runs serially on the calling thread.
+static size_t lai_init_workers = 0;
+
 // lai_read_event(): Reads the contents of the event register
 // Return:  uint16_t - contents of event register
 
@@ -59,6 +66,15 @@ void lai_set_event(uint16_t value)
     lai_debug("wrote event register value 0x%04X\n", value);
 }
 
+// lai_enable_parallel_init(): Enables parallel device initialization
+// Param:   size_t max_workers - maximum number of worker threads, 0 to disable
+// Return:  Nothing
+
+void lai_enable_parallel_init(size_t max_workers)
+{
+    lai_init_workers = max_workers;
+}
+
 // lai_enable_acpi(): Enables ACPI SCI
 // Param:   uint32_t mode - IRQ mode (ACPI spec section 5.8.1)
 // Return:  int - 0 on success
@@ -75,7 +91,8 @@ int lai_enable_acpi(uint32_t mode)
         lai_panic("host does not provide timer functions required by lai_enable_acpi()\n");
 
     /* first run \._SB_._INI */
-    handle = lai_resolve("\\._SB_._INI");
+    lai_nsnode_t *sb = lai_ns_get_child(lai_ns_get_root(), "_SB_");
+    handle = sb ? lai_ns_get_predefined(sb, LAI_CHILD_INI) : NULL;
     if(handle) {
         lai_init_state(&state);
         if(!lai_exec_method(handle, &state))
@@ -84,10 +101,13 @@ int lai_enable_acpi(uint32_t mode)
     }
 
     /* _STA/_INI for all devices */
-    lai_init_children("\\._SB_");
+    if(sb && lai_init_workers)
+        lai_init_children_parallel(sb);
+    else if(sb)
+        lai_init_children(sb);
 
     /* tell the firmware about the IRQ mode */
-    handle = lai_resolve("\\._PIC");
+    handle = lai_ns_get_child(lai_ns_get_root(), "_PIC");
     if(handle)
     {
         lai_init_state(&state);
@@ -115,6 +135,9 @@ int lai_enable_acpi(uint32_t mode)
     lai_set_event(ACPI_POWER_BUTTON | ACPI_SLEEP_BUTTON | ACPI_WAKE);
     lai_read_event();
 
+    /* resolve sleep states now, entering them should be fast */
+    lai_prepare_sleep();
+
     lai_debug("ACPI is now enabled.\n");
     return 0;
 }
@@ -124,60 +147,108 @@ static int evaluate_sta(lai_nsnode_t *node)
     // If _STA not present, assume 0x0F as ACPI spec says.
     int sta = 0x0F;
 
-    char path[ACPI_MAX_NAME];
-    lai_strcpy(path, node->path);
-    lai_strcpy(path + lai_strlen(path), "._STA");
-
-    lai_nsnode_t *handle = lai_resolve(path);
+    lai_nsnode_t *handle = lai_ns_get_predefined(node, LAI_CHILD_STA);
     if(handle)
     {
-        lai_state_t state;
-        lai_init_state(&state);
-        if(lai_eval_node(handle, &state))
+        lai_object_t result = {0};
+        if(lai_eval_args(handle, 0, NULL, &result))
             lai_panic("could not evaluate _STA\n");
-        sta = lai_retvalue(&state)->integer;
-        lai_finalize_state(&state);
+        sta = result.integer;
+        lai_free_object(&result);
     }
 
     return sta;
 }
 
-static void lai_init_children(char *parent)
+// Returns the first device among node and its following siblings, or NULL if there is none.
+static lai_nsnode_t *lai_next_device(lai_nsnode_t *node)
 {
-    lai_nsnode_t *node;
-    lai_nsnode_t *handle;
-    char path[ACPI_MAX_NAME];
+    while(node && node->type != LAI_NAMESPACE_DEVICE)
+        node = node->next_sibling;
+    return node;
+}
 
-    for(size_t i = 0; i < lai_ns_size; i++)
-    {
-        node = lai_enum(parent, i);
-        if(!node) return;
+static void lai_init_device(lai_nsnode_t *node)
+{
+    int sta = evaluate_sta(node);
 
-        if(node->type == LAI_NAMESPACE_DEVICE)
+    /* if device is present, evaluate its _INI */
+    if(sta & ACPI_STA_PRESENT)
+    {
+        lai_nsnode_t *handle = lai_ns_get_predefined(node, LAI_CHILD_INI);
+        if(handle)
         {
-            int sta = evaluate_sta(node);
-
-            /* if device is present, evaluate its _INI */
-            if(sta & ACPI_STA_PRESENT)
-            {
-                lai_strcpy(path, node->path);
-                lai_strcpy(path + lai_strlen(path), "._INI");
-                handle = lai_resolve(path);
-
-                if(handle)
-                {
-                    lai_state_t state;
-                    lai_init_state(&state);
-                    if(!lai_exec_method(handle, &state))
-                        lai_debug("evaluated %s\n", path);
-                    lai_finalize_state(&state);
-                }
-            }
-
-            /* if functional and/or present, enumerate the children */
-            if(sta & ACPI_STA_PRESENT || sta & ACPI_STA_FUNCTION)
-                lai_init_children(node->path);
+            lai_object_t result = {0};
+            if(!lai_eval_args(handle, 0, NULL, &result))
+                lai_debug("evaluated %s\n", handle->path);
+            lai_free_object(&result);
         }
     }
+
+    /* if functional and/or present, enumerate the children */
+    if(sta & ACPI_STA_PRESENT || sta & ACPI_STA_FUNCTION)
+        lai_init_children(node);
+}
+
+static void lai_init_children(lai_nsnode_t *parent)
+{
+    for(lai_nsnode_t *node = lai_next_device(parent->children); node;
+            node = lai_next_device(node->next_sibling))
+        lai_init_device(node);
+}
+
+typedef struct lai_init_work_t
+{
+    lai_nsnode_t *next;        // next unclaimed child, protected by the interpreter lock
+} lai_init_work_t;
+
+// Worker thread for parallel device initialization. Each worker picks the next
+// unclaimed child of the parent and initializes its whole subtree serially.
+// Thus, parents are always initialized before their children.
+static void lai_init_worker(void *context)
+{
+    lai_init_work_t *work = context;
+    lai_nsnode_t *node;
+
+    lai_lock_interpreter();
+    while((node = work->next))
+    {
+        work->next = lai_next_device(node->next_sibling);
+        lai_init_device(node);
+    }
+    lai_unlock_interpreter();
 }
 
+static void lai_init_children_parallel(lai_nsnode_t *parent)
+{
+    if(!laihost_create_thread || !laihost_join_thread)
+        lai_panic("host does not provide the thread functions required for parallel init\n");
+
+    lai_init_work_t work;
+    work.next = lai_next_device(parent->children);
+
+    // There is no point in starting more workers than there are subtrees.
+    size_t count = 0;
+    for(lai_nsnode_t *node = work.next; node; node = lai_next_device(node->next_sibling))
+        count++;
+    if(count > lai_init_workers)
+        count = lai_init_workers;
+
+    void **threads = lai_calloc(count, sizeof(void *), LAI_MEMORY_STATE);
+    if(count && !threads)
+        lai_panic("unable to allocate memory for worker threads\n");
+
+    lai_sync_begin();
+    for(size_t i = 0; i < count; i++)
+    {
+        threads[i] = laihost_create_thread(lai_init_worker, &work);
+        if(!threads[i])
+            lai_panic("unable to create worker thread for device initialization\n");
+    }
+
+    for(size_t i = 0; i < count; i++)
+        laihost_join_thread(threads[i]);
+    lai_sync_end();
+
+    lai_free(threads);
+}
@@ -1,16 +1,184 @@
-
 /*
  * Lux ACPI Implementation
  * Copyright (C) 2018-2019 by Omar Muhamed
  */
 
 /* Sleeping Functions */
-/* As of now, it's only for S5 (shutdown) sleep, because other sleeping states
- * need NVS and other things I still need to research */
+/* lai_prepare_sleep() evaluates the \_Sx_ packages and looks up _PTS, _GTS, _WAK
+ * and _SST once. lai_enter_sleep() then runs _PTS and _GTS, sets the system status
+ * indicator and writes SLP_TYP and SLP_EN to enter any of S1-S5. For the states that
+ * return, it waits for WAK_STS, using the SCI where the host can wait for it, and
+ * runs _WAK and _SST afterwards. Saving and restoring memory and processor context
+ * for S3 and S4 is left to the host. */
 
 #include <lai/core.h>
 #include "libc.h"
 #include "eval.h"
+#include "exec_impl.h"
+
+// Values of the _SST argument (system status indicator).
+#define ACPI_SST_WORKING        1
+#define ACPI_SST_WAKING         2
+#define ACPI_SST_SLEEPING       3
+#define ACPI_SST_SLEEP_CONTEXT  4
+
+typedef struct lai_sleep_state_t
+{
+    int supported;
+    uint8_t slp_typa;
+    uint8_t slp_typb;
+} lai_sleep_state_t;
+
+// Everything that lai_enter_sleep() needs is resolved by lai_prepare_sleep(),
+// so that entering a sleep state only executes methods and writes registers.
+static int lai_sleep_prepared = 0;
+static lai_sleep_state_t lai_sleep_states[6];
+static lai_nsnode_t *lai_pts_handle;
+static lai_nsnode_t *lai_gts_handle;
+static lai_nsnode_t *lai_wak_handle;
+static lai_nsnode_t *lai_sst_handle;
+
+// lai_prepare_sleep_state(): Evaluates the \_Sx_ package of a sleep state
+// Param:    uint8_t state - 0-5 to correspond with states S0-S5
+// Return:    Nothing
+
+static void lai_prepare_sleep_state(uint8_t state)
+{
+    lai_sleep_state_t *sleep_state = &lai_sleep_states[state];
+    memset(sleep_state, 0, sizeof(lai_sleep_state_t));
+
+    char name[] = "_Sx_";
+    name[2] = state + '0';
+
+    lai_nsnode_t *handle = lai_ns_get_child(lai_ns_get_root(), name);
+    if(!handle)
+        return;
+
+    // \_Sx_ is almost always a Name() that can be read in place. Only methods
+    // need to be evaluated.
+    lai_object_t result = {0};
+    const lai_object_t *package = lai_view_node(handle);
+    if(!package)
+    {
+        if(lai_eval_args(handle, 0, NULL, &result) != 0)
+            return;
+        package = &result;
+    }
+
+    uint64_t typa, typb;
+    if(lai_view_integer(lai_view_element(package, 0), &typa))
+    {
+        lai_warn("%s is not a valid sleep package, ignoring...\n", handle->path);
+        lai_free_object(&result);
+        return;
+    }
+
+    if(!lai_view_integer(lai_view_element(package, 1), &typb))
+    {
+        sleep_state->slp_typa = typa & 7;
+        sleep_state->slp_typb = typb & 7;
+    } else
+    {
+        // Some old firmware packs both values into a single integer.
+        sleep_state->slp_typa = typa & 7;
+        sleep_state->slp_typb = (typa >> 8) & 7;
+    }
+
+    sleep_state->supported = 1;
+    lai_free_object(&result);
+}
+
+// lai_prepare_sleep(): Resolves and validates all sleep states and the
+//                      methods that are required to enter them
+// Return:    int - 0 on success
+
+int lai_prepare_sleep(void)
+{
+    for(uint8_t state = 0; state <= 5; state++)
+    {
+        lai_prepare_sleep_state(state);
+        if(lai_sleep_states[state].supported)
+            lai_debug("sleep state S%d: SLP_TYPa %d, SLP_TYPb %d\n", state,
+                    lai_sleep_states[state].slp_typa, lai_sleep_states[state].slp_typb);
+    }
+
+    lai_nsnode_t *root = lai_ns_get_root();
+    lai_pts_handle = lai_ns_get_child(root, "_PTS");
+    lai_gts_handle = lai_ns_get_child(root, "_GTS");
+    lai_wak_handle = lai_ns_get_child(root, "_WAK");
+
+    lai_nsnode_t *si = lai_ns_get_child(root, "_SI_");
+    lai_sst_handle = si ? lai_ns_get_child(si, "_SST") : NULL;
+
+    lai_sleep_prepared = 1;
+    return 0;
+}
+
+// lai_exec_sleep_method(): Executes _PTS, _GTS, _WAK or _SST
+// Param:    lai_nsnode_t *handle - method, may be NULL
+// Param:    uint8_t argument - sleep state or indicator value
+// Return:    Nothing
+
+static void lai_exec_sleep_method(lai_nsnode_t *handle, uint8_t argument)
+{
+    if(!handle)
+        return;
+
+    lai_object_t arg = {0};
+    arg.type = LAI_INTEGER;
+    arg.integer = argument;
+
+    lai_object_t result = {0};
+    lai_debug("execute %s(%d)\n", handle->path, argument);
+    lai_eval_args(handle, 1, &arg, &result);
+    lai_free_object(&result);
+}
+
+// lai_wake_pending(): Checks whether the system has woken up
+// Return:    int - 1 if WAK_STS is set
+
+static int lai_wake_pending(void)
+{
+    // The host's SCI handler may already have consumed the status bit.
+    if(lai_last_event & ACPI_WAKE)
+        return 1;
+
+    uint16_t status = laihost_inw(lai_fadt->pm1a_event_block);
+    if(lai_fadt->pm1b_event_block)
+        status |= laihost_inw(lai_fadt->pm1b_event_block);
+    return (status & ACPI_WAKE) ? 1 : 0;
+}
+
+// lai_clear_wake(): Clears WAK_STS
+// Return:    Nothing
+
+static void lai_clear_wake(void)
+{
+    // WAK_STS is cleared by writing a one to it.
+    laihost_outw(lai_fadt->pm1a_event_block, ACPI_WAKE);
+    if(lai_fadt->pm1b_event_block)
+        laihost_outw(lai_fadt->pm1b_event_block, ACPI_WAKE);
+    lai_last_event &= ~ACPI_WAKE;
+}
+
+// lai_wait_for_wake(): Waits until WAK_STS is set, then clears it
+// Return:    Nothing
+
+static void lai_wait_for_wake(void)
+{
+    while(!lai_wake_pending())
+    {
+        // Wake events are signaled through the SCI, so it is enough to re-check
+        // the status after each interrupt. Hosts without such a primitive
+        // at least avoid spinning at full speed.
+        if(laihost_wait_for_interrupt)
+            laihost_wait_for_interrupt();
+        else if(laihost_sleep)
+            laihost_sleep(1);
+    }
+
+    lai_clear_wake();
+}
 
 // lai_enter_sleep(): Enters a sleeping state
 // Param:    uint8_t state - 0-5 to correspond with states S0-S5
@@ -27,23 +195,11 @@ int lai_enter_sleep(uint8_t state)
         return 1;
     }
 
-    uint8_t sleep_object[] = "_Sx_";
-    sleep_object[2] = state + '0';
+    if(!lai_sleep_prepared)
+        lai_prepare_sleep();
 
-    // get sleeping package
-    lai_nsnode_t *handle = lai_resolve((char*)sleep_object);
-    if(!handle)
-    {
-        lai_debug("sleep state S%d is not supported.\n", state);
-        return 1;
-    }
-
-    lai_object_t package = {0};
-    lai_object_t slp_typa = {0};
-    lai_object_t slp_typb = {0};
-    int eval_status;
-    eval_status = lai_eval(&package, handle->path);
-    if(eval_status != 0)
+    lai_sleep_state_t *sleep_state = &lai_sleep_states[state];
+    if(!sleep_state->supported)
     {
         lai_debug("sleep state S%d is not supported.\n", state);
         return 1;
@@ -53,59 +209,38 @@ int lai_enter_sleep(uint8_t state)
 
     // ACPI spec says we should call _PTS() and _GTS() before actually sleeping
     // Who knows, it might do some required firmware-specific stuff
-    lai_state_t acpi_state;
-    handle = lai_resolve("_PTS");
-
-    if(handle)
-    {
-        lai_init_state(&acpi_state);
-
-        // pass the sleeping type as an argument
-        lai_arg(&acpi_state, 0)->type = LAI_INTEGER;
-        lai_arg(&acpi_state, 0)->integer = (uint64_t)state & 0xFF;
+    lai_exec_sleep_method(lai_pts_handle, state);
+    lai_exec_sleep_method(lai_gts_handle, state);
 
-        lai_debug("execute _PTS(%d)\n", state);
-        lai_exec_method(handle, &acpi_state);
-        lai_finalize_state(&acpi_state);
-    }
-
-    handle = lai_resolve("_GTS");
+    if(state >= 1 && state <= 3)
+        lai_exec_sleep_method(lai_sst_handle, ACPI_SST_SLEEPING);
+    else if(state == 4)
+        lai_exec_sleep_method(lai_sst_handle, ACPI_SST_SLEEP_CONTEXT);
 
-    if(handle)
-    {
-        lai_init_state(&acpi_state);
-
-        // pass the sleeping type as an argument
-        lai_arg(&acpi_state, 0)->type = LAI_INTEGER;
-        lai_arg(&acpi_state, 0)->integer = (uint64_t)state & 0xFF;
-
-        lai_debug("execute _GTS(%d)\n", state);
-        lai_exec_method(handle, &acpi_state);
-        lai_finalize_state(&acpi_state);
-    }
-
-    lai_eval_package(&package, 0, &slp_typa);
-    lai_eval_package(&package, 1, &slp_typb);
+    // a stale wake status would end the sleep immediately
+    lai_clear_wake();
 
     // and go to sleep
     uint16_t data;
     data = laihost_inw(lai_fadt->pm1a_control_block);
     data &= 0xE3FF;
-    data |= (slp_typa.integer << 10) | ACPI_SLEEP;
+    data |= (sleep_state->slp_typa << 10) | ACPI_SLEEP;
     laihost_outw(lai_fadt->pm1a_control_block, data);
 
     if(lai_fadt->pm1b_control_block != 0)
     {
         data = laihost_inw(lai_fadt->pm1b_control_block);
         data &= 0xE3FF;
-        data |= (slp_typb.integer << 10) | ACPI_SLEEP;
+        data |= (sleep_state->slp_typb << 10) | ACPI_SLEEP;
         laihost_outw(lai_fadt->pm1b_control_block, data);
     }
 
-    /* poll the wake status */
-    while(!(lai_last_event & ACPI_WAKE));
+    /* wait for the wake event, then let the firmware restore its state */
+    lai_wait_for_wake();
 
+    lai_debug("woke up from sleep state S%d\n", state);
+    lai_exec_sleep_method(lai_sst_handle, ACPI_SST_WAKING);
+    lai_exec_sleep_method(lai_wak_handle, state);
+    lai_exec_sleep_method(lai_sst_handle, ACPI_SST_WORKING);
     return 0;
 }
-
-
@@ -0,0 +1,95 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Locking for Parallel Device Initialization */
+
+#include <lai/core.h>
+#include "libc.h"
+#include "sync.h"
+
+static int lai_sync_active = 0;
+static void *lai_interpreter_lock = NULL;
+
+// lai_sync_begin(): Enables locking. Called before worker threads are started.
+
+void lai_sync_begin(void)
+{
+    if(!laihost_create_lock || !laihost_lock || !laihost_unlock)
+        lai_panic("host does not provide the locking functions required for parallel init\n");
+
+    if(!lai_interpreter_lock)
+    {
+        lai_interpreter_lock = laihost_create_lock();
+        if(!lai_interpreter_lock)
+            lai_panic("unable to create interpreter lock\n");
+    }
+
+    lai_sync_active = 1;
+}
+
+// lai_sync_end(): Disables locking. Called after all worker threads were joined.
+
+void lai_sync_end(void)
+{
+    lai_sync_active = 0;
+}
+
+int lai_sync_is_active(void)
+{
+    return lai_sync_active;
+}
+
+void lai_lock_interpreter(void)
+{
+    if(lai_sync_active)
+        laihost_lock(lai_interpreter_lock);
+}
+
+void lai_unlock_interpreter(void)
+{
+    if(lai_sync_active)
+        laihost_unlock(lai_interpreter_lock);
+}
+
+// lai_enter_region(): Acquires the lock of an OpRegion
+// Param:    lai_nsnode_t *opregion - OpRegion that is about to be accessed
+// Return:   Nothing
+
+void lai_enter_region(lai_nsnode_t *opregion)
+{
+    if(!lai_sync_active)
+        return;
+
+    // The scratch arena is shared; only methods that never drop the lock may use it.
+    if(lai_scratch_is_active())
+        lai_panic("OpRegion %s accessed by a method that uses the scratch arena\n",
+                opregion->path);
+
+    // Region locks are created lazily. We still hold the interpreter lock here,
+    // so no other thread can race with us.
+    if(!opregion->op_lock)
+    {
+        opregion->op_lock = laihost_create_lock();
+        if(!opregion->op_lock)
+            lai_panic("unable to create lock for OpRegion %s\n", opregion->path);
+    }
+
+    // Never wait for a region lock while holding the interpreter lock.
+    laihost_unlock(lai_interpreter_lock);
+    laihost_lock(opregion->op_lock);
+}
+
+// lai_leave_region(): Releases the lock of an OpRegion
+// Param:    lai_nsnode_t *opregion - OpRegion that was accessed
+// Return:   Nothing
+
+void lai_leave_region(lai_nsnode_t *opregion)
+{
+    if(!lai_sync_active)
+        return;
+
+    laihost_unlock(opregion->op_lock);
+    laihost_lock(lai_interpreter_lock);
+}
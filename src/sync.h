@@ -0,0 +1,25 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+// Internal header file. Do not use outside of LAI.
+
+#pragma once
+
+#include <lai/core.h>
+
+// While parallel device initialization is running, the interpreter is protected by a
+// global lock. It is only dropped around blocking operations (Sleep() and hardware
+// accesses). Outside of parallel initialization, all of these functions are no-ops.
+void lai_sync_begin(void);
+void lai_sync_end(void);
+int lai_sync_is_active(void);
+
+void lai_lock_interpreter(void);
+void lai_unlock_interpreter(void);
+
+// Serializes accesses to a single OpRegion. The interpreter lock is released while
+// the region lock is held; the caller must not run AML in between.
+void lai_enter_region(lai_nsnode_t *);
+void lai_leave_region(lai_nsnode_t *);
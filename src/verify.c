@@ -0,0 +1,698 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* AML Bytecode Verifier */
+/* Each table is checked once, before its AML is added to the namespace: every
+ * opcode must be defined by the ACPI specification, every NameString and PkgLength
+ * must be well formed and every object must end within its parent. To know how many
+ * arguments an invocation takes, a pre-pass over each table records the ArgCount of
+ * every Method() and External() outside of method bodies, much like populating the
+ * namespace does; methods that are created by other methods are recorded when the
+ * main pass reaches them. Names are resolved against these declarations with the
+ * same search rules as in the namespace. The declarations of all tables are kept
+ * until lai_verify_finish(), so that SSDTs can invoke the methods of the DSDT. The
+ * operands of opcodes are parsed as the ACPI specification defines them; the
+ * nesting of method bodies is checked against the namespace by lai_analyze_method(). */
+
+#include <lai/core.h>
+#include "aml_opcodes.h"
+#include "libc.h"
+#include "eval.h"
+#include "verify.h"
+
+// Deeper nesting is rejected, so that the verifier itself needs a bounded stack.
+#define LAI_VERIFY_MAX_DEPTH    256
+
+// Longer paths do not fit into ACPI_MAX_NAME: a backslash and a dot and NameSeg each.
+#define LAI_VERIFY_MAX_SEGMENTS ((ACPI_MAX_NAME - 2) / 5)
+
+// Encoding of each opcode after the opcode byte(s), one character per field:
+//     p - PkgLength; the object ends where it says
+//     n - NameString of an existing object
+//     c - NameString of an object that is created
+//     C - like c; the rest of the object is in the scope of the new object
+//     S - NameString of an existing object; the rest of the object is in its scope
+//     b, w, d, q - ByteData, WordData, DWordData, QWordData
+//     z - null-terminated string
+//     m - MethodFlags; records the ArgCount of the method that is created
+//     x - ObjectType and ArgumentCount of an External()
+//     t - TermArg; names are method invocations and are followed by their arguments
+//     s - SuperName or Target; names are not invoked
+//     T - list of terms, up to the end of the object
+//     M - method body, like T, but skipped by the pre-pass
+//     E - list of package elements, up to the end of the object
+//     F - FieldList, up to the end of the object
+//     r - raw bytes, up to the end of the object
+
+static const char *lai_verify_opcodes[256] = {
+    [ZERO_OP] = "",
+    [ONE_OP] = "",
+    [ALIAS_OP] = "nc",
+    [NAME_OP] = "ct",
+    [BYTEPREFIX] = "b",
+    [WORDPREFIX] = "w",
+    [DWORDPREFIX] = "d",
+    [STRINGPREFIX] = "z",
+    [QWORDPREFIX] = "q",
+    [SCOPE_OP] = "pST",
+    [BUFFER_OP] = "ptr",
+    [PACKAGE_OP] = "pbE",
+    [VARPACKAGE_OP] = "ptE",
+    [METHOD_OP] = "pCmM",
+    [EXTERNAL_OP] = "nx",
+    [LOCAL0_OP] = "", [LOCAL1_OP] = "", [LOCAL2_OP] = "", [LOCAL3_OP] = "",
+    [LOCAL4_OP] = "", [LOCAL5_OP] = "", [LOCAL6_OP] = "", [LOCAL7_OP] = "",
+    [ARG0_OP] = "", [ARG1_OP] = "", [ARG2_OP] = "", [ARG3_OP] = "",
+    [ARG4_OP] = "", [ARG5_OP] = "", [ARG6_OP] = "",
+    [STORE_OP] = "ts",
+    [REFOF_OP] = "s",
+    [ADD_OP] = "tts",
+    [CONCAT_OP] = "tts",
+    [SUBTRACT_OP] = "tts",
+    [INCREMENT_OP] = "s",
+    [DECREMENT_OP] = "s",
+    [MULTIPLY_OP] = "tts",
+    [DIVIDE_OP] = "ttss",
+    [SHL_OP] = "tts",
+    [SHR_OP] = "tts",
+    [AND_OP] = "tts",
+    [NAND_OP] = "tts",
+    [OR_OP] = "tts",
+    [NOR_OP] = "tts",
+    [XOR_OP] = "tts",
+    [NOT_OP] = "ts",
+    [FINDSETLEFTBIT_OP] = "ts",
+    [FINDSETRIGHTBIT_OP] = "ts",
+    [DEREF_OP] = "t",
+    [CONCATRES_OP] = "tts",
+    [MOD_OP] = "tts",
+    [NOTIFY_OP] = "st",
+    [SIZEOF_OP] = "s",
+    [INDEX_OP] = "tts",
+    [MATCH_OP] = "tbtbtt",
+    [DWORDFIELD_OP] = "ttc",
+    [WORDFIELD_OP] = "ttc",
+    [BYTEFIELD_OP] = "ttc",
+    [BITFIELD_OP] = "ttc",
+    [OBJECTTYPE_OP] = "s",
+    [QWORDFIELD_OP] = "ttc",
+    [LAND_OP] = "tt",
+    [LOR_OP] = "tt",
+    [LNOT_OP] = "t",
+    [LEQUAL_OP] = "tt",
+    [LGREATER_OP] = "tt",
+    [LLESS_OP] = "tt",
+    [TOBUFFER_OP] = "ts",
+    [TODECIMALSTRING_OP] = "ts",
+    [TOHEXSTRING_OP] = "ts",
+    [TOINTEGER_OP] = "ts",
+    [TOSTRING_OP] = "tts",
+    [COPYOBJECT_OP] = "ts",
+    [MID_OP] = "ttts",
+    [CONTINUE_OP] = "",
+    [IF_OP] = "ptT",
+    [ELSE_OP] = "pT",
+    [WHILE_OP] = "ptT",
+    [NOP_OP] = "",
+    [RETURN_OP] = "t",
+    [BREAK_OP] = "",
+    [BREAKPOINT_OP] = "",
+    [ONES_OP] = "",
+};
+
+static const char *lai_verify_extended_opcodes[256] = {
+    [MUTEX] = "cb",
+    [EVENT] = "c",
+    [CONDREF_OP] = "ss",
+    [ARBFIELD_OP] = "tttc",
+    [LOADTABLE_OP] = "tttttt",
+    [LOAD_OP] = "ns",
+    [STALL_OP] = "t",
+    [SLEEP_OP] = "t",
+    [ACQUIRE_OP] = "sw",
+    [SIGNAL_OP] = "s",
+    [WAIT_OP] = "st",
+    [RESET_OP] = "s",
+    [RELEASE_OP] = "s",
+    [FROMBCD_OP] = "ts",
+    [TOBCD_OP] = "ts",
+    [UNLOAD_OP] = "s",
+    [REVISION_OP] = "",
+    [DEBUG_OP] = "",
+    [FATAL_OP] = "bdt",
+    [TIMER_OP] = "",
+    [OPREGION] = "cbtt",
+    [FIELD] = "pnbF",
+    [DEVICE] = "pCT",
+    [PROCESSOR] = "pCbdbT",
+    [POWERRES] = "pCbwT",
+    [THERMALZONE] = "pCT",
+    [INDEXFIELD] = "pnnbF",
+    [BANKFIELD] = "pnntbF",
+    [DATAREGION] = "cttt",
+};
+
+// An absolute path, as a list of NameSegs.
+typedef struct lai_verify_path_t
+{
+    size_t count;
+    uint8_t segments[LAI_VERIFY_MAX_SEGMENTS][4];
+} lai_verify_path_t;
+
+// Named objects that the tables create, in an open-addressing hash table.
+typedef struct lai_verify_declaration_t
+{
+    lai_verify_path_t path;
+    int used;
+    int argc;   // 0 for objects that are not methods
+} lai_verify_declaration_t;
+
+static lai_verify_declaration_t *lai_verify_declarations;
+static size_t lai_verify_capacity = 0;
+static size_t lai_verify_count = 0;
+
+typedef struct lai_verifier_t
+{
+    uint8_t *code;
+    size_t pc;
+    int depth;
+    int collect;                // 1 during the pre-pass
+    lai_verify_path_t scope;    // scope of the current object
+    lai_verify_path_t name;     // the last NameString that was parsed
+    const char *error;
+} lai_verifier_t;
+
+static int lai_verify_term(lai_verifier_t *, size_t, int);
+
+// lai_verify_hash(): Hashes a path (FNV-1a)
+// Param:    lai_verify_path_t *path - path
+// Return:   size_t - hash
+
+static size_t lai_verify_hash(lai_verify_path_t *path)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < path->count; i++)
+    {
+        for(int j = 0; j < 4; j++)
+            hash = (hash ^ path->segments[i][j]) * 16777619u;
+    }
+    return hash;
+}
+
+// lai_verify_lookup(): Finds the declaration of a path
+// Param:    lai_verify_path_t *path - path
+// Return:   lai_verify_declaration_t * - the declaration, or the free slot where it
+//                                        belongs; NULL if nothing was declared yet
+
+static lai_verify_declaration_t *lai_verify_lookup(lai_verify_path_t *path)
+{
+    if(!lai_verify_capacity)
+        return NULL;
+
+    size_t index = lai_verify_hash(path) & (lai_verify_capacity - 1);
+    while(1)
+    {
+        lai_verify_declaration_t *declaration = &lai_verify_declarations[index];
+        if(!declaration->used)
+            return declaration;
+        if(declaration->path.count == path->count
+                && !memcmp(declaration->path.segments, path->segments, 4 * path->count))
+            return declaration;
+        index = (index + 1) & (lai_verify_capacity - 1);
+    }
+}
+
+// lai_verify_declare(): Records a named object, unless the path is already declared
+// Param:    lai_verify_path_t *path - path of the object
+// Param:    int argc - ArgCount of methods, otherwise 0
+// Return:   Nothing
+
+static void lai_verify_declare(lai_verify_path_t *path, int argc)
+{
+    // Classical doubling strategy, at most 3/4 of the slots are used.
+    if(4 * (lai_verify_count + 1) > 3 * lai_verify_capacity)
+    {
+        lai_verify_declaration_t *old = lai_verify_declarations;
+        size_t old_capacity = lai_verify_capacity;
+        lai_verify_capacity = old_capacity ? 2 * old_capacity : 256;
+        lai_verify_declarations = lai_calloc(sizeof(lai_verify_declaration_t),
+                lai_verify_capacity, LAI_MEMORY_CODE);
+        if(!lai_verify_declarations)
+            lai_panic("could not allocate the declarations of the AML verifier\n");
+        for(size_t i = 0; i < old_capacity; i++)
+        {
+            if(old[i].used)
+                *lai_verify_lookup(&old[i].path) = old[i];
+        }
+        lai_free(old);
+    }
+
+    lai_verify_declaration_t *declaration = lai_verify_lookup(path);
+    if(declaration->used)
+        return;
+    declaration->path = *path;
+    declaration->used = 1;
+    declaration->argc = argc;
+    lai_verify_count++;
+}
+
+// lai_verify_argc(): Determines how many arguments an invocation takes
+// Param:    lai_verifier_t *verifier - verifier, name holds the invoked path
+// Param:    int search - 1 if the NameString was a single NameSeg without prefix
+// Return:   int - ArgCount; 0 for names that are not declared methods
+
+static int lai_verify_argc(lai_verifier_t *verifier, int search)
+{
+    lai_verify_declaration_t *declaration = lai_verify_lookup(&verifier->name);
+    if(declaration && declaration->used)
+        return declaration->argc;
+    if(!search)
+        return 0;
+
+    // Single NameSegs are searched towards the root, as lai_exec_resolve() does.
+    lai_verify_path_t path = verifier->name;
+    while(path.count > 1)
+    {
+        path.count--;
+        memcpy(path.segments[path.count - 1], verifier->name.segments[verifier->name.count - 1], 4);
+        declaration = lai_verify_lookup(&path);
+        if(declaration && declaration->used)
+            return declaration->argc;
+    }
+    return 0;
+}
+
+// lai_verify_finish(): Frees the declarations once all tables are loaded
+// Return:   Nothing
+
+void lai_verify_finish(void)
+{
+    lai_free(lai_verify_declarations);
+    lai_verify_declarations = NULL;
+    lai_verify_capacity = 0;
+    lai_verify_count = 0;
+}
+
+// lai_verify_fail(): Records why verification failed
+// Param:    lai_verifier_t *verifier - verifier
+// Param:    const char *error - description of the problem
+// Return:   int - always 1
+
+static int lai_verify_fail(lai_verifier_t *verifier, const char *error)
+{
+    verifier->error = error;
+    return 1;
+}
+
+// lai_verify_pkglength(): Checks the encoding of a PkgLength
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced past the PkgLength
+// Param:    size_t limit - end of the parent
+// Param:    size_t *length - receives the value
+// Return:   int - 0 on success
+
+static int lai_verify_pkglength(lai_verifier_t *verifier, size_t limit, size_t *length)
+{
+    if(verifier->pc >= limit)
+        return lai_verify_fail(verifier, "truncated PkgLength");
+
+    // Bits 4 and 5 of the lead byte are reserved if more bytes follow.
+    uint8_t lead = verifier->code[verifier->pc];
+    size_t count = lead >> 6;
+    if(count && (lead & 0x30))
+        return lai_verify_fail(verifier, "malformed PkgLength");
+    if(verifier->pc + 1 + count > limit)
+        return lai_verify_fail(verifier, "truncated PkgLength");
+
+    verifier->pc += lai_parse_pkgsize(verifier->code + verifier->pc, length);
+    return 0;
+}
+
+// lai_verify_nameseg(): Checks that a NameSeg consists of valid characters
+// Param:    uint8_t *nameseg - four bytes of AML
+// Return:   int - 0 on success
+
+static int lai_verify_nameseg(uint8_t *nameseg)
+{
+    for(int i = 0; i < 4; i++)
+    {
+        uint8_t c = nameseg[i];
+        if((c >= 'A' && c <= 'Z') || c == '_')
+            continue;
+        if(i && c >= '0' && c <= '9')
+            continue;
+        return 1;
+    }
+    return 0;
+}
+
+// lai_verify_name(): Checks the encoding of a NameString and resolves it
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced past the NameString and
+//                                      name receives the path
+// Param:    size_t limit - end of the parent
+// Param:    int *search - set to 1 if the NameString is a single NameSeg without prefix;
+//                         may be NULL
+// Return:   int - 0 on success
+
+static int lai_verify_name(lai_verifier_t *verifier, size_t limit, int *search)
+{
+    uint8_t *code = verifier->code;
+    lai_verify_path_t *name = &verifier->name;
+    int prefixed = 0;
+    if(verifier->pc < limit && code[verifier->pc] == ROOT_CHAR)
+    {
+        verifier->pc++;
+        name->count = 0;
+        prefixed = 1;
+    }else
+    {
+        *name = verifier->scope;
+        while(verifier->pc < limit && code[verifier->pc] == PARENT_CHAR)
+        {
+            // As in lai_resolve_path(), the root can not be left.
+            verifier->pc++;
+            if(name->count)
+                name->count--;
+            prefixed = 1;
+        }
+    }
+    if(verifier->pc >= limit)
+        return lai_verify_fail(verifier, "truncated NameString");
+
+    size_t segments = 1;
+    if(code[verifier->pc] == 0)
+    {
+        // NullName.
+        verifier->pc++;
+        if(search)
+            *search = 0;
+        return 0;
+    }else if(code[verifier->pc] == DUAL_PREFIX)
+    {
+        verifier->pc++;
+        segments = 2;
+    }else if(code[verifier->pc] == MULTI_PREFIX)
+    {
+        verifier->pc++;
+        if(verifier->pc >= limit)
+            return lai_verify_fail(verifier, "truncated NameString");
+        segments = code[verifier->pc++];
+        if(!segments)
+            return lai_verify_fail(verifier, "empty MultiNamePath");
+    }
+
+    if(verifier->pc + 4 * segments > limit)
+        return lai_verify_fail(verifier, "truncated NameString");
+    if(name->count + segments > LAI_VERIFY_MAX_SEGMENTS)
+        return lai_verify_fail(verifier, "path is too long");
+    for(size_t i = 0; i < segments; i++)
+    {
+        if(lai_verify_nameseg(code + verifier->pc))
+            return lai_verify_fail(verifier, "invalid NameSeg");
+        memcpy(name->segments[name->count++], code + verifier->pc, 4);
+        verifier->pc += 4;
+    }
+    if(search)
+        *search = !prefixed && segments == 1;
+    return 0;
+}
+
+// lai_verify_invocation(): Checks a name in a TermArg, including the arguments of
+//                          invocations
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced past the arguments
+// Param:    size_t limit - end of the parent
+// Return:   int - 0 on success
+
+static int lai_verify_invocation(lai_verifier_t *verifier, size_t limit)
+{
+    int search;
+    if(lai_verify_name(verifier, limit, &search))
+        return 1;
+
+    int argc = lai_verify_argc(verifier, search);
+    if(verifier->depth == LAI_VERIFY_MAX_DEPTH)
+        return lai_verify_fail(verifier, "objects are nested too deeply");
+    verifier->depth++;
+    for(int i = 0; i < argc; i++)
+    {
+        if(lai_verify_term(verifier, limit, 1))
+            return 1;
+    }
+    verifier->depth--;
+    return 0;
+}
+
+// lai_verify_fields(): Checks a FieldList
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced to end
+// Param:    size_t end - end of the Field(), IndexField() or BankField()
+// Return:   int - 0 on success
+
+static int lai_verify_fields(lai_verifier_t *verifier, size_t end)
+{
+    uint8_t *code = verifier->code;
+    while(verifier->pc < end)
+    {
+        size_t bits;
+        switch(code[verifier->pc])
+        {
+        case 0x00:  // ReservedField
+            verifier->pc++;
+            if(lai_verify_pkglength(verifier, end, &bits))
+                return 1;
+            break;
+        case 0x01:  // AccessField
+            if(verifier->pc + 3 > end)
+                return lai_verify_fail(verifier, "truncated AccessField");
+            verifier->pc += 3;
+            break;
+        case 0x02:  // ConnectField
+            verifier->pc++;
+            if(verifier->pc < end && code[verifier->pc] == BUFFER_OP)
+            {
+                if(lai_verify_term(verifier, end, 1))
+                    return 1;
+            }else if(lai_verify_name(verifier, end, NULL))
+                return 1;
+            break;
+        case 0x03:  // ExtendedAccessField
+            if(verifier->pc + 4 > end)
+                return lai_verify_fail(verifier, "truncated ExtendedAccessField");
+            verifier->pc += 4;
+            break;
+        default:    // NamedField
+        {
+            if(verifier->pc + 4 > end || lai_verify_nameseg(code + verifier->pc))
+                return lai_verify_fail(verifier, "invalid NamedField");
+            lai_verify_path_t *name = &verifier->name;
+            *name = verifier->scope;
+            if(name->count == LAI_VERIFY_MAX_SEGMENTS)
+                return lai_verify_fail(verifier, "path is too long");
+            memcpy(name->segments[name->count++], code + verifier->pc, 4);
+            lai_verify_declare(name, 0);
+            verifier->pc += 4;
+            if(lai_verify_pkglength(verifier, end, &bits))
+                return 1;
+        }
+        }
+    }
+    return 0;
+}
+
+// lai_verify_object(): Checks the fields of an opcode, see lai_verify_opcodes[]
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced past the object
+// Param:    size_t opcode_pc - position of the opcode
+// Param:    const char *format - encoding of the fields
+// Param:    size_t limit - end of the parent
+// Return:   int - 0 on success
+
+static int lai_verify_object(lai_verifier_t *verifier, size_t opcode_pc, const char *format,
+        size_t limit)
+{
+    uint8_t *code = verifier->code;
+    size_t end = limit;
+    lai_verify_path_t scope = verifier->scope;
+    for(; *format; format++)
+    {
+        switch(*format)
+        {
+        case 'p':
+        {
+            // The PkgLength counts itself, but not the opcode.
+            size_t length;
+            size_t length_pc = verifier->pc;
+            if(lai_verify_pkglength(verifier, limit, &length))
+                return 1;
+            end = length_pc + length;
+            if(end < verifier->pc || end > limit)
+                return lai_verify_fail(verifier, "object exceeds its parent");
+            break;
+        }
+        case 'n':
+            if(lai_verify_name(verifier, end, NULL))
+                return 1;
+            break;
+        case 'c':
+            if(lai_verify_name(verifier, end, NULL))
+                return 1;
+            lai_verify_declare(&verifier->name, 0);
+            break;
+        case 'C':
+        case 'S':
+            if(lai_verify_name(verifier, end, NULL))
+                return 1;
+            // Methods are declared with their ArgCount by 'm'.
+            if(*format == 'C' && format[1] != 'm')
+                lai_verify_declare(&verifier->name, 0);
+            verifier->scope = verifier->name;
+            break;
+        case 'b':
+        case 'w':
+        case 'd':
+        case 'q':
+        {
+            size_t size = *format == 'b' ? 1 : *format == 'w' ? 2 : *format == 'd' ? 4 : 8;
+            if(verifier->pc + size > end)
+                return lai_verify_fail(verifier, "truncated data");
+            verifier->pc += size;
+            break;
+        }
+        case 'z':
+            while(verifier->pc < end && code[verifier->pc])
+                verifier->pc++;
+            if(verifier->pc == end)
+                return lai_verify_fail(verifier, "unterminated string");
+            verifier->pc++;
+            break;
+        case 'm':
+            if(verifier->pc >= end)
+                return lai_verify_fail(verifier, "truncated data");
+            lai_verify_declare(&verifier->scope, code[verifier->pc++] & METHOD_ARGC_MASK);
+            break;
+        case 'x':
+            // Only external methods affect how invocations are parsed.
+            if(verifier->pc + 2 > end)
+                return lai_verify_fail(verifier, "truncated data");
+            if(code[verifier->pc] == 8)
+                lai_verify_declare(&verifier->name, code[verifier->pc + 1] & METHOD_ARGC_MASK);
+            verifier->pc += 2;
+            break;
+        case 't':
+        case 's':
+            if(lai_verify_term(verifier, end, *format == 't'))
+                return 1;
+            break;
+        case 'M':
+            if(verifier->collect)
+            {
+                verifier->pc = end;
+                break;
+            }
+            // Fall through.
+        case 'T':
+        case 'E':
+            while(verifier->pc < end)
+            {
+                if(lai_verify_term(verifier, end, *format != 'E'))
+                    return 1;
+            }
+            break;
+        case 'F':
+            if(lai_verify_fields(verifier, end))
+                return 1;
+            break;
+        case 'r':
+            verifier->pc = end;
+            break;
+        default:
+            lai_panic("invalid AML encoding '%c' for opcode at 0x%x\n", *format, (int)opcode_pc);
+        }
+    }
+    verifier->scope = scope;
+    return 0;
+}
+
+// lai_verify_term(): Checks a single term, including its operands
+// Param:    lai_verifier_t *verifier - verifier, pc is advanced past the term
+// Param:    size_t limit - end of the parent
+// Param:    int invoke - 1 if names are method invocations
+// Return:   int - 0 on success
+
+static int lai_verify_term(lai_verifier_t *verifier, size_t limit, int invoke)
+{
+    uint8_t *code = verifier->code;
+    size_t opcode_pc = verifier->pc;
+    if(opcode_pc >= limit)
+        return lai_verify_fail(verifier, "object exceeds its parent");
+
+    uint8_t lead = code[opcode_pc];
+    if((lead >= 'A' && lead <= 'Z') || lead == '_' || lead == ROOT_CHAR
+            || lead == PARENT_CHAR || lead == DUAL_PREFIX || lead == MULTI_PREFIX)
+    {
+        if(invoke)
+            return lai_verify_invocation(verifier, limit);
+        return lai_verify_name(verifier, limit, NULL);
+    }
+
+    const char *format;
+    if(lead == EXTOP_PREFIX)
+    {
+        if(opcode_pc + 1 >= limit)
+            return lai_verify_fail(verifier, "truncated opcode");
+        format = lai_verify_extended_opcodes[code[opcode_pc + 1]];
+        verifier->pc += 2;
+    }else
+    {
+        format = lai_verify_opcodes[lead];
+        verifier->pc += 1;
+    }
+    if(!format)
+    {
+        verifier->pc = opcode_pc;
+        return lai_verify_fail(verifier, "invalid opcode");
+    }
+
+    if(verifier->depth == LAI_VERIFY_MAX_DEPTH)
+        return lai_verify_fail(verifier, "objects are nested too deeply");
+    verifier->depth++;
+    int status = lai_verify_object(verifier, opcode_pc, format, limit);
+    verifier->depth--;
+    return status;
+}
+
+// lai_verify_aml(): Checks that a table consists of well-formed AML
+// Param:    uint8_t *code - AML code, without the table header
+// Param:    size_t size - size of the code
+// Return:   int - 0 if the code is well-formed, otherwise the problem is logged
+
+int lai_verify_aml(uint8_t *code, size_t size)
+{
+    // \_OSI is the only method that the namespace provides and that takes arguments.
+    if(!lai_verify_count)
+    {
+        lai_verify_path_t osi = {.count = 1, .segments = {{'_', 'O', 'S', 'I'}}};
+        lai_verify_declare(&osi, 1);
+    }
+
+    // The pre-pass only collects declarations; its errors are found again below.
+    lai_verifier_t verifier = {0};
+    verifier.code = code;
+    verifier.collect = 1;
+    while(verifier.pc < size)
+    {
+        if(lai_verify_term(&verifier, size, 1))
+            break;
+    }
+
+    memset(&verifier, 0, sizeof(lai_verifier_t));
+    verifier.code = code;
+    while(verifier.pc < size)
+    {
+        if(lai_verify_term(&verifier, size, 1))
+        {
+            lai_warn("malformed AML at offset 0x%x: %s\n", (int)verifier.pc, verifier.error);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+// Internal header file. Do not use outside of LAI.
+
+#pragma once
+
+#include <lai/core.h>
+
+int lai_verify_aml(uint8_t *, size_t);
+void lai_verify_finish(void);
@@ -0,0 +1,89 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Read-only Views of Namespace Objects */
+/* lai_eval() always hands out a deep copy of a Name(). Most consumers only read
+ * a few integers out of it, so these functions return pointers to the object that
+ * is owned by the namespace instead. A view stays valid as long as no AML stores
+ * to the Name; while parallel initialization is running, that is only guaranteed
+ * between lai_ns_read_lock() and lai_ns_read_unlock(). */
+
+#include <lai/core.h>
+#include "libc.h"
+#include "sync.h"
+#include "package.h"
+
+// lai_view_node(): Returns a read-only view of the object of a Name()
+// Param:    lai_nsnode_t *handle - Name() or Alias() to a Name()
+// Return:    const lai_object_t * - object, NULL if the node is not a Name()
+
+const lai_object_t *lai_view_node(lai_nsnode_t *handle)
+{
+    while(handle && handle->type == LAI_NAMESPACE_ALIAS)
+        handle = lai_resolve(handle->alias);
+
+    if(!handle || handle->type != LAI_NAMESPACE_NAME)
+        return NULL;
+    return &handle->object;
+}
+
+// lai_view_element(): Returns a read-only view of a package element
+// Param:    const lai_object_t *package - package
+// Param:    size_t index - index of the element
+// Return:    const lai_object_t * - element, NULL if the index is out of range
+
+const lai_object_t *lai_view_element(const lai_object_t *package, size_t index)
+{
+    if(!package || package->type != LAI_PACKAGE || index >= (size_t)package->package_size)
+        return NULL;
+    // Elements of constant packages are decoded on first access.
+    return lai_package_element((lai_object_t *)package, index);
+}
+
+// lai_view_integer(): Reads an integer
+// Param:    const lai_object_t *object - object, may be NULL
+// Param:    uint64_t *integer - destination
+// Return:    int - 0 on success, 1 if the object is not an integer
+
+int lai_view_integer(const lai_object_t *object, uint64_t *integer)
+{
+    if(!object || object->type != LAI_INTEGER)
+        return 1;
+    *integer = object->integer;
+    return 0;
+}
+
+// lai_view_buffer(): Returns a range of bytes of a buffer
+// Param:    const lai_object_t *object - buffer, may be NULL
+// Param:    size_t offset - offset of the first byte
+// Param:    size_t length - number of bytes
+// Return:    const void * - first byte, NULL if the range is not within the buffer
+
+const void *lai_view_buffer(const lai_object_t *object, size_t offset, size_t length)
+{
+    if(!object || object->type != LAI_BUFFER)
+        return NULL;
+    if(offset > object->buffer_size || length > object->buffer_size - offset)
+        return NULL;
+    return (const uint8_t *)object->buffer + offset;
+}
+
+// lai_ns_read_lock(): Keeps AML from modifying the namespace, so that views stay valid
+// Return:    Nothing
+
+void lai_ns_read_lock(void)
+{
+    // AML only runs concurrently during parallel initialization; this is a no-op
+    // otherwise. There is no separate reader lock, the interpreter lock is used.
+    lai_lock_interpreter();
+}
+
+// lai_ns_read_unlock(): Releases the lock taken by lai_ns_read_lock()
+// Return:    Nothing
+
+void lai_ns_read_unlock(void)
+{
+    lai_unlock_interpreter();
+}
@@ -0,0 +1,328 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* AML Builder */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lai/core.h>
+#include "aml.h"
+
+static void aml_die(const char *message)
+{
+    fprintf(stderr, "aml: %s\n", message);
+    abort();
+}
+
+// aml_init(): Starts a new table
+// Param:    aml_builder_t *builder - builder
+// Param:    const char *signature - "DSDT" or "SSDT"
+// Return:    Nothing
+
+void aml_init(aml_builder_t *builder, const char *signature)
+{
+    memset(builder, 0, sizeof(aml_builder_t));
+
+    acpi_header_t header;
+    memset(&header, 0, sizeof(acpi_header_t));
+    memcpy(header.signature, signature, 4);
+    header.revision = 2;        // 64-bit integers
+    memcpy(header.oem, "LAI   ", 6);
+    memcpy(header.oem_table, "SYNTHETC", 8);
+
+    for(size_t i = 0; i < sizeof(acpi_header_t); i++)
+        aml_byte(builder, ((uint8_t *)&header)[i]);
+}
+
+// aml_finish(): Completes the table
+// Param:    aml_builder_t *builder - builder, all objects must be closed
+// Param:    size_t *length - receives the size of the table
+// Return:    void * - table, to be released with free()
+
+void *aml_finish(aml_builder_t *builder, size_t *length)
+{
+    if(builder->depth)
+        aml_die("table has unterminated objects");
+
+    acpi_header_t *header = (acpi_header_t *)builder->data;
+    header->length = builder->size;
+
+    uint8_t sum = 0;
+    for(size_t i = 0; i < builder->size; i++)
+        sum += builder->data[i];
+    header->checksum = -sum;
+
+    *length = builder->size;
+    void *data = builder->data;
+    builder->data = NULL;
+    builder->size = 0;
+    builder->capacity = 0;
+    return data;
+}
+
+void aml_byte(aml_builder_t *builder, uint8_t byte)
+{
+    if(builder->size == builder->capacity)
+    {
+        size_t capacity = builder->capacity ? builder->capacity * 2 : 4096;
+        uint8_t *data = realloc(builder->data, capacity);
+        if(!data)
+            aml_die("out of memory");
+        builder->data = data;
+        builder->capacity = capacity;
+    }
+
+    builder->data[builder->size++] = byte;
+}
+
+// aml_opcode(): Emits an opcode; extended opcodes are (EXTOP_PREFIX << 8) | opcode
+void aml_opcode(aml_builder_t *builder, int opcode)
+{
+    if(opcode > 0xFF)
+        aml_byte(builder, opcode >> 8);
+    aml_byte(builder, opcode & 0xFF);
+}
+
+// aml_begin(): Reserves a PkgLength that covers everything up to aml_end()
+void aml_begin(aml_builder_t *builder)
+{
+    if(builder->depth == AML_MAX_DEPTH)
+        aml_die("objects are nested too deeply");
+
+    builder->open[builder->depth++] = builder->size;
+    for(int i = 0; i < 4; i++)
+        aml_byte(builder, 0);
+}
+
+void aml_end(aml_builder_t *builder)
+{
+    if(!builder->depth)
+        aml_die("aml_end() without an open object");
+
+    size_t offset = builder->open[--builder->depth];
+    size_t length = builder->size - offset;
+    if(length >= (1 << 28))
+        aml_die("object is too large for a PkgLength");
+
+    builder->data[offset] = 0xC0 | (length & 0x0F);
+    builder->data[offset + 1] = (length >> 4) & 0xFF;
+    builder->data[offset + 2] = (length >> 12) & 0xFF;
+    builder->data[offset + 3] = (length >> 20) & 0xFF;
+}
+
+// aml_pkglength(): Emits a PkgLength with a known value, e.g. the size of a field unit
+void aml_pkglength(aml_builder_t *builder, size_t value)
+{
+    if(value < 0x40)
+    {
+        aml_byte(builder, value);
+    } else if(value < 0x1000)
+    {
+        aml_byte(builder, 0x40 | (value & 0x0F));
+        aml_byte(builder, value >> 4);
+    } else if(value < 0x100000)
+    {
+        aml_byte(builder, 0x80 | (value & 0x0F));
+        aml_byte(builder, (value >> 4) & 0xFF);
+        aml_byte(builder, value >> 12);
+    } else
+    {
+        aml_byte(builder, 0xC0 | (value & 0x0F));
+        aml_byte(builder, (value >> 4) & 0xFF);
+        aml_byte(builder, (value >> 12) & 0xFF);
+        aml_byte(builder, value >> 20);
+    }
+}
+
+static void aml_nameseg(aml_builder_t *builder, const char *segment, size_t length)
+{
+    if(!length || length > 4)
+        aml_die("invalid NameSeg");
+
+    for(size_t i = 0; i < 4; i++)
+        aml_byte(builder, (i < length) ? segment[i] : '_');
+}
+
+// aml_name(): Emits a NameString
+// Param:    aml_builder_t *builder - builder
+// Param:    const char *path - ASL path, segments may be shorter than four characters
+// Return:    Nothing
+
+void aml_name(aml_builder_t *builder, const char *path)
+{
+    if(*path == '\\')
+        aml_byte(builder, *path++);
+    while(*path == '^')
+        aml_byte(builder, *path++);
+
+    if(!*path)
+    {
+        aml_byte(builder, ZERO_OP);     // NullName
+        return;
+    }
+
+    size_t count = 1;
+    for(const char *p = path; *p; p++)
+    {
+        if(*p == '.')
+            count++;
+    }
+
+    if(count == 2)
+        aml_byte(builder, DUAL_PREFIX);
+    else if(count > 2)
+    {
+        if(count > 255)
+            aml_die("path has too many segments");
+        aml_byte(builder, MULTI_PREFIX);
+        aml_byte(builder, count);
+    }
+
+    while(*path)
+    {
+        size_t length = strcspn(path, ".");
+        aml_nameseg(builder, path, length);
+        path += length;
+        if(*path == '.')
+            path++;
+    }
+}
+
+void aml_integer(aml_builder_t *builder, uint64_t value)
+{
+    int bytes;
+    if(value == 0)
+    {
+        aml_byte(builder, ZERO_OP);
+        return;
+    } else if(value == 1)
+    {
+        aml_byte(builder, ONE_OP);
+        return;
+    } else if(value <= 0xFF)
+    {
+        aml_byte(builder, BYTEPREFIX);
+        bytes = 1;
+    } else if(value <= 0xFFFF)
+    {
+        aml_byte(builder, WORDPREFIX);
+        bytes = 2;
+    } else if(value <= 0xFFFFFFFF)
+    {
+        aml_byte(builder, DWORDPREFIX);
+        bytes = 4;
+    } else
+    {
+        aml_byte(builder, QWORDPREFIX);
+        bytes = 8;
+    }
+
+    for(int i = 0; i < bytes; i++)
+        aml_byte(builder, value >> (i * 8));
+}
+
+void aml_string(aml_builder_t *builder, const char *string)
+{
+    aml_byte(builder, STRINGPREFIX);
+    do
+        aml_byte(builder, *string);
+    while(*string++);
+}
+
+void aml_name_integer(aml_builder_t *builder, const char *name, uint64_t value)
+{
+    aml_byte(builder, NAME_OP);
+    aml_name(builder, name);
+    aml_integer(builder, value);
+}
+
+void aml_name_string(aml_builder_t *builder, const char *name, const char *value)
+{
+    aml_byte(builder, NAME_OP);
+    aml_name(builder, name);
+    aml_string(builder, value);
+}
+
+void aml_opregion(aml_builder_t *builder, const char *name, int space, uint64_t base, uint64_t length)
+{
+    aml_opcode(builder, (EXTOP_PREFIX << 8) | OPREGION);
+    aml_name(builder, name);
+    aml_byte(builder, space);
+    aml_integer(builder, base);
+    aml_integer(builder, length);
+}
+
+// aml_field_unit(): Emits an element of a Field(); a NULL name reserves bits
+void aml_field_unit(aml_builder_t *builder, const char *name, size_t bits)
+{
+    if(name)
+        aml_nameseg(builder, name, strlen(name));
+    else
+        aml_byte(builder, 0x00);
+    aml_pkglength(builder, bits);
+}
+
+void aml_begin_scope(aml_builder_t *builder, const char *name)
+{
+    aml_opcode(builder, SCOPE_OP);
+    aml_begin(builder);
+    aml_name(builder, name);
+}
+
+void aml_begin_device(aml_builder_t *builder, const char *name)
+{
+    aml_opcode(builder, (EXTOP_PREFIX << 8) | DEVICE);
+    aml_begin(builder);
+    aml_name(builder, name);
+}
+
+void aml_begin_method(aml_builder_t *builder, const char *name, int flags)
+{
+    aml_opcode(builder, METHOD_OP);
+    aml_begin(builder);
+    aml_name(builder, name);
+    aml_byte(builder, flags);
+}
+
+void aml_begin_package(aml_builder_t *builder, int count)
+{
+    if(count > 255)
+        aml_die("package has too many elements");
+
+    aml_opcode(builder, PACKAGE_OP);
+    aml_begin(builder);
+    aml_byte(builder, count);
+}
+
+// aml_begin_buffer(): Opens a Buffer(); the caller emits the initializer bytes
+void aml_begin_buffer(aml_builder_t *builder, size_t length)
+{
+    aml_opcode(builder, BUFFER_OP);
+    aml_begin(builder);
+    aml_integer(builder, length);
+}
+
+void aml_begin_field(aml_builder_t *builder, const char *region, int flags)
+{
+    aml_opcode(builder, (EXTOP_PREFIX << 8) | FIELD);
+    aml_begin(builder);
+    aml_name(builder, region);
+    aml_byte(builder, flags);
+}
+
+// aml_begin_if(): Opens an If(); the predicate follows
+void aml_begin_if(aml_builder_t *builder)
+{
+    aml_opcode(builder, IF_OP);
+    aml_begin(builder);
+}
+
+// aml_begin_while(): Opens a While(); the predicate follows
+void aml_begin_while(aml_builder_t *builder)
+{
+    aml_opcode(builder, WHILE_OP);
+    aml_begin(builder);
+}
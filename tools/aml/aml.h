@@ -0,0 +1,59 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* AML Builder */
+/* Emits AML tables for benchmarks and tests. Objects that have a PkgLength are
+ * opened with aml_begin_*() and closed with aml_end(); the length is patched in
+ * afterwards, so it is always encoded in four bytes. Names are written in ASL
+ * syntax, e.g. "\\_SB.PCI0", "^LNKA" or "_STA". */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "aml_opcodes.h"
+
+#define AML_MAX_DEPTH           64
+
+typedef struct aml_builder_t
+{
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+
+    // Offsets of the PkgLengths of all objects that are still open.
+    size_t open[AML_MAX_DEPTH];
+    int depth;
+} aml_builder_t;
+
+// Tables.
+void aml_init(aml_builder_t *, const char *signature);
+void *aml_finish(aml_builder_t *, size_t *length);
+
+// Raw encoding.
+void aml_byte(aml_builder_t *, uint8_t);
+void aml_opcode(aml_builder_t *, int opcode);
+void aml_begin(aml_builder_t *);
+void aml_end(aml_builder_t *);
+void aml_pkglength(aml_builder_t *, size_t);
+void aml_name(aml_builder_t *, const char *path);
+void aml_integer(aml_builder_t *, uint64_t);
+void aml_string(aml_builder_t *, const char *);
+
+// Named objects.
+void aml_name_integer(aml_builder_t *, const char *name, uint64_t value);
+void aml_name_string(aml_builder_t *, const char *name, const char *value);
+void aml_opregion(aml_builder_t *, const char *name, int space, uint64_t base, uint64_t length);
+void aml_field_unit(aml_builder_t *, const char *name, size_t bits);
+
+// Objects with a PkgLength; each of them is closed by aml_end().
+void aml_begin_scope(aml_builder_t *, const char *name);
+void aml_begin_device(aml_builder_t *, const char *name);
+void aml_begin_method(aml_builder_t *, const char *name, int flags);
+void aml_begin_package(aml_builder_t *, int count);
+void aml_begin_buffer(aml_builder_t *, size_t length);
+void aml_begin_field(aml_builder_t *, const char *region, int flags);
+void aml_begin_if(aml_builder_t *);
+void aml_begin_while(aml_builder_t *);
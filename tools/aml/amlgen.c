@@ -0,0 +1,85 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-amlgen: Writes synthetic AML tables */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "generate.h"
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-amlgen [options] -o FILE\n"
+            "  -n DEVICES   number of devices (default 100)\n"
+            "  -d DEPTH     nesting depth of the devices (default 1)\n"
+            "  -m FIELDS    fields per OpRegion, one OpRegion per device (default 0)\n"
+            "  -k ENTRIES   entries of the _PRT of \\_SB.PCI0 (default 0, no PCI0)\n"
+            "  -l LENGTH    iterations of the loop in each _INI (default 0)\n"
+            "  -s SIG       table signature (default DSDT)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    aml_shape_t shape = {.devices = 100, .depth = 1};
+    const char *signature = "DSDT";
+    const char *output = NULL;
+
+    int option;
+    while((option = getopt(argc, argv, "n:d:m:k:l:s:o:")) != -1)
+    {
+        switch(option)
+        {
+        case 'n':
+            shape.devices = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            shape.depth = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            shape.fields = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            shape.prt_entries = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            shape.loop_length = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            if(strlen(optarg) != 4)
+                usage();
+            signature = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if(!output || optind != argc)
+        usage();
+
+    aml_builder_t builder;
+    aml_init(&builder, signature);
+    if(aml_generate(&builder, &shape))
+        return 1;
+
+    size_t length;
+    void *table = aml_finish(&builder, &length);
+    FILE *file = fopen(output, "wb");
+    if(!file || fwrite(table, 1, length, file) != length)
+    {
+        fprintf(stderr, "lai-amlgen: unable to write %s\n", output);
+        return 1;
+    }
+    fclose(file);
+    free(table);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Synthetic AML Tables */
+/* Devices are created in chains: device i is at nesting level i % depth of chain
+ * i / depth. Its name is a letter for the level followed by the chain number in
+ * base 36, e.g. \_SB.A000.B000.C000 for the first three devices at depth 3. */
+
+#include <stdio.h>
+#include <string.h>
+#include "generate.h"
+
+#define AML_MAX_CHAINS          (36 * 36 * 36)
+#define AML_MAX_GENERATED_DEPTH 11      // paths must fit into ACPI_MAX_NAME
+#define AML_FIELD_BASE          0x1000
+
+static void aml_base36(char *name, char prefix, size_t value)
+{
+    static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    name[0] = prefix;
+    name[1] = digits[(value / 1296) % 36];
+    name[2] = digits[(value / 36) % 36];
+    name[3] = digits[value % 36];
+    name[4] = 0;
+}
+
+// aml_device_path(): Returns the path of a generated device, as used by lai_resolve()
+// Param:    char *path - destination, at least ACPI_MAX_NAME bytes
+// Param:    size_t index - device number
+// Param:    const aml_shape_t *shape - shape that was passed to aml_generate()
+// Return:    Nothing
+
+void aml_device_path(char *path, size_t index, const aml_shape_t *shape)
+{
+    size_t chain = index / shape->depth;
+    size_t level = index % shape->depth;
+
+    strcpy(path, "\\._SB_");
+    for(size_t i = 0; i <= level; i++)
+    {
+        char name[5];
+        aml_base36(name, 'A' + i, chain);
+        strcat(path, ".");
+        strcat(path, name);
+    }
+}
+
+static void aml_generate_device(aml_builder_t *builder, size_t index, const aml_shape_t *shape)
+{
+    aml_name_integer(builder, "_ADR", index);
+
+    aml_begin_method(builder, "_STA", 0);
+    aml_opcode(builder, RETURN_OP);
+    aml_integer(builder, 0x0F);
+    aml_end(builder);
+
+    // Store(Zero, Local0)
+    // While(LLess(Local0, loop_length)) { Increment(Local0) }
+    aml_begin_method(builder, "_INI", 0);
+    aml_opcode(builder, STORE_OP);
+    aml_opcode(builder, ZERO_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_begin_while(builder);
+    aml_opcode(builder, LLESS_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_integer(builder, shape->loop_length);
+    aml_opcode(builder, INCREMENT_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_end(builder);
+    aml_end(builder);
+
+    if(shape->fields)
+    {
+        aml_opregion(builder, "REGN", OPREGION_IO, AML_FIELD_BASE, shape->fields);
+        aml_begin_field(builder, "REGN", FIELD_BYTE_ACCESS);
+        for(size_t i = 0; i < shape->fields; i++)
+        {
+            char name[5];
+            aml_base36(name, 'F', i);
+            aml_field_unit(builder, name, 8);
+        }
+        aml_end(builder);
+    }
+}
+
+static void aml_generate_prt(aml_builder_t *builder, const aml_shape_t *shape)
+{
+    aml_begin_device(builder, "PCI0");
+    aml_name_integer(builder, "_HID", 0x030AD041);     // EisaId("PNP0A03")
+
+    aml_byte(builder, NAME_OP);
+    aml_name(builder, "_PRT");
+    aml_begin_package(builder, shape->prt_entries);
+    for(size_t i = 0; i < shape->prt_entries; i++)
+    {
+        // Slots are reused with all four pins once there are more than 32 entries.
+        aml_begin_package(builder, 4);
+        aml_integer(builder, ((i % 32) << 16) | 0xFFFF);
+        aml_integer(builder, (i / 32) % 4);
+        aml_integer(builder, 0);
+        aml_integer(builder, 16 + (i % 8));
+        aml_end(builder);
+    }
+    aml_end(builder);
+    aml_end(builder);
+}
+
+// aml_generate(): Emits the objects of a synthetic namespace
+// Param:    aml_builder_t *builder - table started with aml_init()
+// Param:    const aml_shape_t *shape - shape of the namespace
+// Return:    int - 0 on success, 1 if the shape cannot be generated
+
+int aml_generate(aml_builder_t *builder, const aml_shape_t *shape)
+{
+    if(!shape->depth || shape->depth > AML_MAX_GENERATED_DEPTH
+            || (shape->devices + shape->depth - 1) / shape->depth > AML_MAX_CHAINS
+            || shape->fields > AML_MAX_CHAINS || shape->prt_entries > 255)
+    {
+        fprintf(stderr, "aml: unsupported shape: at most %d chains of depth %d, "
+                "%d fields and 255 _PRT entries\n", AML_MAX_CHAINS, AML_MAX_GENERATED_DEPTH,
+                AML_MAX_CHAINS);
+        return 1;
+    }
+
+    aml_begin_scope(builder, "\\_SB");
+    if(shape->prt_entries)
+        aml_generate_prt(builder, shape);
+
+    for(size_t first = 0; first < shape->devices; first += shape->depth)
+    {
+        size_t chain = first / shape->depth;
+        size_t levels = shape->devices - first;
+        if(levels > shape->depth)
+            levels = shape->depth;
+
+        for(size_t level = 0; level < levels; level++)
+        {
+            char name[5];
+            aml_base36(name, 'A' + level, chain);
+            aml_begin_device(builder, name);
+            aml_generate_device(builder, first + level, shape);
+        }
+        for(size_t level = 0; level < levels; level++)
+            aml_end(builder);
+    }
+
+    aml_end(builder);
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Synthetic AML Tables */
+
+#pragma once
+
+#include <stddef.h>
+#include "aml.h"
+
+// Shape of a synthetic namespace.
+typedef struct aml_shape_t
+{
+    size_t devices;         // number of devices below \_SB
+    size_t depth;           // devices are nested in chains of this depth, at least 1
+    size_t fields;          // fields per OpRegion; every device has one if nonzero
+    size_t prt_entries;     // entries of the _PRT of \_SB.PCI0, at most 255
+    size_t loop_length;     // iterations of the While() loop in every _INI
+} aml_shape_t;
+
+int aml_generate(aml_builder_t *, const aml_shape_t *);
+void aml_device_path(char *path, size_t index, const aml_shape_t *);
@@ -0,0 +1,716 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-bench: Namespace and Interpreter Benchmarks */
+/* Every benchmark runs in a forked process, so that it starts with an empty
+ * namespace. Benchmarks of operations that can only happen once per namespace
+ * (table loading, device initialization) fork once per sample. Results are
+ * written as JSON and can be compared against a stored baseline. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lai/core.h>
+#include "host.h"
+#include "aml.h"
+#include "report.h"
+
+#define BENCH_MAX_SAMPLES       64
+#define BENCH_SAMPLE_NS         20000000    // run each sample for at least 20 ms
+
+#define BENCH_DEVICES           1000
+#define BENCH_BATCH_DEVICES     10000
+#define BENCH_PRT_ENTRIES       32
+#define BENCH_IO_BASE           0x700
+#define BENCH_MMIO_BASE         0x10000
+
+typedef struct bench_t
+{
+    const char *name;
+    const char *description;
+    void (*setup)(void);
+    // Runs the operation `iterations` times. One-shot benchmarks ignore the count.
+    void (*run)(uint64_t iterations);
+    int oneshot;
+} bench_t;
+
+static uint64_t bench_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// The compiler must not drop results that are never used.
+static volatile uint64_t bench_sink;
+
+// Tables.
+
+static void bench_device_name(char *name, size_t index)
+{
+    static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    name[0] = 'D';
+    name[1] = digits[(index / 1296) % 36];
+    name[2] = digits[(index / 36) % 36];
+    name[3] = digits[index % 36];
+    name[4] = 0;
+}
+
+static void bench_add_table(aml_builder_t *builder)
+{
+    size_t length;
+    void *table = aml_finish(builder, &length);
+    if(host_add_table(table, length))
+        exit(1);
+    free(table);
+}
+
+// A DSDT with typical devices under \_SB: _HID, _ADR, _STA, _INI and _CRS.
+static void bench_build_devices(aml_builder_t *builder, size_t count, int full)
+{
+    aml_begin_scope(builder, "\\_SB");
+    for(size_t i = 0; i < count; i++)
+    {
+        char name[5];
+        bench_device_name(name, i);
+        aml_begin_device(builder, name);
+        if(full)
+        {
+            aml_name_integer(builder, "_HID", 0x0A0CD041);      // EisaId("PNP0C0A")
+            aml_name_integer(builder, "_ADR", i);
+        }
+
+        aml_begin_method(builder, "_STA", 0);
+        aml_opcode(builder, RETURN_OP);
+        aml_integer(builder, 0x0F);
+        aml_end(builder);
+
+        if(full)
+        {
+            aml_begin_method(builder, "_INI", 0);
+            aml_opcode(builder, INCREMENT_OP);
+            aml_name(builder, "\\CNT");
+            aml_end(builder);
+
+            aml_begin_method(builder, "_CRS", 0);
+            aml_opcode(builder, RETURN_OP);
+            uint8_t irq[] = {0x22, 0x00, 0x01, 0x79, 0x00};     // IRQNoFlags() {8}, EndTag
+            aml_begin_buffer(builder, sizeof(irq));
+            for(size_t j = 0; j < sizeof(irq); j++)
+                aml_byte(builder, irq[j]);
+            aml_end(builder);
+            aml_end(builder);
+        }
+        aml_end(builder);
+    }
+    aml_end(builder);
+}
+
+static void bench_load_devices(size_t count, int full)
+{
+    aml_builder_t builder;
+    aml_init(&builder, "DSDT");
+    aml_name_integer(&builder, "\\CNT", 0);
+    bench_build_devices(&builder, count, full);
+    bench_add_table(&builder);
+}
+
+// The DSDT of bench_load_devices(), followed by a Scope() that exceeds the table.
+static void bench_load_malformed(size_t count)
+{
+    aml_builder_t builder;
+    aml_init(&builder, "DSDT");
+    aml_name_integer(&builder, "\\CNT", 0);
+    bench_build_devices(&builder, count, 1);
+    aml_opcode(&builder, SCOPE_OP);
+    aml_pkglength(&builder, 0x100);
+    aml_name(&builder, "\\_SB");
+    bench_add_table(&builder);
+}
+
+// A DSDT with small methods, fields and a PCI root bridge with a _PRT.
+static void bench_load_methods(void)
+{
+    aml_builder_t builder;
+    aml_init(&builder, "DSDT");
+
+    aml_name_integer(&builder, "\\INT0", 0x1234);
+    aml_name_string(&builder, "\\STR0", "");
+
+    // ADD1(x) returns x + 1
+    aml_begin_method(&builder, "\\ADD1", 1);
+    aml_opcode(&builder, RETURN_OP);
+    aml_opcode(&builder, ADD_OP);
+    aml_opcode(&builder, ARG0_OP);
+    aml_integer(&builder, 1);
+    aml_opcode(&builder, ZERO_OP);
+    aml_end(&builder);
+
+    // STRS stores a string literal
+    aml_begin_method(&builder, "\\STRS", 0);
+    aml_opcode(&builder, STORE_OP);
+    aml_string(&builder, "The quick brown fox jumps over the lazy dog");
+    aml_name(&builder, "\\STR0");
+    aml_opcode(&builder, RETURN_OP);
+    aml_opcode(&builder, ZERO_OP);
+    aml_end(&builder);
+
+    // Fields in I/O space and in memory; RDxx reads, WRxx writes.
+    aml_opregion(&builder, "\\IOR0", OPREGION_IO, BENCH_IO_BASE, 16);
+    aml_begin_field(&builder, "\\IOR0", FIELD_DWORD_ACCESS);
+    aml_field_unit(&builder, "IOF0", 32);
+    aml_field_unit(&builder, "IOF1", 8);
+    aml_end(&builder);
+
+    aml_opregion(&builder, "\\MMR0", OPREGION_MEMORY, BENCH_MMIO_BASE, 16);
+    aml_begin_field(&builder, "\\MMR0", FIELD_DWORD_ACCESS);
+    aml_field_unit(&builder, "MMF0", 32);
+    aml_end(&builder);
+
+    const char *fields[][2] = {{"\\RDIO", "\\IOF0"}, {"\\RDMM", "\\MMF0"}};
+    for(int i = 0; i < 2; i++)
+    {
+        aml_begin_method(&builder, fields[i][0], 0);
+        aml_opcode(&builder, RETURN_OP);
+        aml_name(&builder, fields[i][1]);
+        aml_end(&builder);
+    }
+
+    const char *writes[][2] = {{"\\WRIO", "\\IOF0"}, {"\\WRMM", "\\MMF0"}};
+    for(int i = 0; i < 2; i++)
+    {
+        aml_begin_method(&builder, writes[i][0], 1);
+        aml_opcode(&builder, STORE_OP);
+        aml_opcode(&builder, ARG0_OP);
+        aml_name(&builder, writes[i][1]);
+        aml_opcode(&builder, RETURN_OP);
+        aml_opcode(&builder, ZERO_OP);
+        aml_end(&builder);
+    }
+
+    // The PCI root bridge routes each slot to a GSI; the last entry is for slot 31.
+    aml_begin_scope(&builder, "\\_SB");
+    aml_begin_device(&builder, "PCI0");
+    aml_name_integer(&builder, "_HID", 0x030AD041);     // EisaId("PNP0A03")
+    aml_byte(&builder, NAME_OP);
+    aml_name(&builder, "_PRT");
+    aml_begin_package(&builder, BENCH_PRT_ENTRIES);
+    for(int i = 0; i < BENCH_PRT_ENTRIES; i++)
+    {
+        aml_begin_package(&builder, 4);
+        aml_integer(&builder, ((uint64_t)i << 16) | 0xFFFF);
+        aml_integer(&builder, 0);
+        aml_integer(&builder, 0);
+        aml_integer(&builder, 16 + (i % 8));
+        aml_end(&builder);
+    }
+    aml_end(&builder);
+
+    // _OSC(uuid, revision, count, capabilities) masks the third DWord and, as the
+    // firmware of most PCI root bridges does, sets a bit in the first if it changed.
+    aml_begin_method(&builder, "_OSC", 4);
+    const char *dwords[] = {"CDW1", "CDW2", "CDW3"};
+    for(int i = 0; i < 3; i++)
+    {
+        aml_opcode(&builder, DWORDFIELD_OP);
+        aml_opcode(&builder, ARG3_OP);
+        aml_integer(&builder, i * 4);
+        aml_name(&builder, dwords[i]);
+    }
+    aml_opcode(&builder, AND_OP);
+    aml_name(&builder, "CDW3");
+    aml_integer(&builder, 0x1D);
+    aml_opcode(&builder, LOCAL0_OP);
+    aml_begin_if(&builder);
+    aml_opcode(&builder, LNOT_OP);
+    aml_opcode(&builder, LEQUAL_OP);
+    aml_name(&builder, "CDW3");
+    aml_opcode(&builder, LOCAL0_OP);
+    aml_opcode(&builder, OR_OP);
+    aml_name(&builder, "CDW1");
+    aml_integer(&builder, 0x10);
+    aml_name(&builder, "CDW1");
+    aml_end(&builder);
+    aml_opcode(&builder, STORE_OP);
+    aml_opcode(&builder, LOCAL0_OP);
+    aml_name(&builder, "CDW3");
+    aml_opcode(&builder, RETURN_OP);
+    aml_opcode(&builder, ARG3_OP);
+    aml_end(&builder);
+    aml_end(&builder);
+    aml_end(&builder);
+
+    bench_add_table(&builder);
+    host_add_pci_device(0, BENCH_PRT_ENTRIES - 1, 0, 0x8086, 0x1234, 1);
+}
+
+// Benchmarks.
+
+static lai_nsnode_t **bench_devices;
+static size_t bench_device_count;
+static char (*bench_paths)[ACPI_MAX_NAME];
+
+static void bench_collect_devices(void)
+{
+    lai_nsnode_t *sb = lai_ns_get_child(lai_ns_get_root(), "_SB_");
+    bench_devices = calloc(BENCH_BATCH_DEVICES, sizeof(lai_nsnode_t *));
+    bench_paths = calloc(BENCH_BATCH_DEVICES, ACPI_MAX_NAME);
+    for(lai_nsnode_t *node = sb->children; node; node = node->next_sibling)
+    {
+        if(node->type != LAI_NAMESPACE_DEVICE || bench_device_count == BENCH_BATCH_DEVICES)
+            continue;
+        // Device paths are short, there is always room for the NameSeg.
+        strcpy(bench_paths[bench_device_count], node->path);
+        strcat(bench_paths[bench_device_count], "._STA");
+        bench_devices[bench_device_count++] = node;
+    }
+}
+
+static void setup_devices(void)
+{
+    bench_load_devices(BENCH_DEVICES, 1);
+    if(lai_create_namespace())
+        exit(1);
+    bench_collect_devices();
+}
+
+static void setup_batch(void)
+{
+    bench_load_devices(BENCH_BATCH_DEVICES, 0);
+    if(lai_create_namespace())
+        exit(1);
+    bench_collect_devices();
+}
+
+static void setup_methods(void)
+{
+    bench_load_methods();
+    if(lai_create_namespace())
+        exit(1);
+}
+
+static void setup_load(void)
+{
+    bench_load_devices(BENCH_DEVICES, 1);
+}
+
+static void run_load(uint64_t iterations)
+{
+    (void)iterations;
+    if(lai_create_namespace())
+        exit(1);
+}
+
+static void setup_reject(void)
+{
+    bench_load_malformed(BENCH_DEVICES);
+}
+
+static void run_reject(uint64_t iterations)
+{
+    (void)iterations;
+    if(!lai_create_namespace())
+    {
+        fprintf(stderr, "lai-bench: the malformed DSDT was not rejected\n");
+        exit(1);
+    }
+}
+
+static void run_init(uint64_t iterations)
+{
+    (void)iterations;
+    lai_enable_acpi(0);
+}
+
+static void run_resolve_absolute(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        bench_sink += (uintptr_t)lai_resolve(bench_paths[i % bench_device_count]);
+}
+
+static void run_resolve_relative(uint64_t iterations)
+{
+    char name[5];
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        bench_device_name(name, i % bench_device_count);
+        bench_sink += (uintptr_t)lai_resolve(name);
+    }
+}
+
+static void run_get_child(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        bench_sink += (uintptr_t)lai_ns_get_child(bench_devices[i % bench_device_count], "_CRS");
+}
+
+static void run_enum(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        bench_sink += (uintptr_t)lai_enum("\\._SB_", i % bench_device_count);
+}
+
+static void bench_eval(const char *path, uint64_t iterations)
+{
+    char copy[ACPI_MAX_NAME];
+    strcpy(copy, path);
+    lai_object_t object = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_eval(&object, copy);
+        lai_free_object(&object);
+    }
+}
+
+static void bench_call(const char *path, uint64_t argument, uint64_t iterations)
+{
+    char copy[ACPI_MAX_NAME];
+    strcpy(copy, path);
+    lai_nsnode_t *handle = lai_resolve(copy);
+    lai_object_t arg = {0};
+    arg.type = LAI_INTEGER;
+    arg.integer = argument;
+
+    lai_object_t result = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_eval_args(handle, 1, &arg, &result);
+        lai_free_object(&result);
+    }
+}
+
+static void run_eval_name(uint64_t iterations)
+{
+    bench_eval("\\.INT0", iterations);
+}
+
+static void run_eval_method(uint64_t iterations)
+{
+    bench_call("\\.ADD1", 41, iterations);
+}
+
+static void run_string_store(uint64_t iterations)
+{
+    bench_eval("\\.STRS", iterations);
+}
+
+static void run_field_read_io(uint64_t iterations)
+{
+    bench_eval("\\.RDIO", iterations);
+}
+
+static void run_field_write_io(uint64_t iterations)
+{
+    bench_call("\\.WRIO", 0x12345678, iterations);
+}
+
+static void run_field_read_mmio(uint64_t iterations)
+{
+    bench_eval("\\.RDMM", iterations);
+}
+
+static void run_field_write_mmio(uint64_t iterations)
+{
+    bench_call("\\.WRMM", 0x12345678, iterations);
+}
+
+static void run_pci_route(uint64_t iterations)
+{
+    acpi_resource_t resource;
+    for(uint64_t i = 0; i < iterations; i++)
+        bench_sink += lai_pci_route(&resource, 0, BENCH_PRT_ENTRIES - 1, 0);
+}
+
+static void run_osc(uint64_t iterations)
+{
+    char path[] = "\\._SB_.PCI0._OSC";
+    lai_nsnode_t *handle = lai_resolve(path);
+    static uint8_t uuid[16] = {0x5B, 0x4D, 0xDB, 0x33, 0xF7, 0x1F, 0x1C, 0x40,
+            0x96, 0x57, 0x74, 0x41, 0xC0, 0x3D, 0xD7, 0x66};
+    static uint8_t capabilities[12] = {0, 0, 0, 0, 0x1F, 0, 0, 0, 0x1F, 0, 0, 0};
+    lai_object_t args[4] = {0};
+    args[0].type = LAI_BUFFER;
+    args[0].buffer = uuid;
+    args[0].buffer_size = sizeof(uuid);
+    args[1].type = LAI_INTEGER;
+    args[1].integer = 1;
+    args[2].type = LAI_INTEGER;
+    args[2].integer = 3;
+    args[3].type = LAI_BUFFER;
+    args[3].buffer = capabilities;
+    args[3].buffer_size = sizeof(capabilities);
+
+    lai_object_t result = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_eval_args(handle, 4, args, &result);
+        bench_sink += ((uint8_t *)result.buffer)[0];
+        lai_free_object(&result);
+    }
+}
+
+static void run_sta_loop(uint64_t iterations)
+{
+    lai_object_t result = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_nsnode_t *sta = lai_ns_get_child(bench_devices[i % bench_device_count], "_STA");
+        lai_eval_args(sta, 0, NULL, &result);
+        bench_sink += result.integer;
+        lai_free_object(&result);
+    }
+}
+
+static void run_sta_batch(uint64_t iterations)
+{
+    static uint64_t results[BENCH_BATCH_DEVICES];
+    for(uint64_t done = 0; done < iterations; done += bench_device_count)
+    {
+        size_t count = bench_device_count;
+        if(iterations - done < count)
+            count = iterations - done;
+        bench_sink += lai_eval_batch(bench_devices, count, "_STA", results);
+    }
+}
+
+static const bench_t bench_list[] = {
+    {"load", "DSDT with 1000 devices: lai_create_namespace()", setup_load, run_load, 1},
+    {"reject", "DSDT with 1000 devices and a bad PkgLength: rejected by lai_create_namespace()", setup_reject, run_reject, 1},
+    {"init", "lai_enable_acpi() on 1000 devices with _STA and _INI", setup_devices, run_init, 1},
+    {"resolve_absolute", "lai_resolve() of absolute paths, 1000 devices", setup_devices, run_resolve_absolute, 0},
+    {"resolve_relative", "lai_resolve() of single NameSegs, 1000 devices", setup_devices, run_resolve_relative, 0},
+    {"get_child", "lai_ns_get_child() of _CRS", setup_devices, run_get_child, 0},
+    {"enum", "lai_enum() of the children of _SB_, 1000 devices", setup_devices, run_enum, 0},
+    {"eval_name", "lai_eval() of an integer Name()", setup_methods, run_eval_name, 0},
+    {"eval_method", "lai_eval_args() of a method with one argument", setup_methods, run_eval_method, 0},
+    {"string_store", "method that stores a string literal to a Name()", setup_methods, run_string_store, 0},
+    {"field_read_io", "method that reads a SystemIO field", setup_methods, run_field_read_io, 0},
+    {"field_write_io", "method that writes a SystemIO field", setup_methods, run_field_write_io, 0},
+    {"field_read_mmio", "method that reads a SystemMemory field", setup_methods, run_field_read_mmio, 0},
+    {"field_write_mmio", "method that writes a SystemMemory field", setup_methods, run_field_write_mmio, 0},
+    {"pci_route", "lai_pci_route() through a 32 entry _PRT", setup_methods, run_pci_route, 0},
+    {"osc", "lai_eval_args() of an _OSC that creates DWord fields over Arg3", setup_methods, run_osc, 0},
+    {"sta_loop", "_STA of 10000 devices through lai_eval_args(), per device", setup_batch, run_sta_loop, 0},
+    {"sta_batch", "_STA of 10000 devices through lai_eval_batch(), per device", setup_batch, run_sta_batch, 0},
+};
+
+#define BENCH_COUNT (sizeof(bench_list) / sizeof(bench_t))
+
+// Runner.
+
+// bench_sample(): Takes samples in a child process
+// Param:    const bench_t *bench - benchmark
+// Param:    double *samples - receives ns per operation
+// Param:    int count - number of samples to take
+// Return:    int - number of samples that were taken
+
+static int bench_sample(const bench_t *bench, double *samples, int count)
+{
+    int pipes[2];
+    if(pipe(pipes))
+        return 0;
+
+    pid_t pid = fork();
+    if(pid < 0)
+        return 0;
+
+    if(!pid)
+    {
+        close(pipes[0]);
+        host_set_verbose(0);
+        bench->setup();
+
+        // Calibrate, so that one sample runs for at least BENCH_SAMPLE_NS.
+        uint64_t iterations = 1;
+        if(!bench->oneshot)
+        {
+            while(1)
+            {
+                uint64_t start = bench_now();
+                bench->run(iterations);
+                if(bench_now() - start >= BENCH_SAMPLE_NS / 10 || iterations >= (1ULL << 32))
+                    break;
+                iterations *= 2;
+            }
+            iterations *= 10;
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            uint64_t start = bench_now();
+            bench->run(iterations);
+            double sample = (double)(bench_now() - start) / iterations;
+            if(write(pipes[1], &sample, sizeof(double)) != sizeof(double))
+                _exit(1);
+        }
+        _exit(0);
+    }
+
+    close(pipes[1]);
+    int taken = 0;
+    while(taken < count && read(pipes[0], &samples[taken], sizeof(double)) == sizeof(double))
+        taken++;
+    close(pipes[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status))
+        return 0;
+    return taken;
+}
+
+static bench_report_t bench_execute(const bench_t *bench, int count)
+{
+    bench_report_t result = {.name = bench->name, .description = bench->description};
+    double samples[BENCH_MAX_SAMPLES];
+    int taken = 0;
+
+    if(bench->oneshot)
+    {
+        // The namespace can only be created once per process.
+        for(int i = 0; i < count; i++)
+        {
+            if(bench_sample(bench, &samples[taken], 1) != 1)
+                return result;
+            taken++;
+        }
+    } else
+    {
+        taken = bench_sample(bench, samples, count);
+        if(taken != count)
+            return result;
+    }
+
+    bench_summarize(&result, samples, taken);
+    return result;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-bench [options] [BENCHMARK...]\n"
+            "  -l           list benchmarks\n"
+            "  -n SAMPLES   samples per benchmark (default 10)\n"
+            "  -o FILE      write results as JSON\n"
+            "  -b FILE      compare against a baseline written by -o\n"
+            "  -t PERCENT   slowdown of the median that counts as a regression (default 10)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int samples = 10;
+    const char *output = NULL;
+    const char *baseline_path = NULL;
+    double threshold = 10;
+
+    int option;
+    while((option = getopt(argc, argv, "ln:o:b:t:")) != -1)
+    {
+        switch(option)
+        {
+        case 'l':
+            for(size_t i = 0; i < BENCH_COUNT; i++)
+                printf("%-20s %s\n", bench_list[i].name, bench_list[i].description);
+            return 0;
+        case 'n':
+            samples = atoi(optarg);
+            if(samples < 1 || samples > BENCH_MAX_SAMPLES)
+                usage();
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    const bench_t *selected[BENCH_COUNT];
+    int count = 0;
+    for(size_t i = 0; i < BENCH_COUNT; i++)
+    {
+        int wanted = (optind == argc);
+        for(int j = optind; j < argc; j++)
+        {
+            if(!strcmp(argv[j], bench_list[i].name))
+                wanted = 1;
+        }
+        if(wanted)
+            selected[count++] = &bench_list[i];
+    }
+    if(!count)
+        usage();
+
+    char *baseline = NULL;
+    if(baseline_path)
+    {
+        baseline = bench_read_file(baseline_path);
+        if(!baseline)
+        {
+            fprintf(stderr, "lai-bench: unable to read baseline %s\n", baseline_path);
+            return 1;
+        }
+    }
+
+    bench_report_t results[BENCH_COUNT];
+    int failed = 0, regressed = 0;
+    printf("%-20s %12s %12s", "benchmark", "median ns/op", "min ns/op");
+    if(baseline)
+        printf(" %12s %8s", "baseline", "change");
+    printf("\n");
+
+    for(int i = 0; i < count; i++)
+    {
+        results[i] = bench_execute(selected[i], samples);
+        if(!results[i].valid)
+        {
+            printf("%-20s %12s\n", selected[i]->name, "FAILED");
+            failed = 1;
+            continue;
+        }
+
+        printf("%-20s %12.1f %12.1f", selected[i]->name, results[i].median, results[i].min);
+        double reference;
+        if(baseline && !bench_baseline_median(baseline, selected[i]->name, &reference))
+        {
+            double change = (results[i].median / reference - 1) * 100;
+            printf(" %12.1f %+7.1f%%", reference, change);
+            if(change > threshold)
+            {
+                printf("  REGRESSION");
+                regressed = 1;
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if(output)
+    {
+        FILE *file = fopen(output, "w");
+        if(!file)
+        {
+            fprintf(stderr, "lai-bench: unable to write %s\n", output);
+            return 1;
+        }
+        bench_write_json(file, "ns/op", results, count);
+        fclose(file);
+    }
+
+    free(baseline);
+    return (failed || regressed) ? 1 : 0;
+}
@@ -0,0 +1,618 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-microbench: Microbenchmarks of Interpreter Mechanisms */
+/* Mechanisms that are exported by the interpreter (object copies, the operand
+ * stack, lai_exec_method()) are called directly. Everything else is measured
+ * differentially: a method that repeats an operation is compared against a
+ * method without it, and the difference is divided by the number of repetitions.
+ * Samples of a benchmark and of its baseline are interleaved, so that frequency
+ * changes affect both. On x86, times are read from the TSC and reported in its
+ * (constant) cycles; elsewhere, nanoseconds are reported. */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <lai/core.h>
+#include "exec_impl.h"
+#include "ns_impl.h"
+#include "libc.h"
+#include "aml_opcodes.h"
+#include "host.h"
+#include "aml.h"
+#include "report.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MICRO_UNIT              "cycles/op"
+#else
+#define MICRO_UNIT              "ns/op"
+#endif
+
+#define MICRO_MAX_SAMPLES       64
+#define MICRO_SAMPLE_NS         2000000     // run each sample for at least 2 ms
+#define MICRO_REPEAT            64          // repetitions of an operation within a method
+#define MICRO_OPSTACK_DEPTH     8
+
+typedef struct micro_t
+{
+    const char *name;
+    const char *description;
+    void (*run)(uint64_t iterations);
+    int operations;             // operations per iteration
+    const char *baseline;       // benchmark whose time per iteration is subtracted
+} micro_t;
+
+static uint64_t micro_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static inline uint64_t micro_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return micro_now();
+#endif
+}
+
+// The compiler must not drop results that are never used.
+static volatile uint64_t micro_sink;
+
+// Table.
+
+static void micro_repeat_method(aml_builder_t *builder, const char *name,
+        void (*emit)(aml_builder_t *))
+{
+    aml_begin_method(builder, name, 0);
+    for(int i = 0; emit && i < MICRO_REPEAT; i++)
+        emit(builder);
+    aml_end(builder);
+}
+
+static void emit_nop(aml_builder_t *builder)
+{
+    aml_opcode(builder, NOP_OP);
+}
+
+// If(One) {}
+static void emit_if(aml_builder_t *builder)
+{
+    aml_begin_if(builder);
+    aml_opcode(builder, ONE_OP);
+    aml_end(builder);
+}
+
+// Store(Zero, Local0)
+static void emit_store(aml_builder_t *builder)
+{
+    aml_opcode(builder, STORE_OP);
+    aml_opcode(builder, ZERO_OP);
+    aml_opcode(builder, LOCAL0_OP);
+}
+
+// Store(Package(8) {0, ..., 7}, Local0)
+static void emit_package(aml_builder_t *builder)
+{
+    aml_opcode(builder, STORE_OP);
+    aml_begin_package(builder, 8);
+    for(int i = 0; i < 8; i++)
+        aml_integer(builder, i);
+    aml_end(builder);
+    aml_opcode(builder, LOCAL0_OP);
+}
+
+// MEMP()
+static void emit_call(aml_builder_t *builder)
+{
+    aml_name(builder, "\\MEMP");
+}
+
+// Store(MFLD, Local0)
+static void emit_buffer_field(aml_builder_t *builder)
+{
+    aml_opcode(builder, STORE_OP);
+    aml_name(builder, "\\MFLD");
+    aml_opcode(builder, LOCAL0_OP);
+}
+
+static void micro_load(void)
+{
+    aml_builder_t builder;
+    aml_init(&builder, "DSDT");
+    micro_repeat_method(&builder, "\\MEMP", NULL);
+    micro_repeat_method(&builder, "\\MNOP", emit_nop);
+    micro_repeat_method(&builder, "\\MIFS", emit_if);
+    micro_repeat_method(&builder, "\\MSTO", emit_store);
+    micro_repeat_method(&builder, "\\MPKG", emit_package);
+    micro_repeat_method(&builder, "\\MCAL", emit_call);
+
+    // Name(MBUF, Buffer(16) {}), CreateField(MBUF, 3, 29, MFLD)
+    aml_opcode(&builder, NAME_OP);
+    aml_name(&builder, "\\MBUF");
+    aml_begin_buffer(&builder, 16);
+    aml_end(&builder);
+    aml_opcode(&builder, (EXTOP_PREFIX << 8) | ARBFIELD_OP);
+    aml_name(&builder, "\\MBUF");
+    aml_integer(&builder, 3);
+    aml_integer(&builder, 29);
+    aml_name(&builder, "\\MFLD");
+    micro_repeat_method(&builder, "\\MBFL", emit_buffer_field);
+
+    size_t length;
+    void *table = aml_finish(&builder, &length);
+    if(host_add_table(table, length))
+        exit(1);
+    free(table);
+
+    host_set_verbose(0);
+    if(lai_create_namespace())
+        exit(1);
+}
+
+// Benchmarks.
+
+static void micro_method(const char *path, uint64_t iterations)
+{
+    char copy[ACPI_MAX_NAME];
+    strcpy(copy, path);
+    lai_nsnode_t *method = lai_resolve(copy);
+    if(!method)
+        lai_panic("lai-microbench: %s is missing\n", path);
+
+    lai_state_t state;
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_init_state(&state);
+        if(lai_exec_method(method, &state))
+            lai_panic("lai-microbench: %s failed\n", path);
+        lai_finalize_state(&state);
+    }
+}
+
+static void run_empty(uint64_t iterations)
+{
+    micro_method("\\.MEMP", iterations);
+}
+
+static void run_nop(uint64_t iterations)
+{
+    micro_method("\\.MNOP", iterations);
+}
+
+static void run_if(uint64_t iterations)
+{
+    micro_method("\\.MIFS", iterations);
+}
+
+static void run_store(uint64_t iterations)
+{
+    micro_method("\\.MSTO", iterations);
+}
+
+static void run_package(uint64_t iterations)
+{
+    micro_method("\\.MPKG", iterations);
+}
+
+static void run_call(uint64_t iterations)
+{
+    micro_method("\\.MCAL", iterations);
+}
+
+static void run_buffer_field(uint64_t iterations)
+{
+    micro_method("\\.MBFL", iterations);
+}
+
+static void run_opstack(uint64_t iterations)
+{
+    lai_state_t state;
+    lai_init_state(&state);
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        for(int j = 0; j < MICRO_OPSTACK_DEPTH; j++)
+        {
+            lai_object_t *object = lai_exec_push_opstack_or_die(&state);
+            object->type = LAI_INTEGER;
+            object->integer = j;
+        }
+        micro_sink += lai_exec_get_opstack(&state, 0)->integer;
+        lai_exec_pop_opstack(&state, MICRO_OPSTACK_DEPTH);
+    }
+}
+
+static void run_copy_integer(uint64_t iterations)
+{
+    lai_object_t source = {.type = LAI_INTEGER, .integer = 42};
+    lai_object_t destination = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+        lai_copy_object(&destination, &source);
+    micro_sink += destination.integer;
+}
+
+static void run_copy_string(uint64_t iterations)
+{
+    static char text[] = "The quick brown fox jumps over the lazy dog";
+    lai_object_t source = {.type = LAI_STRING, .string = text};
+    lai_object_t destination = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+        lai_copy_object(&destination, &source);
+    lai_free_object(&destination);
+}
+
+static void run_copy_package(uint64_t iterations)
+{
+    lai_object_t elements[8];
+    for(int i = 0; i < 8; i++)
+        elements[i] = (lai_object_t){.type = LAI_INTEGER, .integer = i};
+    lai_object_t source = {.type = LAI_PACKAGE, .package = elements, .package_size = 8};
+    lai_object_t destination = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+        lai_copy_object(&destination, &source);
+    lai_free_object(&destination);
+}
+
+static void run_move(uint64_t iterations)
+{
+    lai_object_t a = {.type = LAI_INTEGER, .integer = 42};
+    lai_object_t b = {0};
+    for(uint64_t i = 0; i < iterations; i++)
+    {
+        lai_move_object(&b, &a);
+        lai_move_object(&a, &b);
+    }
+    micro_sink += a.integer;
+}
+
+static void run_resolve_path(uint64_t iterations)
+{
+    // \_SB_.PCI0.LPCB.EC0_, encoded as a MultiNamePath.
+    static uint8_t path[] = {ROOT_CHAR, MULTI_PREFIX, 4, '_', 'S', 'B', '_',
+            'P', 'C', 'I', '0', 'L', 'P', 'C', 'B', 'E', 'C', '0', '_'};
+    char fullpath[ACPI_MAX_NAME];
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_resolve_path(NULL, fullpath, path);
+}
+
+static void run_resolve_parent(uint64_t iterations)
+{
+    // ^^_STA, relative to \_SB_.PCI0.LPCB.EC0_.
+    static uint8_t path[] = {PARENT_CHAR, PARENT_CHAR, '_', 'S', 'T', 'A'};
+    static lai_nsnode_t context = {.path = "\\._SB_.PCI0.LPCB.EC0_"};
+    char fullpath[ACPI_MAX_NAME];
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_resolve_path(&context, fullpath, path);
+}
+
+// Byte-wise string functions that libc.c used before it processed whole words.
+// They are not inlined, so that they are called like the functions in libc.c.
+
+__attribute__((noinline)) static size_t old_strlen(const char *s)
+{
+    size_t len = 0;
+    for(size_t i = 0; s[i]; i++)
+    {
+        // Otherwise, the compiler turns the loop back into a call to strlen().
+        __asm__("" : "+r"(len));
+        len++;
+    }
+    return len;
+}
+
+__attribute__((noinline)) static char *old_strcpy(char *dest, const char *src)
+{
+    char *dest_it = dest;
+    while(*src)
+        *(dest_it++) = *(src++);
+    *dest_it = 0;
+    return dest;
+}
+
+__attribute__((noinline)) static int old_strcmp(const char *a, const char *b)
+{
+    size_t i = 0;
+    while(1)
+    {
+        unsigned char ac = a[i];
+        unsigned char bc = b[i];
+        if(!ac && !bc)
+            return 0;
+        if(ac < bc)
+            return -1;
+        if(ac > bc)
+            return 1;
+        i++;
+    }
+}
+
+// NameSegs were compared by memcmp(), which is a byte-wise loop in freestanding builds.
+__attribute__((noinline)) static int old_nameseg_equal(const void *a, const void *b)
+{
+    const unsigned char *as = a;
+    const unsigned char *bs = b;
+    for(int i = 0; i < 4; i++)
+        if(as[i] != bs[i])
+            return 0;
+    return 1;
+}
+
+// A namespace path of 31 characters; both copies are aligned like lai_nsnode_t::path.
+static _Alignas(16) char micro_path[ACPI_MAX_NAME] = "\\._SB_.PCI0.LPCB.EC0_.BAT0._BST";
+static _Alignas(16) char micro_path_copy[ACPI_MAX_NAME] = "\\._SB_.PCI0.LPCB.EC0_.BAT0._BST";
+
+// The compiler must not assume that the strings are constant.
+static char *volatile micro_string = micro_path;
+static char *volatile micro_string_copy = micro_path_copy;
+
+static void run_strlen(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_strlen(micro_string);
+}
+
+static void run_strlen_old(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += old_strlen(micro_string);
+}
+
+static void run_strcpy(uint64_t iterations)
+{
+    char destination[ACPI_MAX_NAME];
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_strcpy(destination, micro_string)[0];
+}
+
+static void run_strcpy_old(uint64_t iterations)
+{
+    char destination[ACPI_MAX_NAME];
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += old_strcpy(destination, micro_string)[0];
+}
+
+static void run_strcmp(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_strcmp(micro_string, micro_string_copy);
+}
+
+static void run_strcmp_old(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += old_strcmp(micro_string, micro_string_copy);
+}
+
+static void run_nameseg(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += lai_nameseg_equal(micro_string + 28, micro_string_copy + 28);
+}
+
+static void run_nameseg_old(uint64_t iterations)
+{
+    for(uint64_t i = 0; i < iterations; i++)
+        micro_sink += old_nameseg_equal(micro_string + 28, micro_string_copy + 28);
+}
+
+static const micro_t micro_list[] = {
+    {"empty_method", "lai_exec_method() of an empty method, with lai_init_state()",
+            run_empty, 1, NULL},
+    {"dispatch", "one Noop through the opcode dispatch of lai_exec_run()",
+            run_nop, MICRO_REPEAT, "empty_method"},
+    {"eval_operand", "If (One) {}: evaluation of a predicate operand",
+            run_if, MICRO_REPEAT, "empty_method"},
+    {"store", "Store (Zero, Local0)", run_store, MICRO_REPEAT, "empty_method"},
+    {"package", "Package (8) {...} of integers, in addition to Store ()",
+            run_package, MICRO_REPEAT, "store"},
+    {"call", "call of an empty method from AML", run_call, MICRO_REPEAT, "empty_method"},
+    {"buffer_field", "read of a 29-bit CreateField () at bit 3, in addition to Store ()",
+            run_buffer_field, MICRO_REPEAT, "store"},
+    {"opstack", "push and pop of an integer on the operand stack",
+            run_opstack, MICRO_OPSTACK_DEPTH, NULL},
+    {"copy_integer", "lai_copy_object() of an integer", run_copy_integer, 1, NULL},
+    {"copy_string", "lai_copy_object() of a 43 character string", run_copy_string, 1, NULL},
+    {"copy_package", "lai_copy_object() of a package of 8 integers", run_copy_package, 1, NULL},
+    {"move", "lai_move_object() of an integer", run_move, 2, NULL},
+    {"resolve_path", "lai_resolve_path() of an absolute path of 4 segments",
+            run_resolve_path, 1, NULL},
+    {"resolve_parent", "lai_resolve_path() of ^^_STA in a scope 4 levels deep",
+            run_resolve_parent, 1, NULL},
+    {"strlen", "lai_strlen() of a 31 character path", run_strlen, 1, NULL},
+    {"strlen_old", "byte-wise strlen() of a 31 character path", run_strlen_old, 1, NULL},
+    {"strcpy", "lai_strcpy() of a 31 character path", run_strcpy, 1, NULL},
+    {"strcpy_old", "byte-wise strcpy() of a 31 character path", run_strcpy_old, 1, NULL},
+    {"strcmp", "lai_strcmp() of two equal 31 character paths", run_strcmp, 1, NULL},
+    {"strcmp_old", "byte-wise strcmp() of two equal 31 character paths",
+            run_strcmp_old, 1, NULL},
+    {"nameseg", "lai_nameseg_equal() of two equal NameSegs", run_nameseg, 1, NULL},
+    {"nameseg_old", "byte-wise memcmp() of two equal NameSegs", run_nameseg_old, 1, NULL},
+};
+
+#define MICRO_COUNT (sizeof(micro_list) / sizeof(micro_t))
+
+// Runner.
+
+static const micro_t *micro_find(const char *name)
+{
+    for(size_t i = 0; i < MICRO_COUNT; i++)
+    {
+        if(!strcmp(micro_list[i].name, name))
+            return &micro_list[i];
+    }
+    return NULL;
+}
+
+static uint64_t micro_calibrate(const micro_t *micro)
+{
+    uint64_t iterations = 1;
+    while(1)
+    {
+        uint64_t start = micro_now();
+        micro->run(iterations);
+        if(micro_now() - start >= MICRO_SAMPLE_NS / 10 || iterations >= (1ULL << 32))
+            break;
+        iterations *= 2;
+    }
+    return iterations * 10;
+}
+
+static double micro_sample(const micro_t *micro, uint64_t iterations)
+{
+    uint64_t start = micro_ticks();
+    micro->run(iterations);
+    return (double)(micro_ticks() - start) / iterations;
+}
+
+// micro_execute(): Samples a benchmark, minus its baseline
+// Param:    const micro_t *micro - benchmark
+// Param:    int count - number of samples
+// Return:    bench_report_t - time per operation
+
+static bench_report_t micro_execute(const micro_t *micro, int count)
+{
+    bench_report_t report = {.name = micro->name, .description = micro->description};
+    const micro_t *baseline = micro->baseline ? micro_find(micro->baseline) : NULL;
+
+    uint64_t iterations = micro_calibrate(micro);
+    double samples[MICRO_MAX_SAMPLES];
+    for(int i = 0; i < count; i++)
+    {
+        double sample = micro_sample(micro, iterations);
+        if(baseline)
+            sample -= micro_sample(baseline, iterations);
+        samples[i] = sample / micro->operations;
+    }
+
+    bench_summarize(&report, samples, count);
+    return report;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-microbench [options] [BENCHMARK...]\n"
+            "  -l           list benchmarks\n"
+            "  -n SAMPLES   samples per benchmark (default 15)\n"
+            "  -o FILE      write results as JSON\n"
+            "  -b FILE      compare against a baseline written by -o\n"
+            "  -t PERCENT   slowdown of the median that counts as a regression (default 10)\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    int samples = 15;
+    const char *output = NULL;
+    const char *baseline_path = NULL;
+    double threshold = 10;
+
+    int option;
+    while((option = getopt(argc, argv, "ln:o:b:t:")) != -1)
+    {
+        switch(option)
+        {
+        case 'l':
+            for(size_t i = 0; i < MICRO_COUNT; i++)
+                printf("%-16s %s\n", micro_list[i].name, micro_list[i].description);
+            return 0;
+        case 'n':
+            samples = atoi(optarg);
+            if(samples < 1 || samples > MICRO_MAX_SAMPLES)
+                usage();
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    const micro_t *selected[MICRO_COUNT];
+    int count = 0;
+    for(size_t i = 0; i < MICRO_COUNT; i++)
+    {
+        int wanted = (optind == argc);
+        for(int j = optind; j < argc; j++)
+        {
+            if(!strcmp(argv[j], micro_list[i].name))
+                wanted = 1;
+        }
+        if(wanted)
+            selected[count++] = &micro_list[i];
+    }
+    if(!count)
+        usage();
+
+    char *baseline = NULL;
+    if(baseline_path)
+    {
+        baseline = bench_read_file(baseline_path);
+        if(!baseline)
+        {
+            fprintf(stderr, "lai-microbench: unable to read baseline %s\n", baseline_path);
+            return 1;
+        }
+    }
+
+    // All benchmarks share one namespace; none of them modifies it.
+    micro_load();
+
+    bench_report_t results[MICRO_COUNT];
+    int regressed = 0;
+    printf("%-16s %10s %10s", "benchmark", "median", "min");
+    if(baseline)
+        printf(" %10s %8s", "baseline", "change");
+    printf("   (%s)\n", MICRO_UNIT);
+
+    for(int i = 0; i < count; i++)
+    {
+        results[i] = micro_execute(selected[i], samples);
+        printf("%-16s %10.1f %10.1f", selected[i]->name, results[i].median, results[i].min);
+
+        double reference;
+        if(baseline && !bench_baseline_median(baseline, selected[i]->name, &reference))
+        {
+            double change = (results[i].median / reference - 1) * 100;
+            printf(" %10.1f %+7.1f%%", reference, change);
+            if(change > threshold)
+            {
+                printf("  REGRESSION");
+                regressed = 1;
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if(output)
+    {
+        FILE *file = fopen(output, "w");
+        if(!file)
+        {
+            fprintf(stderr, "lai-microbench: unable to write %s\n", output);
+            return 1;
+        }
+        bench_write_json(file, MICRO_UNIT, results, count);
+        fclose(file);
+    }
+
+    free(baseline);
+    return regressed ? 1 : 0;
+}
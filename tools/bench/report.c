@@ -0,0 +1,92 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Benchmark Results */
+
+#include <stdlib.h>
+#include <string.h>
+#include "report.h"
+
+static int bench_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// bench_summarize(): Computes the median and the range of samples
+// Param:    bench_report_t *report - receives the results
+// Param:    double *samples - samples, sorted in place
+// Param:    int count - number of samples, at least 1
+// Return:    Nothing
+
+void bench_summarize(bench_report_t *report, double *samples, int count)
+{
+    qsort(samples, count, sizeof(double), bench_compare_double);
+    report->valid = 1;
+    report->samples = count;
+    report->min = samples[0];
+    report->max = samples[count - 1];
+    report->median = (count % 2) ? samples[count / 2]
+            : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+}
+
+// bench_baseline_median(): Finds the median of a benchmark in a JSON result file
+// Param:    const char *json - contents of the file, as written by bench_write_json()
+// Param:    const char *name - benchmark
+// Param:    double *median - receives the median
+// Return:    int - 0 if the benchmark was found
+
+int bench_baseline_median(const char *json, const char *name, double *median)
+{
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char *entry = strstr(json, key);
+    if(!entry)
+        return 1;
+
+    const char *end = strchr(entry, '}');
+    const char *value = strstr(entry, "\"median\": ");
+    if(!value || (end && value > end))
+        return 1;
+
+    *median = strtod(value + strlen("\"median\": "), NULL);
+    return 0;
+}
+
+char *bench_read_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+
+    char *data = malloc(length + 1);
+    if(data && fread(data, 1, length, file) == (size_t)length)
+        data[length] = 0;
+    else
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+void bench_write_json(FILE *file, const char *unit, const bench_report_t *reports, int count)
+{
+    fprintf(file, "{\n  \"unit\": \"%s\",\n  \"benchmarks\": [\n", unit);
+    for(int i = 0; i < count; i++)
+    {
+        fprintf(file, "    {\"name\": \"%s\", \"description\": \"%s\", \"valid\": %s, "
+                "\"samples\": %d, \"median\": %.3f, \"min\": %.3f, \"max\": %.3f}%s\n",
+                reports[i].name, reports[i].description, reports[i].valid ? "true" : "false",
+                reports[i].samples, reports[i].median, reports[i].min, reports[i].max,
+                (i + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
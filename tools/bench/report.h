@@ -0,0 +1,27 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Benchmark Results */
+/* Shared by lai-bench and lai-microbench, so that both write and compare
+ * the same JSON format. */
+
+#pragma once
+
+#include <stdio.h>
+
+typedef struct bench_report_t
+{
+    const char *name;
+    const char *description;
+    int valid;
+    int samples;
+    double median, min, max;    // per operation, in the unit of the report
+} bench_report_t;
+
+void bench_summarize(bench_report_t *, double *samples, int count);
+
+char *bench_read_file(const char *);
+int bench_baseline_median(const char *json, const char *name, double *median);
+void bench_write_json(FILE *, const char *unit, const bench_report_t *, int count);
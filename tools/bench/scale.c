@@ -0,0 +1,261 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-scale: Measures how LAI scales with the size of the namespace */
+/* For each size, a synthetic DSDT is generated and loaded in a forked process.
+ * The output is CSV that can be plotted directly (e.g. with gnuplot, which skips
+ * the '#' lines). At the end, the slope of each metric on a log-log scale is
+ * estimated; a slope above the expected one means superlinear behaviour. */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <lai/core.h>
+#include "host.h"
+#include "aml.h"
+#include "generate.h"
+
+#define SCALE_MAX_SIZES         32
+#define SCALE_METRICS           3
+
+typedef struct scale_sample_t
+{
+    double nodes;
+    double metric[SCALE_METRICS];
+} scale_sample_t;
+
+static const struct
+{
+    const char *name;
+    double expected;        // expected slope on a log-log scale
+} scale_metrics[SCALE_METRICS] = {
+    {"create_ns", 1.0},             // lai_create_namespace(), whole table
+    {"resolve_ns_per_op", 0.0},     // lai_resolve() of a device path
+    {"init_ns", 1.0},               // lai_enable_acpi(), all devices
+};
+
+static uint64_t scale_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+// scale_measure(): Loads a synthetic namespace and measures it; runs in a child process
+// Param:    const aml_shape_t *shape - shape of the namespace
+// Param:    scale_sample_t *sample - results
+// Return:    Nothing
+
+static void scale_measure(const aml_shape_t *shape, scale_sample_t *sample)
+{
+    aml_builder_t builder;
+    aml_init(&builder, "DSDT");
+    if(aml_generate(&builder, shape))
+        exit(1);
+
+    size_t length;
+    void *table = aml_finish(&builder, &length);
+    if(host_add_table(table, length))
+        exit(1);
+    free(table);
+
+    uint64_t start = scale_now();
+    if(lai_create_namespace())
+        exit(1);
+    sample->metric[0] = scale_now() - start;
+    sample->nodes = lai_ns_size;
+
+    char (*paths)[ACPI_MAX_NAME] = calloc(shape->devices, ACPI_MAX_NAME);
+    if(!paths)
+        exit(1);
+    for(size_t i = 0; i < shape->devices; i++)
+        aml_device_path(paths[i], i, shape);
+
+    // Resolve every device at least once, and for at least 10 ms.
+    uint64_t lookups = 0;
+    start = scale_now();
+    do
+    {
+        for(size_t i = 0; i < shape->devices; i++)
+        {
+            if(!lai_resolve(paths[i]))
+            {
+                fprintf(stderr, "lai-scale: %s was not created\n", paths[i]);
+                exit(1);
+            }
+        }
+        lookups += shape->devices;
+    } while(scale_now() - start < 10000000);
+    sample->metric[1] = (double)(scale_now() - start) / lookups;
+    free(paths);
+
+    start = scale_now();
+    lai_enable_acpi(0);
+    sample->metric[2] = scale_now() - start;
+}
+
+static int scale_run(const aml_shape_t *shape, scale_sample_t *sample)
+{
+    int pipes[2];
+    if(pipe(pipes))
+        return 1;
+
+    pid_t pid = fork();
+    if(pid < 0)
+        return 1;
+
+    if(!pid)
+    {
+        close(pipes[0]);
+        scale_measure(shape, sample);
+        if(write(pipes[1], sample, sizeof(scale_sample_t)) != sizeof(scale_sample_t))
+            _exit(1);
+        _exit(0);
+    }
+
+    close(pipes[1]);
+    ssize_t size = read(pipes[0], sample, sizeof(scale_sample_t));
+    close(pipes[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if(size != sizeof(scale_sample_t) || !WIFEXITED(status) || WEXITSTATUS(status))
+        return 1;
+    return 0;
+}
+
+// scale_slope(): Least-squares slope of log(y) over log(x)
+static double scale_slope(const double *x, const double *y, int count)
+{
+    double mean_x = 0, mean_y = 0;
+    for(int i = 0; i < count; i++)
+    {
+        mean_x += log(x[i]) / count;
+        mean_y += log(y[i]) / count;
+    }
+
+    double numerator = 0, denominator = 0;
+    for(int i = 0; i < count; i++)
+    {
+        numerator += (log(x[i]) - mean_x) * (log(y[i]) - mean_y);
+        denominator += (log(x[i]) - mean_x) * (log(x[i]) - mean_x);
+    }
+    return denominator ? numerator / denominator : 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-scale [options]\n"
+            "  -s DEVICES   smallest number of devices (default 256)\n"
+            "  -e DEVICES   largest number of devices (default 8192)\n"
+            "  -d DEPTH     nesting depth of the devices (default 4)\n"
+            "  -m FIELDS    fields per OpRegion (default 4)\n"
+            "  -k ENTRIES   entries of the _PRT (default 32)\n"
+            "  -l LENGTH    iterations of the loop in each _INI (default 8)\n"
+            "  -t SLOPE     tolerance above the expected slope (default 0.25)\n"
+            "  -f           exit with an error if a metric grows superlinearly\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    aml_shape_t shape = {.depth = 4, .fields = 4, .prt_entries = 32, .loop_length = 8};
+    size_t smallest = 256, largest = 8192;
+    double tolerance = 0.25;
+    int fail = 0;
+
+    int option;
+    while((option = getopt(argc, argv, "s:e:d:m:k:l:t:f")) != -1)
+    {
+        switch(option)
+        {
+        case 's':
+            smallest = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            largest = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            shape.depth = strtoul(optarg, NULL, 0);
+            break;
+        case 'm':
+            shape.fields = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            shape.prt_entries = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            shape.loop_length = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            tolerance = atof(optarg);
+            break;
+        case 'f':
+            fail = 1;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if(!smallest || largest < smallest || optind != argc)
+        usage();
+
+    scale_sample_t samples[SCALE_MAX_SIZES];
+    double sizes[SCALE_MAX_SIZES];
+    int count = 0;
+
+    printf("# depth %zu, %zu fields per OpRegion, %zu _PRT entries, loops of %zu\n",
+            shape.depth, shape.fields, shape.prt_entries, shape.loop_length);
+    printf("devices,nodes");
+    for(int i = 0; i < SCALE_METRICS; i++)
+        printf(",%s", scale_metrics[i].name);
+    printf("\n");
+
+    for(size_t devices = smallest; devices <= largest && count < SCALE_MAX_SIZES; devices *= 2)
+    {
+        shape.devices = devices;
+        if(scale_run(&shape, &samples[count]))
+        {
+            fprintf(stderr, "lai-scale: measurement of %zu devices failed\n", devices);
+            return 1;
+        }
+
+        sizes[count] = samples[count].nodes;
+        printf("%zu,%.0f", devices, samples[count].nodes);
+        for(int i = 0; i < SCALE_METRICS; i++)
+            printf(",%.1f", samples[count].metric[i]);
+        printf("\n");
+        fflush(stdout);
+        count++;
+    }
+
+    if(count < 2)
+        return 0;
+
+    // Slopes are taken against the number of namespace nodes.
+    int superlinear = 0;
+    for(int i = 0; i < SCALE_METRICS; i++)
+    {
+        double values[SCALE_MAX_SIZES];
+        for(int j = 0; j < count; j++)
+            values[j] = samples[j].metric[i];
+
+        double slope = scale_slope(sizes, values, count);
+        int flagged = slope > scale_metrics[i].expected + tolerance;
+        printf("# %-18s slope %5.2f, expected %4.2f%s\n", scale_metrics[i].name, slope,
+                scale_metrics[i].expected, flagged ? "  SUPERLINEAR" : "");
+        superlinear |= flagged;
+    }
+
+    return (fail && superlinear) ? 1 : 0;
+}
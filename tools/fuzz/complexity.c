@@ -0,0 +1,615 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-fuzz-complexity: Searches for inputs on which LAI scales superlinearly */
+/* The input is not AML itself; it is a program for a generator that always emits
+ * valid AML. The first byte selects the operations that are run on the namespace,
+ * the remaining bytes emit devices, names, packages and methods. Each input is
+ * measured twice: with the generated objects once, and repeated four times. For
+ * linear operations, the cost grows by a factor of four; if it grows faster than
+ * 4^(1 + tolerance), the input is reported together with the operation.
+ *
+ * The cost is the number of user-space instructions, or the wall time if
+ * performance counters are unavailable. Measurements run in forked processes,
+ * since the namespace cannot be discarded.
+ *
+ * With -DLAI_LIBFUZZER (and -fsanitize=fuzzer), this is a libFuzzer target:
+ * growth exponents and the cost per input byte are fed back through extra
+ * counters, and a superlinear input aborts, so that libFuzzer saves it.
+ * Set LAI_FUZZ_KEEP_GOING to report findings without aborting. Otherwise, a
+ * standalone driver runs input files or randomly generated inputs. */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+#include <lai/core.h>
+#include "exec_impl.h"
+#include "aml_opcodes.h"
+#include "host.h"
+#include "aml.h"
+
+#define FUZZ_MAX_INPUT          4096
+#define FUZZ_MAX_DEPTH          6
+#define FUZZ_MAX_OBJECTS        (4 * FUZZ_MAX_INPUT)
+#define FUZZ_SCALE              4
+#define FUZZ_TOLERANCE          0.4
+#define FUZZ_EISAID             0x0A0CD041      // EisaId("PNP0C0A")
+
+// Below these costs, measurements are dominated by noise.
+#define FUZZ_FLOOR_INSTRUCTIONS 200000
+#define FUZZ_FLOOR_NS           200000
+
+enum
+{
+    FUZZ_PHASE_LOAD,        // lai_create_namespace(), always run
+    FUZZ_PHASE_INIT,        // lai_enable_acpi(): _STA and _INI of all devices
+    FUZZ_PHASE_ENUM,        // lai_enum() of all objects below \_SB
+    FUZZ_PHASE_DEVICEID,    // lai_get_deviceid() of all devices with a _HID
+    FUZZ_PHASE_RESOLVE,     // lai_resolve() of all objects
+    FUZZ_PHASE_EVAL,        // lai_eval() of all names and methods
+    FUZZ_PHASE_COUNT
+};
+
+static const char *fuzz_phase_names[FUZZ_PHASE_COUNT] = {
+    "load", "init", "enum", "deviceid", "resolve", "eval"
+};
+
+typedef struct fuzz_cost_t
+{
+    int instructions;       // 1 if costs are instructions, 0 if nanoseconds
+    uint64_t phase[FUZZ_PHASE_COUNT];
+} fuzz_cost_t;
+
+// Generator.
+
+typedef struct fuzz_program_t
+{
+    aml_builder_t *builder;
+    size_t counter;         // every object gets a unique name
+    int depth;
+    char scope[FUZZ_MAX_DEPTH + 1][ACPI_MAX_NAME];     // LAI paths of open scopes
+    int has_sta[FUZZ_MAX_DEPTH + 1], has_ini[FUZZ_MAX_DEPTH + 1];
+    char leaf[ACPI_MAX_NAME];       // last method without calls, empty if none
+
+    char (*objects)[ACPI_MAX_NAME];
+    size_t object_count;
+    char (*evaluated)[ACPI_MAX_NAME];
+    size_t evaluated_count;
+    size_t hids;
+} fuzz_program_t;
+
+static void fuzz_object(fuzz_program_t *program, char kind, char *name, char *path)
+{
+    static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    size_t value = program->counter++;
+    name[0] = kind;
+    name[1] = digits[(value / 1296) % 36];
+    name[2] = digits[(value / 36) % 36];
+    name[3] = digits[value % 36];
+    name[4] = 0;
+
+    strcpy(path, program->scope[program->depth]);
+    strcat(path, ".");
+    strcat(path, name);
+    if(program->object_count < FUZZ_MAX_OBJECTS)
+        strcpy(program->objects[program->object_count++], path);
+}
+
+static void fuzz_evaluated(fuzz_program_t *program, const char *path)
+{
+    if(program->evaluated_count < FUZZ_MAX_OBJECTS)
+        strcpy(program->evaluated[program->evaluated_count++], path);
+}
+
+// Converts a LAI path (\._SB_.XXXX) to an AML path (\_SB_.XXXX).
+static void fuzz_aml_path(char *aml, const char *path)
+{
+    aml[0] = '\\';
+    strcpy(aml + 1, path + 2);
+}
+
+// Store(Zero, Local0); While(LLess(Local0, count)) { Increment(Local0) }
+static void fuzz_emit_loop(aml_builder_t *builder, uint8_t count)
+{
+    aml_opcode(builder, STORE_OP);
+    aml_opcode(builder, ZERO_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_begin_while(builder);
+    aml_opcode(builder, LLESS_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_integer(builder, count);
+    aml_opcode(builder, INCREMENT_OP);
+    aml_opcode(builder, LOCAL0_OP);
+    aml_end(builder);
+}
+
+// fuzz_generate(): Emits the objects that are described by an input
+// Param:    fuzz_program_t *program - generator state
+// Param:    const uint8_t *data - commands, two bytes each
+// Param:    size_t size - size of the commands
+// Return:    Nothing
+
+static void fuzz_generate(fuzz_program_t *program, const uint8_t *data, size_t size)
+{
+    aml_builder_t *builder = program->builder;
+    char name[5], path[ACPI_MAX_NAME], aml[ACPI_MAX_NAME];
+
+    for(size_t i = 0; i + 1 < size; i += 2)
+    {
+        uint8_t argument = data[i + 1];
+        switch(data[i] % 8)
+        {
+        case 0:     // Device, optionally with a _HID
+            if(program->depth == FUZZ_MAX_DEPTH)
+                break;
+            fuzz_object(program, 'D', name, path);
+            aml_begin_device(builder, name);
+            program->depth++;
+            strcpy(program->scope[program->depth], path);
+            program->has_sta[program->depth] = 0;
+            program->has_ini[program->depth] = 0;
+            if(argument & 1)
+            {
+                aml_name_integer(builder, "_HID", FUZZ_EISAID);
+                program->hids++;
+            }
+            break;
+        case 1:     // end of the innermost Device
+            if(!program->depth)
+                break;
+            aml_end(builder);
+            program->depth--;
+            break;
+        case 2:     // Name() of an integer
+            fuzz_object(program, 'N', name, path);
+            aml_name_integer(builder, name, argument);
+            fuzz_evaluated(program, path);
+            break;
+        case 3:     // Name() of a package of integers
+            fuzz_object(program, 'P', name, path);
+            aml_byte(builder, NAME_OP);
+            aml_name(builder, name);
+            aml_begin_package(builder, argument % 32 + 1);
+            for(int j = 0; j < argument % 32 + 1; j++)
+                aml_integer(builder, j);
+            aml_end(builder);
+            fuzz_evaluated(program, path);
+            break;
+        case 4:     // Method() with a loop
+            fuzz_object(program, 'M', name, path);
+            aml_begin_method(builder, name, 0);
+            fuzz_emit_loop(builder, argument % 32);
+            aml_end(builder);
+            strcpy(program->leaf, path);
+            fuzz_evaluated(program, path);
+            break;
+        case 5:     // _STA or _INI of the innermost Device
+            if(!program->depth)
+                break;
+            if(!(argument & 1) && !program->has_sta[program->depth])
+            {
+                aml_begin_method(builder, "_STA", 0);
+                aml_opcode(builder, RETURN_OP);
+                aml_integer(builder, (argument & 2) ? 0 : 0x0F);
+                aml_end(builder);
+                program->has_sta[program->depth] = 1;
+            }else if((argument & 1) && !program->has_ini[program->depth])
+            {
+                aml_begin_method(builder, "_INI", 0);
+                fuzz_emit_loop(builder, argument % 16);
+                aml_end(builder);
+                program->has_ini[program->depth] = 1;
+            }
+            break;
+        case 6:     // Method() that calls the last method with a loop
+            if(!program->leaf[0])
+                break;
+            fuzz_object(program, 'C', name, path);
+            fuzz_aml_path(aml, program->leaf);
+            aml_begin_method(builder, name, 0);
+            for(int j = 0; j < argument % 4 + 1; j++)
+                aml_name(builder, aml);
+            aml_end(builder);
+            fuzz_evaluated(program, path);
+            break;
+        case 7:     // Method() that finds \RNAM by searching upwards
+            fuzz_object(program, 'R', name, path);
+            aml_begin_method(builder, name, 0);
+            for(int j = 0; j < argument % 4 + 1; j++)
+            {
+                aml_opcode(builder, STORE_OP);
+                aml_name(builder, "RNAM");
+                aml_opcode(builder, LOCAL0_OP);
+            }
+            aml_end(builder);
+            fuzz_evaluated(program, path);
+            break;
+        }
+    }
+
+    while(program->depth)
+    {
+        aml_end(builder);
+        program->depth--;
+    }
+}
+
+// Measurement.
+
+static int fuzz_counter_open(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t fuzz_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+typedef struct fuzz_meter_t
+{
+    int counter;            // perf event, or -1
+    uint64_t start;
+} fuzz_meter_t;
+
+static void fuzz_meter_start(fuzz_meter_t *meter)
+{
+    if(meter->counter >= 0)
+    {
+        ioctl(meter->counter, PERF_EVENT_IOC_RESET, 0);
+        ioctl(meter->counter, PERF_EVENT_IOC_ENABLE, 0);
+    }else
+        meter->start = fuzz_now();
+}
+
+static uint64_t fuzz_meter_stop(fuzz_meter_t *meter)
+{
+    if(meter->counter >= 0)
+    {
+        ioctl(meter->counter, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if(read(meter->counter, &count, sizeof(count)) != sizeof(count))
+            return 0;
+        return count;
+    }
+    return fuzz_now() - meter->start;
+}
+
+// fuzz_run(): Generates and measures an input; runs in a child process
+// Param:    const uint8_t *data - input
+// Param:    size_t size - size of the input, at least 1
+// Param:    int scale - number of times the objects are repeated
+// Param:    fuzz_cost_t *cost - receives the costs
+// Return:    Nothing
+
+static void fuzz_run(const uint8_t *data, size_t size, int scale, fuzz_cost_t *cost)
+{
+    host_set_verbose(0);
+
+    fuzz_program_t program;
+    aml_builder_t builder;
+    memset(&program, 0, sizeof(program));
+    program.builder = &builder;
+    program.objects = calloc(FUZZ_MAX_OBJECTS, ACPI_MAX_NAME);
+    program.evaluated = calloc(FUZZ_MAX_OBJECTS, ACPI_MAX_NAME);
+    if(!program.objects || !program.evaluated)
+        exit(1);
+    strcpy(program.scope[0], "\\._SB_");
+
+    aml_init(&builder, "DSDT");
+    aml_name_integer(&builder, "\\RNAM", 0);
+    aml_begin_scope(&builder, "\\_SB");
+    for(int i = 0; i < scale; i++)
+        fuzz_generate(&program, data + 1, size - 1);
+    aml_end(&builder);
+
+    size_t length;
+    void *table = aml_finish(&builder, &length);
+    if(host_add_table(table, length))
+        exit(1);
+    free(table);
+
+    fuzz_meter_t meter = {.counter = fuzz_counter_open()};
+    cost->instructions = (meter.counter >= 0);
+    uint8_t phases = data[0];
+
+    fuzz_meter_start(&meter);
+    if(lai_create_namespace())
+        lai_panic("lai-fuzz-complexity: the generated table was rejected\n");
+    cost->phase[FUZZ_PHASE_LOAD] = fuzz_meter_stop(&meter);
+
+    if(phases & (1 << FUZZ_PHASE_INIT))
+    {
+        fuzz_meter_start(&meter);
+        lai_enable_acpi(0);
+        cost->phase[FUZZ_PHASE_INIT] = fuzz_meter_stop(&meter);
+    }
+
+    if(phases & (1 << FUZZ_PHASE_ENUM))
+    {
+        char parent[] = "\\._SB_";
+        fuzz_meter_start(&meter);
+        for(size_t i = 0; lai_enum(parent, i); i++)
+            ;
+        cost->phase[FUZZ_PHASE_ENUM] = fuzz_meter_stop(&meter);
+    }
+
+    if(phases & (1 << FUZZ_PHASE_DEVICEID))
+    {
+        lai_object_t id = {0};
+        id.type = LAI_INTEGER;
+        id.integer = FUZZ_EISAID;
+        fuzz_meter_start(&meter);
+        for(size_t i = 0; i < program.hids && lai_get_deviceid(i, &id); i++)
+            ;
+        cost->phase[FUZZ_PHASE_DEVICEID] = fuzz_meter_stop(&meter);
+    }
+
+    if(phases & (1 << FUZZ_PHASE_RESOLVE))
+    {
+        fuzz_meter_start(&meter);
+        for(size_t i = 0; i < program.object_count; i++)
+        {
+            if(!lai_resolve(program.objects[i]))
+                lai_panic("lai-fuzz-complexity: %s was not created\n", program.objects[i]);
+        }
+        cost->phase[FUZZ_PHASE_RESOLVE] = fuzz_meter_stop(&meter);
+    }
+
+    if(phases & (1 << FUZZ_PHASE_EVAL))
+    {
+        lai_object_t result = {0};
+        fuzz_meter_start(&meter);
+        for(size_t i = 0; i < program.evaluated_count; i++)
+        {
+            if(lai_eval(&result, program.evaluated[i]))
+                lai_panic("lai-fuzz-complexity: unable to evaluate %s\n", program.evaluated[i]);
+            lai_free_object(&result);
+        }
+        cost->phase[FUZZ_PHASE_EVAL] = fuzz_meter_stop(&meter);
+    }
+}
+
+static int fuzz_measure(const uint8_t *data, size_t size, int scale, fuzz_cost_t *cost)
+{
+    memset(cost, 0, sizeof(fuzz_cost_t));
+
+    int pipes[2];
+    if(pipe(pipes))
+        return 1;
+
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        close(pipes[0]);
+        close(pipes[1]);
+        return 1;
+    }
+
+    if(!pid)
+    {
+        close(pipes[0]);
+        fuzz_run(data, size, scale, cost);
+        if(write(pipes[1], cost, sizeof(fuzz_cost_t)) != sizeof(fuzz_cost_t))
+            _exit(1);
+        _exit(0);
+    }
+
+    close(pipes[1]);
+    ssize_t length = read(pipes[0], cost, sizeof(fuzz_cost_t));
+    close(pipes[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    if(length != sizeof(fuzz_cost_t) || !WIFEXITED(status) || WEXITSTATUS(status))
+        return 1;
+    return 0;
+}
+
+// Analysis.
+
+#ifdef LAI_LIBFUZZER
+// libFuzzer treats inputs that reach new values of these counters as interesting.
+// For each phase: 8 buckets of the growth exponent, 8 of the cost per input byte.
+__attribute__((section("__libfuzzer_extra_counters")))
+static uint8_t fuzz_counters[FUZZ_PHASE_COUNT * 16];
+#endif
+
+static double fuzz_tolerance = FUZZ_TOLERANCE;
+
+// fuzz_check(): Measures an input and reports superlinear phases
+// Param:    const uint8_t *data - input
+// Param:    size_t size - size of the input
+// Return:    int - number of superlinear phases
+
+static int fuzz_check(const uint8_t *data, size_t size)
+{
+    if(size < 3 || size > FUZZ_MAX_INPUT)
+        return 0;
+
+    // Inputs that make LAI panic are not interesting here.
+    fuzz_cost_t single, scaled;
+    if(fuzz_measure(data, size, 1, &single) || fuzz_measure(data, size, FUZZ_SCALE, &scaled))
+        return 0;
+    if(single.instructions != scaled.instructions)
+        return 0;
+
+    uint64_t floor = single.instructions ? FUZZ_FLOOR_INSTRUCTIONS : FUZZ_FLOOR_NS;
+    int found = 0;
+    for(int i = 0; i < FUZZ_PHASE_COUNT; i++)
+    {
+        if(!single.phase[i] || !scaled.phase[i])
+            continue;
+
+        double exponent = log((double)scaled.phase[i] / single.phase[i]) / log(FUZZ_SCALE);
+#ifdef LAI_LIBFUZZER
+        int growth = exponent < 0 ? 0 : (exponent >= 2 ? 7 : (int)(exponent * 4));
+        int per_byte = (int)log2((double)single.phase[i] / size + 1);
+        fuzz_counters[i * 16 + growth]++;
+        fuzz_counters[i * 16 + 8 + (per_byte > 7 ? 7 : per_byte)]++;
+#endif
+
+        if(scaled.phase[i] < floor || exponent <= 1 + fuzz_tolerance)
+            continue;
+
+        fprintf(stderr, "lai-fuzz-complexity: %s is superlinear: %lu -> %lu %s with %dx the "
+                "objects (exponent %.2f), %zu input bytes\n", fuzz_phase_names[i],
+                (unsigned long)single.phase[i], (unsigned long)scaled.phase[i],
+                single.instructions ? "instructions" : "ns", FUZZ_SCALE, exponent, size);
+        found++;
+    }
+    return found;
+}
+
+#ifdef LAI_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if(fuzz_check(data, size) && !getenv("LAI_FUZZ_KEEP_GOING"))
+        abort();
+    return 0;
+}
+
+#else
+
+static uint64_t fuzz_random_state;
+
+static uint64_t fuzz_random(void)
+{
+    // xorshift64
+    fuzz_random_state ^= fuzz_random_state << 13;
+    fuzz_random_state ^= fuzz_random_state >> 7;
+    fuzz_random_state ^= fuzz_random_state << 17;
+    return fuzz_random_state;
+}
+
+static void fuzz_save(const char *directory, const uint8_t *data, size_t size)
+{
+    // FNV-1a of the input, so that duplicates are stored once.
+    uint64_t hash = 0xCBF29CE484222325;
+    for(size_t i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 0x100000001B3;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/superlinear-%016lx", directory, (unsigned long)hash);
+    FILE *file = fopen(path, "wb");
+    if(!file || fwrite(data, 1, size, file) != size)
+        fprintf(stderr, "lai-fuzz-complexity: unable to write %s\n", path);
+    else
+        fprintf(stderr, "lai-fuzz-complexity: saved %s\n", path);
+    if(file)
+        fclose(file);
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-fuzz-complexity [options] [INPUT...]\n"
+            "  -r RUNS      number of random inputs, if no input files are given (default 1000)\n"
+            "  -L LENGTH    maximum length of random inputs (default 512)\n"
+            "  -s SEED      seed of the random inputs (default: time)\n"
+            "  -t EXPONENT  tolerance above linear growth (default 0.4)\n"
+            "  -o DIR       save superlinear inputs to DIR\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 1000;
+    size_t max_length = 512;
+    const char *directory = NULL;
+    fuzz_random_state = time(NULL);
+
+    int option;
+    while((option = getopt(argc, argv, "r:L:s:t:o:")) != -1)
+    {
+        switch(option)
+        {
+        case 'r':
+            runs = strtoul(optarg, NULL, 0);
+            break;
+        case 'L':
+            max_length = strtoul(optarg, NULL, 0);
+            if(max_length < 3 || max_length > FUZZ_MAX_INPUT)
+                usage();
+            break;
+        case 's':
+            fuzz_random_state = strtoull(optarg, NULL, 0);
+            break;
+        case 't':
+            fuzz_tolerance = atof(optarg);
+            break;
+        case 'o':
+            directory = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if(!fuzz_random_state)
+        fuzz_random_state = 1;
+
+    static uint8_t data[FUZZ_MAX_INPUT];
+    unsigned long inputs = 0, found = 0;
+
+    if(optind < argc)
+    {
+        for(int i = optind; i < argc; i++)
+        {
+            FILE *file = fopen(argv[i], "rb");
+            if(!file)
+            {
+                fprintf(stderr, "lai-fuzz-complexity: unable to read %s\n", argv[i]);
+                return 2;
+            }
+            size_t size = fread(data, 1, sizeof(data), file);
+            fclose(file);
+
+            inputs++;
+            if(fuzz_check(data, size))
+                found++;
+        }
+    }else
+    {
+        for(unsigned long i = 0; i < runs; i++)
+        {
+            size_t size = 3 + fuzz_random() % (max_length - 2);
+            for(size_t j = 0; j < size; j++)
+                data[j] = fuzz_random();
+
+            inputs++;
+            if(fuzz_check(data, size))
+            {
+                found++;
+                if(directory)
+                    fuzz_save(directory, data, size);
+            }
+        }
+    }
+
+    printf("%lu inputs, %lu superlinear\n", inputs, found);
+    return found ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Userspace Host: Emulated Hardware */
+/* All 64 KiB of port I/O space are backed by memory. The PM1 registers that the
+ * FADT points to behave like the real ones: status bits are cleared by writing
+ * ones, writing acpi_enable to the SMI command port sets SCI_EN, and a sleep
+ * request (SLP_EN) wakes up immediately. The first 4 GiB of physical memory are
+ * backed by a sparse anonymous mapping, and PCI functions have 4 KiB of
+ * configuration space each. */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <lai/core.h>
+#include "host.h"
+
+#define HOST_PORT_SPACE         0x10000
+#define HOST_MEMORY_SPACE       0x100000000ULL
+#define HOST_PCI_CONFIG_SIZE    4096
+
+// Registers of the synthesized FADT.
+#define HOST_PM1A_EVENT         0x400
+#define HOST_PM1A_CONTROL       0x404
+#define HOST_PM_TIMER           0x408
+#define HOST_SMI_COMMAND        0xB2
+#define HOST_ACPI_ENABLE        0xA0
+#define HOST_ACPI_DISABLE       0xA1
+
+typedef struct host_pci_function_t
+{
+    uint8_t bus, slot, function;
+    uint8_t config[HOST_PCI_CONFIG_SIZE];
+} host_pci_function_t;
+
+// Parallel initialization accesses hardware from several threads.
+static pthread_mutex_t host_hardware_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint8_t host_ports[HOST_PORT_SPACE];
+static uint8_t *host_memory;
+static host_pci_function_t *host_pci;
+static size_t host_pci_count;
+static host_stats_t host_stats = {.sleep_type = -1};
+
+static acpi_fadt_t host_fadt = {
+    .header = {.signature = "FACP", .length = sizeof(acpi_fadt_t), .revision = 1},
+    .smi_command_port = HOST_SMI_COMMAND,
+    .acpi_enable = HOST_ACPI_ENABLE,
+    .acpi_disable = HOST_ACPI_DISABLE,
+    .pm1a_event_block = HOST_PM1A_EVENT,
+    .pm1a_control_block = HOST_PM1A_CONTROL,
+    .pm_timer_block = HOST_PM_TIMER,
+    .pm1_event_length = 4,
+    .pm1_control_length = 2,
+    .pm_timer_length = 4,
+};
+
+acpi_fadt_t *host_default_fadt(void)
+{
+    return &host_fadt;
+}
+
+void host_get_stats(host_stats_t *stats)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    *stats = host_stats;
+    pthread_mutex_unlock(&host_hardware_lock);
+}
+
+// Port I/O.
+
+static int host_in_range(uint32_t port, uint32_t base, uint32_t length)
+{
+    return base && port >= base && port < base + length;
+}
+
+// host_is_status_port(): Checks whether a port belongs to a PM1 status register
+// Param:    uint32_t port - port
+// Return:    int - 1 if the port's bits are cleared by writing ones
+
+static int host_is_status_port(uint32_t port)
+{
+    acpi_fadt_t *fadt = laihost_scan("FACP", 0);
+    uint32_t length = fadt->pm1_event_length / 2;
+    return host_in_range(port, fadt->pm1a_event_block, length)
+            || host_in_range(port, fadt->pm1b_event_block, length);
+}
+
+static uint16_t host_read_word(uint32_t port)
+{
+    return host_ports[port & 0xFFFF] | (host_ports[(port + 1) & 0xFFFF] << 8);
+}
+
+static void host_set_word(uint32_t port, uint16_t value)
+{
+    host_ports[port & 0xFFFF] = value & 0xFF;
+    host_ports[(port + 1) & 0xFFFF] = value >> 8;
+}
+
+// host_handle_control(): Emulates the side effects of PM1 control and SMI writes
+// Param:    uint16_t port - first port that was written
+// Param:    int width - access width in bytes
+// Return:    Nothing
+
+static void host_handle_control(uint16_t port, int width)
+{
+    acpi_fadt_t *fadt = laihost_scan("FACP", 0);
+
+    if(port == fadt->smi_command_port && fadt->smi_command_port)
+    {
+        uint8_t command = host_ports[port];
+        uint16_t enable = (command == fadt->acpi_enable) ? ACPI_ENABLED : 0;
+        if(command == fadt->acpi_enable || command == fadt->acpi_disable)
+        {
+            uint32_t blocks[] = {fadt->pm1a_control_block, fadt->pm1b_control_block};
+            for(int i = 0; i < 2; i++)
+            {
+                if(blocks[i])
+                    host_set_word(blocks[i], (host_read_word(blocks[i]) & ~ACPI_ENABLED) | enable);
+            }
+        }
+    }
+
+    uint32_t controls[] = {fadt->pm1a_control_block, fadt->pm1b_control_block};
+    uint32_t events[] = {fadt->pm1a_event_block, fadt->pm1b_event_block};
+    for(int i = 0; i < 2; i++)
+    {
+        if(!controls[i] || !host_in_range(controls[i] + 1, port, width))
+            continue;
+
+        uint16_t control = host_read_word(controls[i]);
+        if(!(control & ACPI_SLEEP))
+            continue;
+
+        // SLP_EN is write-only. The machine wakes up right away.
+        if(!i)
+            host_stats.sleep_type = (control >> 10) & 7;
+        host_set_word(controls[i], control & ~ACPI_SLEEP);
+        if(events[i])
+            host_set_word(events[i], host_read_word(events[i]) | ACPI_WAKE);
+    }
+}
+
+static uint32_t host_port_read(uint16_t port, int width)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.port_reads++;
+
+    acpi_fadt_t *fadt = laihost_scan("FACP", 0);
+    if(fadt->pm_timer_block && port == fadt->pm_timer_block)
+    {
+        // The PM timer is 24 bits wide and runs at 3.579545 MHz.
+        uint32_t timer = (uint32_t)(host_stats.sleep_ms * 3580 + host_stats.port_reads);
+        for(int i = 0; i < 4; i++)
+            host_ports[(port + i) & 0xFFFF] = (i < 3) ? (timer >> (i * 8)) & 0xFF : 0;
+    }
+
+    uint32_t value = 0;
+    for(int i = 0; i < width; i++)
+        value |= (uint32_t)host_ports[(port + i) & 0xFFFF] << (i * 8);
+
+    pthread_mutex_unlock(&host_hardware_lock);
+    return value;
+}
+
+static void host_port_write(uint16_t port, uint32_t value, int width)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.port_writes++;
+
+    for(int i = 0; i < width; i++)
+    {
+        uint16_t current = (port + i) & 0xFFFF;
+        uint8_t byte = value >> (i * 8);
+        if(host_is_status_port(current))
+            host_ports[current] &= ~byte;
+        else
+            host_ports[current] = byte;
+    }
+
+    host_handle_control(port, width);
+    pthread_mutex_unlock(&host_hardware_lock);
+}
+
+uint8_t laihost_inb(uint16_t port)
+{
+    return host_port_read(port, 1);
+}
+
+uint16_t laihost_inw(uint16_t port)
+{
+    return host_port_read(port, 2);
+}
+
+uint32_t laihost_ind(uint16_t port)
+{
+    return host_port_read(port, 4);
+}
+
+void laihost_outb(uint16_t port, uint8_t value)
+{
+    host_port_write(port, value, 1);
+}
+
+void laihost_outw(uint16_t port, uint16_t value)
+{
+    host_port_write(port, value, 2);
+}
+
+void laihost_outd(uint16_t port, uint32_t value)
+{
+    host_port_write(port, value, 4);
+}
+
+// Memory-mapped I/O.
+
+void *laihost_map(size_t address, size_t count)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.mmio_maps++;
+
+    if(!host_memory)
+    {
+        // Pages are only allocated once they are touched.
+        host_memory = mmap(NULL, HOST_MEMORY_SPACE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(host_memory == MAP_FAILED)
+        {
+            fprintf(stderr, "lai-host: unable to reserve emulated physical memory\n");
+            abort();
+        }
+    }
+
+    pthread_mutex_unlock(&host_hardware_lock);
+
+    if(address >= HOST_MEMORY_SPACE || count > HOST_MEMORY_SPACE - address)
+    {
+        fprintf(stderr, "lai-host: MMIO at 0x%zX is above 4 GiB, which is not emulated\n", address);
+        abort();
+    }
+    return host_memory + address;
+}
+
+// PCI configuration space.
+
+static host_pci_function_t *host_find_pci(uint8_t bus, uint8_t slot, uint8_t function)
+{
+    for(size_t i = 0; i < host_pci_count; i++)
+    {
+        if(host_pci[i].bus == bus && host_pci[i].slot == slot && host_pci[i].function == function)
+            return &host_pci[i];
+    }
+    return NULL;
+}
+
+// host_add_pci_device(): Adds an emulated PCI function
+// Param:    uint8_t bus, slot, function - address of the function
+// Param:    uint16_t vendor, device - IDs
+// Param:    uint8_t pin - interrupt pin, 1-4 for INTA#-INTD#, 0 for none
+// Return:    int - 0 on success
+
+int host_add_pci_device(uint8_t bus, uint8_t slot, uint8_t function,
+        uint16_t vendor, uint16_t device, uint8_t pin)
+{
+    if(slot >= 32 || function >= 8 || pin > 4)
+        return 1;
+
+    pthread_mutex_lock(&host_hardware_lock);
+    host_pci_function_t *pci = host_find_pci(bus, slot, function);
+    if(!pci)
+    {
+        host_pci_function_t *array = realloc(host_pci,
+                sizeof(host_pci_function_t) * (host_pci_count + 1));
+        if(!array)
+        {
+            pthread_mutex_unlock(&host_hardware_lock);
+            return 1;
+        }
+
+        host_pci = array;
+        pci = &host_pci[host_pci_count++];
+    }
+
+    memset(pci, 0, sizeof(host_pci_function_t));
+    pci->bus = bus;
+    pci->slot = slot;
+    pci->function = function;
+    memcpy(&pci->config[0x00], &vendor, 2);
+    memcpy(&pci->config[0x02], &device, 2);
+    pci->config[0x3C] = 0xFF;       // interrupt line: unknown
+    pci->config[0x3D] = pin;
+    pthread_mutex_unlock(&host_hardware_lock);
+    return 0;
+}
+
+uint32_t laihost_pci_read(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.pci_reads++;
+
+    uint32_t value = 0xFFFFFFFF;
+    host_pci_function_t *pci = host_find_pci(bus, slot, function);
+    if(pci && offset <= HOST_PCI_CONFIG_SIZE - 4)
+        memcpy(&value, &pci->config[offset], 4);
+
+    pthread_mutex_unlock(&host_hardware_lock);
+    return value;
+}
+
+void laihost_pci_write(uint8_t bus, uint8_t slot, uint8_t function, uint16_t offset, uint32_t value)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.pci_writes++;
+
+    // The vendor and device IDs are read-only.
+    host_pci_function_t *pci = host_find_pci(bus, slot, function);
+    if(pci && offset >= 4 && offset <= HOST_PCI_CONFIG_SIZE - 4)
+        memcpy(&pci->config[offset], &value, 4);
+
+    pthread_mutex_unlock(&host_hardware_lock);
+}
+
+// Timing. No real time passes, so that profiles only show the interpreter.
+
+void laihost_sleep(uint64_t ms)
+{
+    pthread_mutex_lock(&host_hardware_lock);
+    host_stats.sleep_ms += ms;
+    pthread_mutex_unlock(&host_hardware_lock);
+}
+
+void laihost_wait_for_interrupt(void)
+{
+    // Sleep requests wake up immediately, see host_handle_control().
+}
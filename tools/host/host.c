@@ -0,0 +1,269 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Userspace Host: Tables, Memory, Logging and Threads */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lai/core.h>
+#include "host.h"
+
+typedef struct host_table_t
+{
+    char signature[4];
+    void *data;
+} host_table_t;
+
+static host_table_t *host_tables;
+static size_t host_table_count;
+static int host_verbose;
+
+// Defined in devices.c, points to the emulated registers.
+acpi_fadt_t *host_default_fadt(void);
+
+// host_add_table(): Adds a table that is served by laihost_scan()
+// Param:    const void *table - table, starting with the ACPI header
+// Param:    size_t length - size of the buffer
+// Return:    int - 0 on success
+
+int host_add_table(const void *table, size_t length)
+{
+    const acpi_header_t *header = table;
+    if(length < sizeof(acpi_header_t) || header->length > length
+            || header->length < sizeof(acpi_header_t))
+    {
+        fprintf(stderr, "lai-host: table is truncated\n");
+        return 1;
+    }
+
+    // Old FADTs are shorter than acpi_fadt_t; LAI reads the whole structure.
+    size_t size = header->length;
+    if(!memcmp(header->signature, "FACP", 4) && size < sizeof(acpi_fadt_t))
+        size = sizeof(acpi_fadt_t);
+
+    void *data = calloc(1, size);
+    host_table_t *tables = realloc(host_tables, sizeof(host_table_t) * (host_table_count + 1));
+    if(!data || !tables)
+    {
+        free(data);
+        fprintf(stderr, "lai-host: out of memory\n");
+        return 1;
+    }
+
+    memcpy(data, table, header->length);
+    host_tables = tables;
+    memcpy(host_tables[host_table_count].signature, header->signature, 4);
+    host_tables[host_table_count].data = data;
+    host_table_count++;
+    return 0;
+}
+
+// host_load_table(): Adds a table from a binary file
+// Param:    const char *path - file name
+// Return:    int - 0 on success
+
+int host_load_table(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        fprintf(stderr, "lai-host: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    rewind(file);
+
+    void *buffer = malloc(length > 0 ? length : 1);
+    if(!buffer || fread(buffer, 1, length, file) != (size_t)length)
+    {
+        fprintf(stderr, "lai-host: %s: unable to read file\n", path);
+        free(buffer);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    int status = host_add_table(buffer, length);
+    if(status)
+        fprintf(stderr, "lai-host: %s: not an ACPI table\n", path);
+    free(buffer);
+    return status;
+}
+
+// host_reset_tables(): Forgets all tables
+// Return:    Nothing
+
+void host_reset_tables(void)
+{
+    for(size_t i = 0; i < host_table_count; i++)
+        free(host_tables[i].data);
+    free(host_tables);
+    host_tables = NULL;
+    host_table_count = 0;
+}
+
+void *laihost_scan(char *signature, size_t index)
+{
+    for(size_t i = 0; i < host_table_count; i++)
+    {
+        if(memcmp(host_tables[i].signature, signature, 4))
+            continue;
+        if(!index)
+            return host_tables[i].data;
+        index--;
+    }
+
+    if(!memcmp(signature, "FACP", 4) && !index)
+        return host_default_fadt();
+    return NULL;
+}
+
+// Memory.
+
+void *laihost_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *laihost_realloc(void *pointer, size_t size)
+{
+    return realloc(pointer, size);
+}
+
+void laihost_free(void *pointer)
+{
+    free(pointer);
+}
+
+// Logging.
+
+void host_set_verbose(int verbose)
+{
+    host_verbose = verbose;
+}
+
+void laihost_log(int level, const char *format, va_list args)
+{
+    if(level == LAI_DEBUG_LOG && !host_verbose)
+        return;
+
+    fputs(level == LAI_WARN_LOG ? "lai warning: " : "lai: ", stderr);
+    vfprintf(stderr, format, args);
+}
+
+void laihost_panic(const char *format, va_list args)
+{
+    fputs("lai panic: ", stderr);
+    vfprintf(stderr, format, args);
+    abort();
+}
+
+// host_print_object(): Prints an object to stdout
+// Param:    const lai_object_t *object - object
+// Param:    int indent - indentation of nested packages
+// Return:    Nothing
+
+void host_print_object(const lai_object_t *object, int indent)
+{
+    switch(object->type)
+    {
+    case LAI_INTEGER:
+        printf("%*sInteger 0x%llX\n", indent, "", (unsigned long long)object->integer);
+        break;
+    case LAI_STRING:
+        printf("%*sString \"%s\"\n", indent, "", object->string);
+        break;
+    case LAI_BUFFER:
+        printf("%*sBuffer (%zu bytes)", indent, "", object->buffer_size);
+        for(size_t i = 0; i < object->buffer_size; i++)
+            printf("%s%02X", (i % 16) ? " " : "\n  ", ((uint8_t *)object->buffer)[i]);
+        printf("\n");
+        break;
+    case LAI_PACKAGE:
+        printf("%*sPackage (%d elements)\n", indent, "", object->package_size);
+        for(int i = 0; i < object->package_size; i++)
+            host_print_object(&object->package[i], indent + 2);
+        break;
+    case LAI_HANDLE:
+        printf("%*sReference %s\n", indent, "", object->handle->path);
+        break;
+    default:
+        printf("%*sObject of type %d\n", indent, "", object->type);
+    }
+}
+
+void laihost_handle_amldebug(lai_object_t *object)
+{
+    if(!host_verbose)
+        return;
+
+    printf("AML debug: ");
+    host_print_object(object, 0);
+}
+
+// Threads; only used by parallel device initialization.
+
+void *laihost_create_lock(void)
+{
+    pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+    if(mutex)
+        pthread_mutex_init(mutex, NULL);
+    return mutex;
+}
+
+void laihost_lock(void *lock)
+{
+    pthread_mutex_lock(lock);
+}
+
+void laihost_unlock(void *lock)
+{
+    pthread_mutex_unlock(lock);
+}
+
+typedef struct host_thread_t
+{
+    pthread_t thread;
+    void (*function)(void *);
+    void *context;
+} host_thread_t;
+
+static void *host_thread_entry(void *argument)
+{
+    host_thread_t *thread = argument;
+    thread->function(thread->context);
+    return NULL;
+}
+
+void *laihost_create_thread(void (*function)(void *), void *context)
+{
+    host_thread_t *thread = malloc(sizeof(host_thread_t));
+    if(!thread)
+        return NULL;
+
+    thread->function = function;
+    thread->context = context;
+    if(pthread_create(&thread->thread, NULL, host_thread_entry, thread))
+    {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void laihost_join_thread(void *argument)
+{
+    host_thread_t *thread = argument;
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
@@ -0,0 +1,44 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* Userspace Host */
+/* Implements the laihost_* functions on top of a plain Linux process. ACPI tables
+ * are loaded from files and all hardware is emulated in memory, so that the
+ * interpreter can be run and profiled without real firmware. */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lai/core.h>
+
+// Tables: binaries as written by `acpidump -b` or `iasl`.
+// The signature is taken from the table header. Without a FACP, a FADT that
+// points to the emulated PM1 registers is synthesized.
+int host_load_table(const char *path);
+int host_add_table(const void *table, size_t length);
+void host_reset_tables(void);
+
+// Emulated PCI functions. Unknown functions read as all ones.
+int host_add_pci_device(uint8_t bus, uint8_t slot, uint8_t function,
+        uint16_t vendor, uint16_t device, uint8_t pin);
+
+// Emulated hardware state.
+typedef struct host_stats_t
+{
+    uint64_t port_reads;
+    uint64_t port_writes;
+    uint64_t mmio_maps;
+    uint64_t pci_reads;
+    uint64_t pci_writes;
+    uint64_t sleep_ms;          // time passed to laihost_sleep(); no real time passes
+    int sleep_type;             // SLP_TYPa of the last sleep request, -1 if none
+} host_stats_t;
+
+void host_get_stats(host_stats_t *);
+
+// Logging; debug output is discarded unless enabled.
+void host_set_verbose(int);
+void host_print_object(const lai_object_t *, int indent);
@@ -0,0 +1,243 @@
+/*
+ * Lux ACPI Implementation
+ * Copyright (C) 2019 by LAI contributors
+ */
+
+/* lai-host: Runs LAI against ACPI table dumps */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <lai/core.h>
+#include "host.h"
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: lai-host [options] TABLE...\n"
+            "Loads DSDT, SSDT and FACP binaries (acpidump -b or iasl output) and runs LAI\n"
+            "on emulated hardware.\n"
+            "\n"
+            "  -e PATH      evaluate an object, e.g. \\_SB.PCI0._CRS (may be repeated)\n"
+            "  -n COUNT     evaluate each object COUNT times, for profiling\n"
+            "  -i MODE      enable ACPI in IRQ mode MODE; runs _STA and _INI of all devices\n"
+            "  -j WORKERS   initialize devices on WORKERS threads (with -i)\n"
+            "  -p B:S.F:PIN emulate a PCI function with interrupt pin PIN (1-4) and route it\n"
+            "  -s STATE     enter sleep state STATE at the end\n"
+            "  -m           print memory statistics\n"
+            "  -v           print LAI debug output\n");
+    exit(2);
+}
+
+// host_convert_path(): Converts an ASL path (\_SB.PCI0) to LAI's form (\._SB_.PCI0)
+// Param:    char *destination - at least ACPI_MAX_NAME bytes
+// Param:    const char *path - absolute ASL path
+// Return:    int - 0 on success
+
+static int host_convert_path(char *destination, const char *path)
+{
+    if(*path != '\\')
+        return 1;
+    path++;
+
+    size_t length = 1;
+    destination[0] = '\\';
+    while(*path)
+    {
+        size_t segment = strcspn(path, ".");
+        if(!segment || segment > 4 || length + 6 > ACPI_MAX_NAME)
+            return 1;
+
+        destination[length++] = '.';
+        for(size_t i = 0; i < 4; i++)
+            destination[length++] = (i < segment) ? path[i] : '_';
+
+        path += segment;
+        if(*path == '.')
+            path++;
+    }
+
+    destination[length] = 0;
+    return 0;
+}
+
+static double host_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static int host_evaluate(const char *path, long count)
+{
+    char name[ACPI_MAX_NAME];
+    if(host_convert_path(name, path))
+    {
+        fprintf(stderr, "lai-host: invalid path %s\n", path);
+        return 1;
+    }
+
+    lai_nsnode_t *handle = lai_resolve(name);
+    if(!handle)
+    {
+        fprintf(stderr, "lai-host: %s does not exist\n", path);
+        return 1;
+    }
+
+    lai_object_t result = {0};
+    double start = host_now();
+    for(long i = 0; i < count; i++)
+    {
+        lai_free_object(&result);
+        if(lai_eval_args(handle, 0, NULL, &result))
+        {
+            fprintf(stderr, "lai-host: unable to evaluate %s\n", path);
+            return 1;
+        }
+    }
+    double elapsed = host_now() - start;
+
+    printf("%s = ", path);
+    host_print_object(&result, 0);
+    if(count > 1)
+        printf("%ld evaluations, %.3f us each\n", count, elapsed * 1e6 / count);
+    lai_free_object(&result);
+    return 0;
+}
+
+static void host_print_memory(void)
+{
+    static const char *categories[] = {
+        "namespace", "code", "string", "buffer", "package", "state", "resource"
+    };
+
+    lai_memory_stats_t stats;
+    lai_get_memory_stats(&stats);
+    for(int i = 0; i < LAI_MEMORY_CATEGORIES; i++)
+        printf("%-10s %8zu objects %10zu bytes, peak %10zu bytes\n", categories[i],
+                stats.objects[i], stats.current[i], stats.peak[i]);
+    printf("host       %10zu bytes, peak %10zu bytes\n", stats.host_current, stats.host_peak);
+}
+
+int main(int argc, char **argv)
+{
+    const char *paths[64];
+    int path_count = 0;
+    unsigned int routes[64][4];
+    int route_count = 0;
+    long count = 1;
+    long irq_mode = -1;
+    long workers = 0;
+    long sleep_state = -1;
+    int memory = 0;
+
+    int option;
+    while((option = getopt(argc, argv, "e:n:i:j:p:s:mv")) != -1)
+    {
+        switch(option)
+        {
+        case 'e':
+            if(path_count == 64)
+                usage();
+            paths[path_count++] = optarg;
+            break;
+        case 'n':
+            count = strtol(optarg, NULL, 0);
+            break;
+        case 'i':
+            irq_mode = strtol(optarg, NULL, 0);
+            break;
+        case 'j':
+            workers = strtol(optarg, NULL, 0);
+            break;
+        case 'p':
+        {
+            unsigned int *route = routes[route_count];
+            if(route_count == 64 || sscanf(optarg, "%x:%x.%x:%u",
+                    &route[0], &route[1], &route[2], &route[3]) != 4)
+                usage();
+            if(host_add_pci_device(route[0], route[1], route[2], 0x8086, 0x1234, route[3]))
+                usage();
+            route_count++;
+            break;
+        }
+        case 's':
+            sleep_state = strtol(optarg, NULL, 0);
+            break;
+        case 'm':
+            memory = 1;
+            break;
+        case 'v':
+            host_set_verbose(1);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if(optind == argc || count < 1)
+        usage();
+
+    for(int i = optind; i < argc; i++)
+    {
+        if(host_load_table(argv[i]))
+            return 1;
+    }
+
+    if(!laihost_scan("DSDT", 0))
+    {
+        fprintf(stderr, "lai-host: no DSDT was given\n");
+        return 1;
+    }
+
+    double start = host_now();
+    if(lai_create_namespace())
+    {
+        fprintf(stderr, "lai-host: the DSDT is malformed\n");
+        return 1;
+    }
+    printf("namespace: %zu objects in %.3f ms\n", lai_ns_size, (host_now() - start) * 1e3);
+
+    if(irq_mode >= 0)
+    {
+        lai_enable_parallel_init(workers);
+        start = host_now();
+        if(lai_enable_acpi(irq_mode))
+        {
+            fprintf(stderr, "lai-host: unable to enable ACPI\n");
+            return 1;
+        }
+        printf("enabled ACPI in %.3f ms\n", (host_now() - start) * 1e3);
+    }
+
+    int status = 0;
+    for(int i = 0; i < path_count; i++)
+        status |= host_evaluate(paths[i], count);
+
+    for(int i = 0; i < route_count; i++)
+    {
+        acpi_resource_t resource;
+        if(lai_pci_route(&resource, routes[i][0], routes[i][1], routes[i][2]))
+            printf("PCI %02X:%02X.%X: no route\n", routes[i][0], routes[i][1], routes[i][2]);
+        else
+            printf("PCI %02X:%02X.%X: IRQ %llu\n", routes[i][0], routes[i][1], routes[i][2],
+                    (unsigned long long)resource.base);
+    }
+
+    if(memory)
+        host_print_memory();
+
+    if(sleep_state >= 0)
+    {
+        if(lai_enter_sleep(sleep_state))
+            status = 1;
+
+        host_stats_t stats;
+        host_get_stats(&stats);
+        printf("sleep state S%ld: SLP_TYPa %d\n", sleep_state, stats.sleep_type);
+    }
+
+    return status;
+}